@@ -1,6 +1,6 @@
 #pragma once
 #include "Vertex.h"
-#include <windows.h>
+#include "Platform.h"
 
 // Class used to store info for an ambient light. All other lights inherit from this class
 class AmbientLight
@@ -0,0 +1,218 @@
+#include "AssetCache.h"
+#include "BakedMesh.h"
+#include "MD2Loader.h"
+#include <chrono>
+
+// Enough for every model in the demo many times over
+const size_t DEFAULT_ASSET_MEMORY_BUDGET = 64 * 1024 * 1024;
+
+AssetCache::AssetCache() : _memoryBudget(DEFAULT_ASSET_MEMORY_BUDGET)
+{
+}
+
+// Any prefetches that are still running are waited for when their futures are destroyed
+AssetCache::~AssetCache()
+{
+}
+
+void AssetCache::SetMemoryBudget(size_t bytes)
+{
+	_memoryBudget = bytes;
+	Evict();
+}
+
+size_t AssetCache::GetMemoryBudget() const
+{
+	return _memoryBudget;
+}
+
+size_t AssetCache::GetMemoryUsed() const
+{
+	size_t used = 0;
+	for (const Entry& entry : _entries)
+	{
+		if (IsReady(entry) && entry.asset.get())
+		{
+			used += entry.asset.get()->GetMemorySize();
+		}
+	}
+	return used;
+}
+
+std::shared_ptr<const ModelAsset> AssetCache::Load(const char* modelPath, const char* texturePath)
+{
+	auto entry = Find(modelPath, texturePath, false);
+	std::shared_ptr<const ModelAsset> asset = entry->asset.get();
+	Complete(entry->key, asset);
+	return asset;
+}
+
+void AssetCache::Prefetch(const char* modelPath, const char* texturePath)
+{
+	Find(modelPath, texturePath, true);
+	Evict();
+}
+
+void AssetCache::LoadAsync(const char* modelPath, const char* texturePath, const LoadedCallback& onLoaded)
+{
+	auto entry = Find(modelPath, texturePath, true);
+	if (IsReady(*entry))
+	{
+		std::shared_ptr<const ModelAsset> asset = entry->asset.get();
+		Complete(entry->key, asset);
+		onLoaded(asset);
+		return;
+	}
+	_pendingLoads.push_back({ entry->key, entry->asset, onLoaded });
+}
+
+void AssetCache::Update()
+{
+	// Callbacks are taken out of the list before they are called, as they may start new loads
+	for (size_t i = 0; i < _pendingLoads.size();)
+	{
+		if (_pendingLoads[i].asset.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+		{
+			i++;
+			continue;
+		}
+		PendingLoad load = _pendingLoads[i];
+		_pendingLoads.erase(_pendingLoads.begin() + i);
+		std::shared_ptr<const ModelAsset> asset = load.asset.get();
+		Complete(load.key, asset);
+		load.onLoaded(asset);
+	}
+}
+
+void AssetCache::Clear()
+{
+	for (auto entry = _entries.begin(); entry != _entries.end();)
+	{
+		if (IsReady(*entry))
+		{
+			_index.erase(entry->key);
+			entry = _entries.erase(entry);
+		}
+		else
+		{
+			++entry;
+		}
+	}
+}
+
+// Finds the entry for the files and moves it to the front of the list, adding it if it is not
+// already there. New entries are loaded on a background thread when prefetching and on this
+// thread otherwise
+std::list<AssetCache::Entry>::iterator AssetCache::Find(const char* modelPath, const char* texturePath, bool prefetch)
+{
+	std::string key = MakeKey(modelPath, texturePath);
+	auto found = _index.find(key);
+	if (found != _index.end())
+	{
+		_entries.splice(_entries.begin(), _entries, found->second);
+		return found->second;
+	}
+
+	std::string model = modelPath;
+	std::string texture = texturePath ? texturePath : "";
+	Entry entry;
+	entry.key = key;
+	if (prefetch)
+	{
+		entry.asset = std::async(std::launch::async, &AssetCache::LoadAsset, model, texture).share();
+	}
+	else
+	{
+		std::promise<std::shared_ptr<const ModelAsset>> loaded;
+		loaded.set_value(LoadAsset(model, texture));
+		entry.asset = loaded.get_future().share();
+	}
+	_entries.push_front(entry);
+	_index[key] = _entries.begin();
+	return _entries.begin();
+}
+
+// Evicts the least recently used assets until the cache is within its budget. Assets that are
+// still being loaded or are in use by a model are skipped, so the cache can stay over budget
+void AssetCache::Evict()
+{
+	size_t used = GetMemoryUsed();
+	for (auto entry = _entries.end(); used > _memoryBudget && entry != _entries.begin();)
+	{
+		--entry;
+		if (!IsReady(*entry) || entry->asset.get().use_count() > 1)
+		{
+			continue;
+		}
+		if (entry->asset.get())
+		{
+			used -= entry->asset.get()->GetMemorySize();
+		}
+		_index.erase(entry->key);
+		entry = _entries.erase(entry);
+	}
+}
+
+// Called when a load has finished. Failures are not cached, so that a file that is fixed can be
+// loaded later
+void AssetCache::Complete(const std::string& key, const std::shared_ptr<const ModelAsset>& asset)
+{
+	if (!asset)
+	{
+		auto found = _index.find(key);
+		if (found != _index.end() && IsReady(*found->second) && !found->second->asset.get())
+		{
+			_entries.erase(found->second);
+			_index.erase(found);
+		}
+		return;
+	}
+	Evict();
+}
+
+// File paths can not contain a newline, so it separates the two paths
+std::string AssetCache::MakeKey(const char* modelPath, const char* texturePath)
+{
+	std::string key = modelPath;
+	key += '\n';
+	if (texturePath)
+	{
+		key += texturePath;
+	}
+	return key;
+}
+
+bool AssetCache::IsReady(const Entry& entry)
+{
+	return entry.asset.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+}
+
+// A baked mesh is used if there is one that is up to date, otherwise the MD2 file is loaded
+
+std::shared_ptr<const ModelAsset> AssetCache::LoadAsset(const std::string& modelPath, const std::string& texturePath)
+{
+	const char* textureFilename = texturePath.empty() ? nullptr : texturePath.c_str();
+	std::string meshPath = BakedMesh::GetBakedPath(modelPath);
+	if (BakedMesh::IsUpToDate(meshPath, modelPath))
+	{
+		std::shared_ptr<ModelAsset> baked = std::make_shared<ModelAsset>();
+		if (BakedMesh::Read(meshPath.c_str(), textureFilename, *baked))
+		{
+			baked->CalculateBounds();
+			return baked;
+		}
+	}
+
+	std::shared_ptr<ModelAsset> asset = std::make_shared<ModelAsset>();
+	if (!MD2Loader::LoadModel(modelPath.c_str(), textureFilename, *asset,
+		&ModelAsset::AddPolygon,
+		&ModelAsset::AddVertex,
+		&ModelAsset::AddTextureUV,
+		&ModelAsset::AddFrame))
+	{
+		return nullptr;
+	}
+	asset->CalculateNormals();
+	asset->CalculateBounds();
+	return asset;
+}
@@ -0,0 +1,79 @@
+#pragma once
+#include "ModelAsset.h"
+#include <cstddef>
+#include <functional>
+#include <future>
+#include <list>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Keeps loaded model assets in memory, keyed by the paths of the model and texture files, so
+// that switching back to a model that was used before does not touch the disk. Assets can be
+// prefetched on a background thread before they are needed.
+//
+// Assets can also be loaded asynchronously, with a callback that is called from Update once the
+// asset is ready. Loading then never blocks the thread that uses the cache.
+//
+// When the assets in the cache use more memory than the budget, the least recently used assets
+// that are not in use by any Model are evicted. The cache itself is only used from one thread.
+class AssetCache
+{
+public:
+	// Called with the asset once an asynchronous load has finished, or nullptr if it failed
+	typedef std::function<void(const std::shared_ptr<const ModelAsset>& asset)> LoadedCallback;
+
+	AssetCache();
+	~AssetCache();
+
+	// Memory budget in bytes
+	void		SetMemoryBudget(size_t bytes);
+	size_t		GetMemoryBudget() const;
+	// Bytes used by the loaded assets in the cache
+	size_t		GetMemoryUsed() const;
+
+	// Returns the asset for the files, loading it first if it is not in the cache. If it is
+	// being prefetched, this waits for that to finish. Returns nullptr if it could not be loaded.
+	// texturePath may be nullptr for models without a texture
+	std::shared_ptr<const ModelAsset> Load(const char* modelPath, const char* texturePath);
+	// Starts loading the asset on a background thread if it is not already in the cache
+	void		Prefetch(const char* modelPath, const char* texturePath);
+	// As Prefetch, then calls onLoaded with the asset. If the asset is already loaded this is done
+	// straight away, otherwise it is done by the first call to Update after it has loaded
+	void		LoadAsync(const char* modelPath, const char* texturePath, const LoadedCallback& onLoaded);
+	// Calls the callbacks of asynchronous loads that have finished. Should be called every frame
+	void		Update();
+	// Removes every asset that is not being prefetched
+	void		Clear();
+
+	// Loads an asset from its files without using a cache. Returns nullptr on failure
+	static std::shared_ptr<const ModelAsset> LoadAsset(const std::string& modelPath, const std::string& texturePath);
+
+private:
+	struct Entry
+	{
+		std::string	key;
+		std::shared_future<std::shared_ptr<const ModelAsset>> asset;
+	};
+
+	struct PendingLoad
+	{
+		std::string	key;
+		std::shared_future<std::shared_ptr<const ModelAsset>> asset;
+		LoadedCallback onLoaded;
+	};
+
+	size_t				_memoryBudget;
+	// Most recently used first
+	std::list<Entry>	_entries;
+	std::unordered_map<std::string, std::list<Entry>::iterator> _index;
+	// Asynchronous loads waiting for their callbacks
+	std::vector<PendingLoad> _pendingLoads;
+
+	std::list<Entry>::iterator Find(const char* modelPath, const char* texturePath, bool prefetch);
+	void		Evict();
+	void		Complete(const std::string& key, const std::shared_ptr<const ModelAsset>& asset);
+	static std::string MakeKey(const char* modelPath, const char* texturePath);
+	static bool	IsReady(const Entry& entry);
+};
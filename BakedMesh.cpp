@@ -0,0 +1,445 @@
+#include "BakedMesh.h"
+#include "MD2Loader.h"
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <unordered_map>
+#include <vector>
+
+#ifndef _WIN32
+#include <dirent.h>
+#include <sys/stat.h>
+#endif
+
+// Magic number at the start of every baked mesh
+const char BAKED_MESH_MAGIC[4] = { 'B', 'M', 'S', 'H' };
+
+// Number of vertices in a stream once it is padded to a multiple of four
+static size_t PaddedCount(size_t count)
+{
+	return (count + 3) & ~size_t(3);
+}
+
+// Returns true if count elements of elementSize bytes starting at offset are inside the file
+static bool InFile(const MappedFile& file, unsigned long long offset, unsigned long long count, unsigned long long elementSize)
+{
+	return offset + count * elementSize <= file.GetSize();
+}
+
+// Appends a section to the file being built, starting on the next 16 byte boundary, and
+// returns its offset
+static uint32_t AppendSection(std::vector<uint8_t>& buffer, const void* data, size_t size)
+{
+	buffer.resize((buffer.size() + 15) & ~size_t(15), 0);
+	uint32_t offset = static_cast<uint32_t>(buffer.size());
+	const uint8_t* bytes = static_cast<const uint8_t*>(data);
+	buffer.insert(buffer.end(), bytes, bytes + size);
+	return offset;
+}
+
+#ifdef _WIN32
+
+// Gets the time a file was last written to
+static bool GetModifiedTime(const std::string& path, unsigned long long& time)
+{
+	WIN32_FILE_ATTRIBUTE_DATA attributes;
+	if (!GetFileAttributesExA(path.c_str(), GetFileExInfoStandard, &attributes))
+	{
+		return false;
+	}
+	time = (static_cast<unsigned long long>(attributes.ftLastWriteTime.dwHighDateTime) << 32) | attributes.ftLastWriteTime.dwLowDateTime;
+	return true;
+}
+
+// Gets the names of the files in a directory
+static bool ListFiles(const std::string& directory, std::vector<std::string>& names)
+{
+	WIN32_FIND_DATAA findData;
+	HANDLE find = FindFirstFileA((directory + "\\*").c_str(), &findData);
+	if (find == INVALID_HANDLE_VALUE)
+	{
+		return false;
+	}
+	do
+	{
+		if ((findData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) == 0)
+		{
+			names.push_back(findData.cFileName);
+		}
+	} while (FindNextFileA(find, &findData));
+	FindClose(find);
+	return true;
+}
+
+#else
+
+static bool GetModifiedTime(const std::string& path, unsigned long long& time)
+{
+	struct stat status;
+	if (stat(path.c_str(), &status) != 0)
+	{
+		return false;
+	}
+	time = static_cast<unsigned long long>(status.st_mtime);
+	return true;
+}
+
+static bool ListFiles(const std::string& directory, std::vector<std::string>& names)
+{
+	DIR* dir = opendir(directory.c_str());
+	if (dir == nullptr)
+	{
+		return false;
+	}
+	while (dirent* entry = readdir(dir))
+	{
+		struct stat status;
+		std::string path = directory + "/" + entry->d_name;
+		if (stat(path.c_str(), &status) == 0 && S_ISREG(status.st_mode))
+		{
+			names.push_back(entry->d_name);
+		}
+	}
+	closedir(dir);
+	return true;
+}
+
+#endif
+
+// Merges the vertices and texture coordinates that are used more than once, then writes the
+// asset out section by section
+
+bool BakedMesh::Write(const ModelAsset& model, const char* meshFilename)
+{
+	const VertexBuffer& vertices = model._vertices;
+	const Keyframes& keyframes = model._keyframes;
+	const std::vector<UVPair>& uvPairs = model._uvPairs;
+	size_t vertexCount = vertices.GetCount();
+	size_t frameCount = keyframes.GetFrameCount();
+	if (frameCount > 0 && keyframes.GetVertexCount() != vertexCount)
+	{
+		return false;
+	}
+
+	// Vertices can only be merged if they are the same in every frame and have the same normal,
+	// so each one is keyed by its position, normal and the bytes of every frame
+	std::vector<int32_t> vertexRemap(vertexCount);
+	std::vector<size_t> uniqueVertices;
+	std::unordered_map<std::string, int32_t> vertexIndices;
+	for (size_t i = 0; i < vertexCount; i++)
+	{
+		float attributes[6] = { vertices.GetX()[i], vertices.GetY()[i], vertices.GetZ()[i],
+								vertices.GetNormalX()[i], vertices.GetNormalY()[i], vertices.GetNormalZ()[i] };
+		std::string key(reinterpret_cast<const char*>(attributes), sizeof(attributes));
+		for (size_t frame = 0; frame < frameCount; frame++)
+		{
+			for (int stream = 0; stream < KEYFRAME_STREAMS; stream++)
+			{
+				key.push_back(static_cast<char>(keyframes.GetCoordinates(frame, stream)[i]));
+			}
+		}
+		auto inserted = vertexIndices.emplace(key, static_cast<int32_t>(uniqueVertices.size()));
+		if (inserted.second)
+		{
+			uniqueVertices.push_back(i);
+		}
+		vertexRemap[i] = inserted.first->second;
+	}
+
+	std::vector<int32_t> uvRemap(uvPairs.size());
+	std::vector<float> uvs;
+	std::unordered_map<std::string, int32_t> uvIndices;
+	for (size_t i = 0; i < uvPairs.size(); i++)
+	{
+		float uv[2] = { uvPairs[i].GetU(), uvPairs[i].GetV() };
+		auto inserted = uvIndices.emplace(std::string(reinterpret_cast<const char*>(uv), sizeof(uv)), static_cast<int32_t>(uvs.size() / 2));
+		if (inserted.second)
+		{
+			uvs.insert(uvs.end(), uv, uv + 2);
+		}
+		uvRemap[i] = inserted.first->second;
+	}
+
+	// Index buffers
+	std::vector<int32_t> polygonIndices;
+	std::vector<int32_t> polygonUVIndices;
+	polygonIndices.reserve(model._polygons.size() * 3);
+	polygonUVIndices.reserve(model._polygons.size() * 3);
+	for (const Polygon3D& poly : model._polygons)
+	{
+		for (int j = 0; j < 3; j++)
+		{
+			int index = poly.GetIndex(j);
+			int uvIndex = poly.GetUVIndex(j);
+			if (index < 0 || static_cast<size_t>(index) >= vertexCount)
+			{
+				return false;
+			}
+			// Models without texture coordinates never use their texture coordinate indices
+			if (!uvPairs.empty())
+			{
+				if (uvIndex < 0 || static_cast<size_t>(uvIndex) >= uvPairs.size())
+				{
+					return false;
+				}
+				uvIndex = uvRemap[uvIndex];
+			}
+			polygonIndices.push_back(vertexRemap[index]);
+			polygonUVIndices.push_back(uvIndex);
+		}
+	}
+
+	// Vertex streams, with the padding left at zero
+	size_t uniqueCount = uniqueVertices.size();
+	size_t paddedCount = PaddedCount(uniqueCount);
+	std::vector<float> positions(paddedCount * 3, 0.0f);
+	std::vector<float> normals(paddedCount * 3, 0.0f);
+	for (size_t i = 0; i < uniqueCount; i++)
+	{
+		size_t source = uniqueVertices[i];
+		positions[i] = vertices.GetX()[source];
+		positions[paddedCount + i] = vertices.GetY()[source];
+		positions[paddedCount * 2 + i] = vertices.GetZ()[source];
+		normals[i] = vertices.GetNormalX()[source];
+		normals[paddedCount + i] = vertices.GetNormalY()[source];
+		normals[paddedCount * 2 + i] = vertices.GetNormalZ()[source];
+	}
+
+	// Frames, with their streams laid out the same way as Keyframes holds them
+	std::vector<BakedMeshFrame> frames(frameCount);
+	std::vector<uint8_t> frameData(frameCount * KEYFRAME_STREAMS * paddedCount, 0);
+	for (size_t frame = 0; frame < frameCount; frame++)
+	{
+		const Keyframes::Frame& source = keyframes._frames[frame];
+		BakedMeshFrame& bakedFrame = frames[frame];
+		memset(bakedFrame.name, 0, sizeof(bakedFrame.name));
+		memcpy(bakedFrame.name, source.name.c_str(), std::min(source.name.size(), sizeof(bakedFrame.name)));
+		memcpy(bakedFrame.scale, source.scale, sizeof(bakedFrame.scale));
+		memcpy(bakedFrame.translate, source.translate, sizeof(bakedFrame.translate));
+		for (int stream = 0; stream < KEYFRAME_STREAMS; stream++)
+		{
+			const uint8_t* coordinates = keyframes.GetCoordinates(frame, stream);
+			uint8_t* output = &frameData[(frame * KEYFRAME_STREAMS + stream) * paddedCount];
+			for (size_t i = 0; i < uniqueCount; i++)
+			{
+				output[i] = coordinates[uniqueVertices[i]];
+			}
+		}
+	}
+
+	BakedMeshHeader header;
+	memcpy(header.magic, BAKED_MESH_MAGIC, sizeof(header.magic));
+	header.version = BAKED_MESH_VERSION;
+	header.vertexCount = static_cast<uint32_t>(uniqueCount);
+	header.polygonCount = static_cast<uint32_t>(model._polygons.size());
+	header.uvCount = static_cast<uint32_t>(uvs.size() / 2);
+	header.frameCount = static_cast<uint32_t>(frameCount);
+	header.skinWidth = model._skinWidth;
+	header.skinHeight = model._skinHeight;
+
+	std::vector<uint8_t> buffer(sizeof(BakedMeshHeader));
+	header.positionsOffset = AppendSection(buffer, positions.data(), positions.size() * sizeof(float));
+	header.normalsOffset = AppendSection(buffer, normals.data(), normals.size() * sizeof(float));
+	header.indicesOffset = AppendSection(buffer, polygonIndices.data(), polygonIndices.size() * sizeof(int32_t));
+	header.uvIndicesOffset = AppendSection(buffer, polygonUVIndices.data(), polygonUVIndices.size() * sizeof(int32_t));
+	header.uvsOffset = AppendSection(buffer, uvs.data(), uvs.size() * sizeof(float));
+	header.framesOffset = AppendSection(buffer, frames.data(), frames.size() * sizeof(BakedMeshFrame));
+	header.frameDataOffset = AppendSection(buffer, frameData.data(), frameData.size());
+	header.fileSize = static_cast<uint32_t>(buffer.size());
+	memcpy(buffer.data(), &header, sizeof(header));
+
+	std::ofstream file(meshFilename, std::ios::out | std::ios::binary);
+	if (!file)
+	{
+		return false;
+	}
+	file.write(reinterpret_cast<const char*>(buffer.data()), buffer.size());
+	return file.good();
+}
+
+// Maps the file into the asset, which keeps it open for as long as the keyframes point into it
+
+bool BakedMesh::Read(const char* meshFilename, const char* textureFilename, ModelAsset& model)
+{
+	MappedFile& file = model._file;
+	if (!file.Open(meshFilename) || file.GetSize() < sizeof(BakedMeshHeader))
+	{
+		return false;
+	}
+	const uint8_t* data = file.GetData();
+	BakedMeshHeader header;
+	memcpy(&header, data, sizeof(header));
+	if (memcmp(header.magic, BAKED_MESH_MAGIC, sizeof(header.magic)) != 0 ||
+		header.version != BAKED_MESH_VERSION ||
+		header.fileSize != file.GetSize())
+	{
+		return false;
+	}
+
+	// Check that every section is inside the file
+	size_t vertexCount = header.vertexCount;
+	size_t paddedCount = PaddedCount(vertexCount);
+	if (!InFile(file, header.positionsOffset, paddedCount * 3, sizeof(float)) ||
+		!InFile(file, header.normalsOffset, paddedCount * 3, sizeof(float)) ||
+		!InFile(file, header.indicesOffset, header.polygonCount * 3ULL, sizeof(int32_t)) ||
+		!InFile(file, header.uvIndicesOffset, header.polygonCount * 3ULL, sizeof(int32_t)) ||
+		!InFile(file, header.uvsOffset, header.uvCount * 2ULL, sizeof(float)) ||
+		!InFile(file, header.framesOffset, header.frameCount, sizeof(BakedMeshFrame)) ||
+		!InFile(file, header.frameDataOffset, header.frameCount * static_cast<unsigned long long>(KEYFRAME_STREAMS) * paddedCount, 1))
+	{
+		return false;
+	}
+
+	// Vertex streams are copied straight into the vertex buffer
+	VertexBuffer& vertices = model._vertices;
+	vertices.Resize(vertexCount);
+	size_t streamSize = paddedCount * sizeof(float);
+	const uint8_t* positions = data + header.positionsOffset;
+	const uint8_t* normals = data + header.normalsOffset;
+	memcpy(vertices.GetX(), positions, streamSize);
+	memcpy(vertices.GetY(), positions + streamSize, streamSize);
+	memcpy(vertices.GetZ(), positions + streamSize * 2, streamSize);
+	memcpy(vertices.GetNormalX(), normals, streamSize);
+	memcpy(vertices.GetNormalY(), normals + streamSize, streamSize);
+	memcpy(vertices.GetNormalZ(), normals + streamSize * 2, streamSize);
+
+	// Polygons, checking that every index is in range
+	const uint8_t* indices = data + header.indicesOffset;
+	const uint8_t* uvIndices = data + header.uvIndicesOffset;
+	model._polygons.reserve(header.polygonCount);
+	for (size_t i = 0; i < header.polygonCount; i++)
+	{
+		int32_t index[3];
+		int32_t uvIndex[3];
+		memcpy(index, indices + sizeof(index) * i, sizeof(index));
+		memcpy(uvIndex, uvIndices + sizeof(uvIndex) * i, sizeof(uvIndex));
+		for (int j = 0; j < 3; j++)
+		{
+			if (index[j] < 0 || static_cast<size_t>(index[j]) >= vertexCount ||
+				(header.uvCount > 0 && (uvIndex[j] < 0 || static_cast<uint32_t>(uvIndex[j]) >= header.uvCount)))
+			{
+				return false;
+			}
+		}
+		model._polygons.push_back(Polygon3D(index[0], index[1], index[2], uvIndex[0], uvIndex[1], uvIndex[2]));
+	}
+
+	const uint8_t* uvs = data + header.uvsOffset;
+	model._uvPairs.reserve(header.uvCount);
+	for (size_t i = 0; i < header.uvCount; i++)
+	{
+		float uv[2];
+		memcpy(uv, uvs + sizeof(uv) * i, sizeof(uv));
+		model._uvPairs.push_back(UVPair(uv[0], uv[1]));
+	}
+
+	// The keyframes use the frame data in place
+	Keyframes& keyframes = model._keyframes;
+	keyframes.Clear();
+	if (header.frameCount > 0)
+	{
+		keyframes._vertexCount = vertexCount;
+		keyframes._paddedCount = paddedCount;
+		keyframes._frames.resize(header.frameCount);
+		for (size_t i = 0; i < header.frameCount; i++)
+		{
+			BakedMeshFrame bakedFrame;
+			memcpy(&bakedFrame, data + header.framesOffset + sizeof(BakedMeshFrame) * i, sizeof(bakedFrame));
+			Keyframes::Frame& frame = keyframes._frames[i];
+			frame.name.assign(bakedFrame.name, std::find(bakedFrame.name, bakedFrame.name + sizeof(bakedFrame.name), '\0'));
+			memcpy(frame.scale, bakedFrame.scale, sizeof(frame.scale));
+			memcpy(frame.translate, bakedFrame.translate, sizeof(frame.translate));
+		}
+		keyframes._coordinateData = data + header.frameDataOffset;
+		keyframes.OrientNormals(vertices);
+	}
+
+	model._skinWidth = header.skinWidth;
+	model._skinHeight = header.skinHeight;
+	return !textureFilename || MD2Loader::LoadTexture(textureFilename, model._texture, header.skinWidth, header.skinHeight);
+}
+
+std::string BakedMesh::GetBakedPath(const std::string& modelPath)
+{
+	size_t extension = modelPath.find_last_of("./\\");
+	if (extension == std::string::npos || modelPath[extension] != '.')
+	{
+		return modelPath + ".mesh";
+	}
+	return modelPath.substr(0, extension) + ".mesh";
+}
+
+bool BakedMesh::IsUpToDate(const std::string& meshPath, const std::string& modelPath)
+{
+	unsigned long long meshTime;
+	unsigned long long modelTime;
+	if (!GetModifiedTime(meshPath, meshTime))
+	{
+		return false;
+	}
+	// A baked mesh can still be used if the model it was made from is not there
+	return !GetModifiedTime(modelPath, modelTime) || meshTime >= modelTime;
+}
+
+// The extension is compared without regard to case, since some of the models are .MD2
+
+bool BakedMesh::FindModels(const std::string& directory, std::vector<std::string>& names)
+{
+	std::vector<std::string> files;
+	if (!ListFiles(directory, files))
+	{
+		return false;
+	}
+	std::sort(files.begin(), files.end());
+	for (const std::string& name : files)
+	{
+		std::string extension = name.substr(std::min(name.find_last_of('.'), name.size()));
+		std::transform(extension.begin(), extension.end(), extension.begin(), [](char c) { return static_cast<char>(tolower(static_cast<unsigned char>(c))); });
+		if (extension == ".md2")
+		{
+			names.push_back(name);
+		}
+	}
+	return true;
+}
+
+// Loads each model the same way as it is loaded when it is not baked, then writes it out
+
+bool BakedMesh::ConvertDirectory(const std::string& directory)
+{
+	std::vector<std::string> names;
+	if (!FindModels(directory, names))
+	{
+		std::cerr << "Unable to read directory " << directory << std::endl;
+		return false;
+	}
+
+	bool converted = true;
+	for (const std::string& name : names)
+	{
+		std::string modelPath = directory + "/" + name;
+		std::string meshPath = GetBakedPath(modelPath);
+		ModelAsset model;
+		if (!MD2Loader::LoadModel(modelPath.c_str(), nullptr, model,
+			&ModelAsset::AddPolygon,
+			&ModelAsset::AddVertex,
+			&ModelAsset::AddTextureUV,
+			&ModelAsset::AddFrame))
+		{
+			std::cerr << "Unable to load " << modelPath << std::endl;
+			converted = false;
+			continue;
+		}
+		model.CalculateNormals();
+		if (!Write(model, meshPath.c_str()))
+		{
+			std::cerr << "Unable to write " << meshPath << std::endl;
+			converted = false;
+			continue;
+		}
+		std::cout << "Baked " << modelPath << " to " << meshPath << std::endl;
+	}
+	return converted;
+}
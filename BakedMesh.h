@@ -0,0 +1,68 @@
+#pragma once
+#include "ModelAsset.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Version of the baked mesh format. This must be changed whenever the layout changes, so that
+// baked files written by older builds are ignored and the MD2 file is loaded instead
+const uint32_t BAKED_MESH_VERSION = 1;
+
+// Header at the start of a baked mesh file. Each section starts on a 16 byte boundary at the
+// offset given in the header, and the file is little endian like an MD2 file
+struct BakedMeshHeader
+{
+	char		magic[4];			// "BMSH"
+	uint32_t	version;			// BAKED_MESH_VERSION
+	uint32_t	vertexCount;
+	uint32_t	polygonCount;
+	uint32_t	uvCount;
+	uint32_t	frameCount;
+	int32_t		skinWidth;
+	int32_t		skinHeight;
+	uint32_t	positionsOffset;	// x, y and z streams of floats, each padded to a multiple of four
+	uint32_t	normalsOffset;		// x, y and z streams of floats, padded the same way
+	uint32_t	indicesOffset;		// Three vertex indices per polygon
+	uint32_t	uvIndicesOffset;	// Three texture coordinate indices per polygon
+	uint32_t	uvsOffset;			// u and v floats for each texture coordinate
+	uint32_t	framesOffset;		// A BakedMeshFrame for each frame
+	uint32_t	frameDataOffset;	// Quantised frames, laid out as they are held by Keyframes
+	uint32_t	fileSize;
+};
+
+// Name, scale and translation of a frame, with y and z already swapped so that y is up
+struct BakedMeshFrame
+{
+	char		name[16];
+	float		scale[3];
+	float		translate[3];
+};
+
+// Reads and writes meshes in a baked binary format. A baked mesh holds everything that loading
+// an MD2 file works out: vertices shared by several polygons are merged, positions are already
+// dequantised and swapped to y up, and normals are already calculated. Loading one is a handful
+// of bulk copies, and the animation frames, which are most of the file, are used in place from
+// the mapped file without being copied at all.
+//
+// The texture is not baked, because which texture a model is drawn with is only decided when it
+// is loaded. It is still read from its PCX file
+class BakedMesh
+{
+public:
+	// Writes the asset to a baked mesh file. The asset must have its normals calculated
+	static bool			Write(const ModelAsset& model, const char* meshFilename);
+	// Reads a baked mesh file into an empty asset, along with the texture if one is given.
+	// Returns false if the file is missing, damaged or from another version of the format, or
+	// if the texture cannot be loaded
+	static bool			Read(const char* meshFilename, const char* textureFilename, ModelAsset& model);
+	// Returns the path of the baked mesh for a model file, which has the extension .mesh
+	static std::string	GetBakedPath(const std::string& modelPath);
+	// Returns true if the baked mesh exists and is not older than the model file it was made from
+	static bool			IsUpToDate(const std::string& meshPath, const std::string& modelPath);
+	// Gets the names of the MD2 files in a directory, in alphabetical order. Returns false if the
+	// directory could not be read
+	static bool			FindModels(const std::string& directory, std::vector<std::string>& names);
+	// Bakes every MD2 file in a directory, writing each baked mesh next to its model file.
+	// Returns false if the directory could not be read or any model could not be baked
+	static bool			ConvertDirectory(const std::string& directory);
+};
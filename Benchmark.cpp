@@ -0,0 +1,121 @@
+#include "Benchmark.h"
+#include "BakedMesh.h"
+#include "Profiler.h"
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <thread>
+
+std::vector<Benchmark::Size> Benchmark::GetDefaultSizes()
+{
+	return { { 320, 240 }, { 640, 480 }, { 1280, 720 } };
+}
+
+// A model is drawn with the PCX file of the same name next to it, if there is one
+
+bool Benchmark::Run(Framework& framework, const std::string& modelDirectory, const std::vector<Size>& sizes, int frames, std::ostream& output)
+{
+	std::vector<std::string> names;
+	if (!BakedMesh::FindModels(modelDirectory, names) || names.empty())
+	{
+		std::cerr << "No models found in " << modelDirectory << std::endl;
+		return false;
+	}
+
+	output << "model,width,height,threads,stage,draw_mode,frames,milliseconds,fps,ns_per_pixel,ns_per_triangle" << std::endl;
+	for (const Size& size : sizes)
+	{
+		if (!framework.GetBitmap().Create(size.width, size.height))
+		{
+			std::cerr << "Unable to create a " << size.width << "x" << size.height << " bitmap" << std::endl;
+			return false;
+		}
+		for (const std::string& name : names)
+		{
+			if (!RunModel(framework, modelDirectory + "/" + name, name, size, frames, output))
+			{
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+bool Benchmark::RunModel(Framework& framework, const std::string& modelPath, const std::string& modelName, const Size& size, int frames, std::ostream& output)
+{
+	unsigned int threads = framework.GetThreadCount();
+	if (threads == 0)
+	{
+		threads = std::thread::hardware_concurrency();
+	}
+	std::string texturePath = modelPath.substr(0, modelPath.find_last_of('.')) + ".pcx";
+	if (!std::ifstream(texturePath))
+	{
+		texturePath.clear();
+	}
+	if (!framework.Restart(modelPath, texturePath))
+	{
+		std::cerr << "Unable to load " << modelPath << std::endl;
+		return false;
+	}
+
+	// Timings of each stage and draw mode, in the order they first appear
+	struct Group
+	{
+		FrameDescription description;
+		int frames;
+		double seconds;
+	};
+	std::vector<Group> groups;
+
+	Bitmap& bitmap = framework.GetBitmap();
+	double totalTime = 0;
+	for (int frame = 0; frame < frames; frame++)
+	{
+		auto startTime = std::chrono::steady_clock::now();
+		framework.Update(bitmap);
+		framework.Render(bitmap);
+		auto endTime = std::chrono::steady_clock::now();
+		PROFILE_END_FRAME();
+		double seconds = std::chrono::duration<double>(endTime - startTime).count();
+		totalTime += seconds;
+
+		FrameDescription description = framework.DescribeFrame();
+		Group* group = nullptr;
+		for (Group& existing : groups)
+		{
+			if (existing.description.stage == description.stage && existing.description.drawMode == description.drawMode)
+			{
+				group = &existing;
+				break;
+			}
+		}
+		if (group == nullptr)
+		{
+			groups.push_back({ description, 0, 0 });
+			group = &groups.back();
+		}
+		group->frames++;
+		group->seconds += seconds;
+	}
+
+	double pixels = double(size.width) * double(size.height);
+	for (const Group& group : groups)
+	{
+		double nanoseconds = group.seconds * 1e9 / group.frames;
+		output << modelName << ',' << size.width << ',' << size.height << ',' << threads << ','
+			   << '"' << group.description.stage << "\",\"" << group.description.drawMode << "\"," << group.frames << ','
+			   << group.seconds * 1000.0 << ',' << group.frames / group.seconds << ','
+			   << nanoseconds / pixels << ',';
+		if (group.description.triangles > 0)
+		{
+			output << nanoseconds / double(group.description.triangles);
+		}
+		output << std::endl;
+	}
+	if (totalTime > 0)
+	{
+		std::cerr << modelName << " " << size.width << "x" << size.height << ": " << frames / totalTime << " fps" << std::endl;
+	}
+	return true;
+}
@@ -0,0 +1,40 @@
+#pragma once
+#include "Framework.h"
+#include <ostream>
+#include <string>
+#include <vector>
+
+// Replays the demo without a window to measure how fast the renderer draws each stage, run
+// from the headless platform with --benchmark FILE. The demo is driven by a frame counter and
+// each model is loaded before its run starts, so every run draws exactly the same frames and
+// results from different builds can be compared directly.
+//
+// The demo is run once for every model in the models directory at each size. Frames are
+// grouped by the stage of the demo and the draw mode, and each group is written as a line of
+// comma separated values, with the stage and draw mode quoted, in the columns:
+//
+//   model, width, height, threads, stage, draw_mode, frames, milliseconds, fps, ns_per_pixel,
+//   ns_per_triangle
+//
+// Times cover Update and Render. ns_per_pixel divides them by the pixels in the bitmap and
+// ns_per_triangle by the triangles in the model, whether or not they were culled
+class Benchmark
+{
+public:
+	struct Size
+	{
+		unsigned int width;
+		unsigned int height;
+	};
+
+	// Sizes used when none are given
+	static std::vector<Size> GetDefaultSizes();
+
+	// Runs the benchmark, writing the results to output. Returns false if the models could not
+	// be found or a model could not be loaded
+	static bool Run(Framework& framework, const std::string& modelDirectory, const std::vector<Size>& sizes, int frames, std::ostream& output);
+
+private:
+	// Runs the demo once with a model at one size
+	static bool RunModel(Framework& framework, const std::string& modelPath, const std::string& modelName, const Size& size, int frames, std::ostream& output);
+};
@@ -1,4 +1,7 @@
 #include "Bitmap.h"
+#include <algorithm>
+#include <fstream>
+#include <vector>
 
 Bitmap::Bitmap()
 {
@@ -10,8 +13,12 @@ Bitmap::~Bitmap()
 	DeleteBitmap();
 }
 
+#ifndef RASTERISER_HEADLESS
 // Create a new bitmap of the specified width and height, deleting any existing bitmap
 //
+// The bitmap is created as a top-down 32-bit DIB section so that we can write to the
+// pixels directly as well as using GDI calls on the device context.
+//
 // Returns value of false if bitmap cannot be created.
 
 bool Bitmap::Create(HWND hWnd, unsigned int width, unsigned int height)
@@ -29,12 +36,26 @@ bool Bitmap::Create(HWND hWnd, unsigned int width, unsigned int height)
 	_hMemDC = CreateCompatibleDC(hDc);
 	if (_hMemDC != 0)
 	{
-		// Create a bitmap compatible with the window
-		_hBitmap = CreateCompatibleBitmap(hDc, _width, _height);
+		// Describe a 32 bits per pixel bitmap. A negative height gives us a top-down
+		// bitmap so that row 0 is at the top of the window
+		BITMAPINFO bitmapInfo = {};
+		bitmapInfo.bmiHeader.biSize = sizeof(BITMAPINFOHEADER);
+		bitmapInfo.bmiHeader.biWidth = static_cast<LONG>(_width);
+		bitmapInfo.bmiHeader.biHeight = -static_cast<LONG>(_height);
+		bitmapInfo.bmiHeader.biPlanes = 1;
+		bitmapInfo.bmiHeader.biBitCount = 32;
+		bitmapInfo.bmiHeader.biCompression = BI_RGB;
+
+		void* bits = nullptr;
+		_hBitmap = CreateDIBSection(hDc, &bitmapInfo, DIB_RGB_COLORS, &bits, NULL, 0);
 		if (_hBitmap != 0)
 		{
 			// Select the bitmap into the new device context, saving any old bitmap handle
 			_hOldBitmap = static_cast<HBITMAP>(SelectObject(_hMemDC, _hBitmap));
+			_pixels = static_cast<uint32_t*>(bits);
+			// Rows of a 32-bit DIB are always DWORD aligned, so the pitch is the width
+			_pitch = _width;
+			CreateDepthBuffer();
 			status = true;
 		}
 	}
@@ -49,6 +70,28 @@ HDC Bitmap::GetDC() const
 {
 	return _hMemDC;
 }
+#endif
+
+// Create a new bitmap of the specified width and height that is not attached to a window.
+// Only the pixel buffer is available, so GetDC will return 0.
+
+bool Bitmap::Create(unsigned int width, unsigned int height)
+{
+	// Delete any existing bitmap
+	DeleteBitmap();
+
+	_width = width;
+	_height = height;
+	_pitch = width;
+	if (_width == 0 || _height == 0)
+	{
+		return false;
+	}
+	_ownedPixels = new uint32_t[_pitch * _height];
+	_pixels = _ownedPixels;
+	CreateDepthBuffer();
+	return true;
+}
 
 // Return width of bitmap
 
@@ -64,17 +107,32 @@ unsigned int Bitmap::GetHeight() const
 	return _height;
 }
 
+// Return pointer to the first pixel of the bitmap. Each pixel is stored as 0x00RRGGBB
+
+uint32_t* Bitmap::GetPixels() const
+{
+	return _pixels;
+}
+
+// Return number of pixels from the start of one row to the start of the next
+
+unsigned int Bitmap::GetPitch() const
+{
+	return _pitch;
+}
+
 // Delete any existing bitmap
 
 void Bitmap::DeleteBitmap()
 {
+#ifndef RASTERISER_HEADLESS
 	// Select any default bitmap that existed for the device context
 	if (_hOldBitmap != 0 && _hMemDC != 0)
 	{
 		SelectObject(_hMemDC, _hOldBitmap);
 		_hOldBitmap = 0;
 	}
-	// Delete any existing bitmap
+	// Delete any existing bitmap (this also frees the DIB section pixels)
 	if (_hBitmap != 0)
 	{
 		DeleteObject(_hBitmap);
@@ -86,8 +144,65 @@ void Bitmap::DeleteBitmap()
 		DeleteDC(_hMemDC);
 		_hMemDC = 0;
 	}
+#endif
+	// Delete any pixel buffer we allocated ourselves
+	if (_ownedPixels != nullptr)
+	{
+		delete[] _ownedPixels;
+		_ownedPixels = nullptr;
+	}
+	// Delete any depth buffer
+	if (_depth != nullptr)
+	{
+		delete[] _depth;
+		_depth = nullptr;
+	}
+	_pixels = nullptr;
+	_pitch = 0;
+}
+
+// Allocate a depth buffer the same size as the pixels if one has been requested
+
+void Bitmap::CreateDepthBuffer()
+{
+	if (_depth != nullptr)
+	{
+		delete[] _depth;
+		_depth = nullptr;
+	}
+	if (_depthEnabled && _pixels != nullptr)
+	{
+		_depth = new float[_pitch * _height];
+		ClearDepth();
+	}
+}
+
+// Attach or remove a depth buffer. Once enabled, it is recreated whenever the bitmap is
+
+void Bitmap::SetDepthBuffer(bool enabled)
+{
+	_depthEnabled = enabled;
+	CreateDepthBuffer();
 }
 
+// Return true if the bitmap has a depth buffer
+
+bool Bitmap::HasDepthBuffer() const
+{
+	return _depth != nullptr;
+}
+
+// Reset the depth buffer so that everything is further away than any polygon
+
+void Bitmap::ClearDepth() const
+{
+	if (_depth != nullptr)
+	{
+		std::fill(_depth, _depth + _pitch * _height, 0.0f);
+	}
+}
+
+#ifndef RASTERISER_HEADLESS
 // Clear bitmap using the specified brush
 
 void Bitmap::Clear(HBRUSH hBrush) const
@@ -100,12 +215,164 @@ void Bitmap::Clear(HBRUSH hBrush) const
 	rect.bottom = _height;
 	FillRect(_hMemDC, &rect, hBrush);
 }
+#endif
 
 // Clear bitmap using the specified colour
 
 void Bitmap::Clear(COLORREF colour) const
 {
-	HBRUSH brush = CreateSolidBrush(colour);
-	Clear(brush);
-	DeleteObject(brush);
+	if (_pixels == nullptr)
+	{
+		return;
+	}
+#ifndef RASTERISER_HEADLESS
+	// Make sure any outstanding GDI drawing has finished before we write to the pixels
+	if (_hMemDC != 0)
+	{
+		GdiFlush();
+	}
+#endif
+	std::fill(_pixels, _pixels + _pitch * _height, ToPixel(colour));
+}
+
+// Write the bitmap to a binary (P6) PPM file
+//
+// Returns false if the file could not be written
+
+bool Bitmap::SavePPM(const char* filename) const
+{
+	std::ofstream file(filename, std::ios::out | std::ios::binary);
+	if (file.fail() || _pixels == nullptr)
+	{
+		return false;
+	}
+	file << "P6\n" << _width << " " << _height << "\n255\n";
+
+	std::vector<unsigned char> row(_width * 3);
+	for (unsigned int y = 0; y < _height; y++)
+	{
+		const uint32_t* pixels = GetRow(y);
+		for (unsigned int x = 0; x < _width; x++)
+		{
+			row[x * 3] = static_cast<unsigned char>(pixels[x] >> 16);
+			row[x * 3 + 1] = static_cast<unsigned char>(pixels[x] >> 8);
+			row[x * 3 + 2] = static_cast<unsigned char>(pixels[x]);
+		}
+		file.write(reinterpret_cast<const char*>(row.data()), static_cast<std::streamsize>(row.size()));
+	}
+	return !file.fail();
+}
+
+// Helpers used to write PNG files. The image data is written using uncompressed
+// (stored) deflate blocks, so no compression library is needed
+
+static uint32_t PngCrc(const unsigned char* data, size_t length, uint32_t crc = 0xFFFFFFFF)
+{
+	static uint32_t table[256] = { 0 };
+	if (table[1] == 0)
+	{
+		for (uint32_t n = 0; n < 256; n++)
+		{
+			uint32_t c = n;
+			for (int k = 0; k < 8; k++)
+			{
+				c = (c & 1) ? 0xEDB88320 ^ (c >> 1) : c >> 1;
+			}
+			table[n] = c;
+		}
+	}
+	for (size_t i = 0; i < length; i++)
+	{
+		crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+	}
+	return crc;
+}
+
+static void PngWriteUInt(std::vector<unsigned char>& buffer, uint32_t value)
+{
+	buffer.push_back(static_cast<unsigned char>(value >> 24));
+	buffer.push_back(static_cast<unsigned char>(value >> 16));
+	buffer.push_back(static_cast<unsigned char>(value >> 8));
+	buffer.push_back(static_cast<unsigned char>(value));
+}
+
+static void PngWriteChunk(std::ofstream& file, const char* type, const std::vector<unsigned char>& data)
+{
+	std::vector<unsigned char> chunk;
+	PngWriteUInt(chunk, static_cast<uint32_t>(data.size()));
+	chunk.insert(chunk.end(), type, type + 4);
+	chunk.insert(chunk.end(), data.begin(), data.end());
+	// CRC covers the chunk type and data but not the length
+	PngWriteUInt(chunk, PngCrc(chunk.data() + 4, chunk.size() - 4) ^ 0xFFFFFFFF);
+	file.write(reinterpret_cast<const char*>(chunk.data()), static_cast<std::streamsize>(chunk.size()));
+}
+
+// Write the bitmap to a 24-bit PNG file
+//
+// Returns false if the file could not be written
+
+bool Bitmap::SavePNG(const char* filename) const
+{
+	std::ofstream file(filename, std::ios::out | std::ios::binary);
+	if (file.fail() || _pixels == nullptr)
+	{
+		return false;
+	}
+	const unsigned char signature[8] = { 137, 'P', 'N', 'G', 13, 10, 26, 10 };
+	file.write(reinterpret_cast<const char*>(signature), sizeof(signature));
+
+	// Header - 8 bits per channel RGB, no interlacing
+	std::vector<unsigned char> header;
+	PngWriteUInt(header, _width);
+	PngWriteUInt(header, _height);
+	header.push_back(8);
+	header.push_back(2);
+	header.push_back(0);
+	header.push_back(0);
+	header.push_back(0);
+	PngWriteChunk(file, "IHDR", header);
+
+	// Raw image data is each row prefixed by a filter type of 0 (none)
+	std::vector<unsigned char> raw;
+	raw.reserve((_width * 3 + 1) * _height);
+	for (unsigned int y = 0; y < _height; y++)
+	{
+		const uint32_t* pixels = GetRow(y);
+		raw.push_back(0);
+		for (unsigned int x = 0; x < _width; x++)
+		{
+			raw.push_back(static_cast<unsigned char>(pixels[x] >> 16));
+			raw.push_back(static_cast<unsigned char>(pixels[x] >> 8));
+			raw.push_back(static_cast<unsigned char>(pixels[x]));
+		}
+	}
+
+	// Wrap the raw data in a zlib stream made of stored blocks of at most 65535 bytes
+	std::vector<unsigned char> zlib = { 0x78, 0x01 };
+	size_t offset = 0;
+	do
+	{
+		size_t blockSize = std::min<size_t>(raw.size() - offset, 65535);
+		bool last = offset + blockSize == raw.size();
+		zlib.push_back(last ? 1 : 0);
+		zlib.push_back(static_cast<unsigned char>(blockSize));
+		zlib.push_back(static_cast<unsigned char>(blockSize >> 8));
+		zlib.push_back(static_cast<unsigned char>(~blockSize));
+		zlib.push_back(static_cast<unsigned char>(~blockSize >> 8));
+		zlib.insert(zlib.end(), raw.begin() + offset, raw.begin() + offset + blockSize);
+		offset += blockSize;
+	} while (offset < raw.size());
+
+	// Adler-32 checksum of the uncompressed data
+	uint32_t a = 1;
+	uint32_t b = 0;
+	for (unsigned char value : raw)
+	{
+		a = (a + value) % 65521;
+		b = (b + a) % 65521;
+	}
+	PngWriteUInt(zlib, (b << 16) | a);
+	PngWriteChunk(file, "IDAT", zlib);
+	PngWriteChunk(file, "IEND", std::vector<unsigned char>());
+	return !file.fail();
 }
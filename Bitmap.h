@@ -1,26 +1,74 @@
 #pragma once
-#include "windows.h"
+#include "Platform.h"
+#include <cstdint>
 
 class Bitmap
 {
 public:
 	Bitmap();
 	~Bitmap();
+	// The bitmap owns its pixel and depth buffers, so it cannot be copied
+	Bitmap(const Bitmap&) = delete;
+	Bitmap& operator=(const Bitmap&) = delete;
 
+#ifndef RASTERISER_HEADLESS
 	bool			Create(HWND hWnd, unsigned int width, unsigned int height);
 	HDC				GetDC() const;
+	void			Clear(HBRUSH hBrush) const;
+#endif
+	bool			Create(unsigned int width, unsigned int height);
 	unsigned int	GetWidth() const;
 	unsigned int	GetHeight() const;
-	void			Clear(HBRUSH hBrush) const;
+	uint32_t*		GetPixels() const;
+	unsigned int	GetPitch() const;
 	void			Clear(COLORREF colour) const;
+	// Depth buffer attached to the bitmap. This is resized along with the bitmap
+	void			SetDepthBuffer(bool enabled);
+	bool			HasDepthBuffer() const;
+	void			ClearDepth() const;
+	// Write the contents of the bitmap to an image file
+	bool			SavePPM(const char* filename) const;
+	bool			SavePNG(const char* filename) const;
+
+	// Returns a pointer to the first pixel of the specified row
+	inline uint32_t* GetRow(int y) const
+	{
+		return _pixels + y * _pitch;
+	}
+
+	// Returns a pointer to the first depth value of the specified row, or nullptr if the
+	// bitmap has no depth buffer. Depth values are 1/w, so larger values are nearer the camera
+	inline float* GetDepthRow(int y) const
+	{
+		return _depth != nullptr ? _depth + y * _pitch : nullptr;
+	}
+
+	// Converts a COLORREF (0x00BBGGRR) into the 0x00RRGGBB layout used by the pixel buffer
+	static inline uint32_t ToPixel(COLORREF colour)
+	{
+		return ((colour & 0xFF) << 16) | (colour & 0xFF00) | ((colour >> 16) & 0xFF);
+	}
 
 private:
+#ifndef RASTERISER_HEADLESS
 	HBITMAP			_hBitmap{ 0 };
 	HBITMAP			_hOldBitmap{ 0 };
 	HDC				_hMemDC{ 0 };
+#endif
 	unsigned int	_width{ 0 };
 	unsigned int	_height{ 0 };
 
+	// 32-bit pixel buffer. This is owned by the DIB section when a window is used,
+	// otherwise it is allocated by us
+	uint32_t*		_pixels{ nullptr };
+	uint32_t*		_ownedPixels{ nullptr };
+	// Number of pixels between the start of one row and the next
+	unsigned int	_pitch{ 0 };
+	// Depth buffer, using the same pitch as the pixels
+	bool			_depthEnabled{ false };
+	float*			_depth{ nullptr };
+
+	void CreateDepthBuffer();
+
 	void DeleteBitmap();
 };
-
@@ -0,0 +1,61 @@
+#include "BoundingVolume.h"
+#include <algorithm>
+#include <cmath>
+
+BoundingVolume::BoundingVolume()
+{
+}
+
+BoundingVolume::~BoundingVolume()
+{
+}
+
+bool BoundingVolume::IsEmpty() const
+{
+	return _minimum[0] > _maximum[0];
+}
+
+void BoundingVolume::Add(float x, float y, float z)
+{
+	_minimum[0] = std::min(_minimum[0], x);
+	_minimum[1] = std::min(_minimum[1], y);
+	_minimum[2] = std::min(_minimum[2], z);
+	_maximum[0] = std::max(_maximum[0], x);
+	_maximum[1] = std::max(_maximum[1], y);
+	_maximum[2] = std::max(_maximum[2], z);
+}
+
+void BoundingVolume::Add(const BoundingVolume& other)
+{
+	for (int axis = 0; axis < 3; axis++)
+	{
+		_minimum[axis] = std::min(_minimum[axis], other._minimum[axis]);
+		_maximum[axis] = std::max(_maximum[axis], other._maximum[axis]);
+	}
+}
+
+const float* BoundingVolume::GetMinimum() const
+{
+	return _minimum;
+}
+
+const float* BoundingVolume::GetMaximum() const
+{
+	return _maximum;
+}
+
+void BoundingVolume::GetSphere(float& x, float& y, float& z, float& radius) const
+{
+	if (IsEmpty())
+	{
+		x = y = z = radius = 0;
+		return;
+	}
+	x = (_minimum[0] + _maximum[0]) * 0.5f;
+	y = (_minimum[1] + _maximum[1]) * 0.5f;
+	z = (_minimum[2] + _maximum[2]) * 0.5f;
+	float dx = _maximum[0] - x;
+	float dy = _maximum[1] - y;
+	float dz = _maximum[2] - z;
+	radius = sqrtf(dx * dx + dy * dy + dz * dz);
+}
@@ -0,0 +1,25 @@
+#pragma once
+#include <cfloat>
+
+// Axis aligned box around a set of points, along with the sphere around the box. The sphere is
+// what is tested against the view frustum, since it stays a sphere however the model is rotated
+class BoundingVolume
+{
+public:
+	BoundingVolume();
+	~BoundingVolume();
+
+	// Returns true if no points have been added
+	bool				IsEmpty() const;
+	// Grows the box to take in a point or another volume
+	void				Add(float x, float y, float z);
+	void				Add(const BoundingVolume& other);
+	const float*		GetMinimum() const;
+	const float*		GetMaximum() const;
+	// Centre and radius of the sphere that passes through the corners of the box
+	void				GetSphere(float& x, float& y, float& z, float& radius) const;
+
+private:
+	float				_minimum[3]{ FLT_MAX, FLT_MAX, FLT_MAX };
+	float				_maximum[3]{ -FLT_MAX, -FLT_MAX, -FLT_MAX };
+};
@@ -39,7 +39,7 @@ float Camera::GetZRotation()
 	return _zRotation;
 }
 
-Vertex Camera::GetPosition() 
+Vertex Camera::GetPosition() const
 {
 	return _position;
 }
\ No newline at end of file
@@ -15,7 +15,7 @@ public:
 	float GetXRotation();
 	float GetYRotation();
 	float GetZRotation();
-	Vertex GetPosition();
+	Vertex GetPosition() const;
 
 private:
 	float _xRotation;
@@ -0,0 +1,229 @@
+#include "Clipper.h"
+#include "TriangleRasteriser.h"
+#include <algorithm>
+#include <cmath>
+
+// Attributes interpolated along clipped edges: red, green and blue, u and v, and the world
+// position and normal
+const int CLIP_ATTRIBUTES = 11;
+
+// Vertex in homogeneous screen space with its attributes as floats
+struct ClipVertex
+{
+	float		x;
+	float		y;
+	float		w;
+	float		attributes[CLIP_ATTRIBUTES];
+};
+
+// Signed distance of a homogeneous point from a plane, which is negative outside it
+static inline float PlaneDistance(uint32_t plane, float x, float y, float w)
+{
+	switch (plane)
+	{
+	case CLIP_NEAR:
+		return w - CLIP_NEAR_PLANE;
+	case CLIP_FAR:
+		return CLIP_FAR_PLANE - w;
+	case CLIP_LEFT:
+		return x + CLIP_GUARD_BAND * w;
+	case CLIP_RIGHT:
+		return CLIP_GUARD_BAND * w - x;
+	case CLIP_TOP:
+		return y + CLIP_GUARD_BAND * w;
+	default:
+		return CLIP_GUARD_BAND * w - y;
+	}
+}
+
+// Returns the point a fraction t of the way from a to b
+static ClipVertex Interpolate(const ClipVertex& a, const ClipVertex& b, float t)
+{
+	ClipVertex result;
+	result.x = a.x + (b.x - a.x) * t;
+	result.y = a.y + (b.y - a.y) * t;
+	result.w = a.w + (b.w - a.w) * t;
+	for (int i = 0; i < CLIP_ATTRIBUTES; i++)
+	{
+		result.attributes[i] = a.attributes[i] + (b.attributes[i] - a.attributes[i]) * t;
+	}
+	return result;
+}
+
+// Sutherland-Hodgman clipping of a convex polygon against one plane. Crossing points are always
+// worked out from the vertex inside the plane, so triangles that share an edge get exactly the
+// same point and no gaps open up between them
+static int ClipAgainstPlane(uint32_t plane, const ClipVertex* input, int count, ClipVertex* output)
+{
+	int outputCount = 0;
+	for (int i = 0; i < count; i++)
+	{
+		const ClipVertex& current = input[i];
+		const ClipVertex& next = input[(i + 1) % count];
+		float currentDistance = PlaneDistance(plane, current.x, current.y, current.w);
+		float nextDistance = PlaneDistance(plane, next.x, next.y, next.w);
+		bool currentInside = currentDistance >= 0;
+		if (currentInside)
+		{
+			output[outputCount++] = current;
+		}
+		if (currentInside != (nextDistance >= 0))
+		{
+			output[outputCount++] = currentInside ? Interpolate(current, next, currentDistance / (currentDistance - nextDistance))
+												  : Interpolate(next, current, nextDistance / (nextDistance - currentDistance));
+		}
+	}
+	return outputCount;
+}
+
+// Rounds an interpolated colour channel back to a byte
+static inline int ToChannel(float value)
+{
+	return static_cast<int>(std::min(std::max(value + 0.5f, 0.0f), 255.0f));
+}
+
+int Clipper::ClipTriangle(const RasterVertex input[3], const float w[3], uint32_t clipFlags, RasterVertex output[MAXIMUM_VERTICES])
+{
+	// Polygons are clipped back and forth between two buffers
+	ClipVertex buffers[2][MAXIMUM_VERTICES];
+	for (int i = 0; i < 3; i++)
+	{
+		const RasterVertex& vertex = input[i];
+		ClipVertex& clipVertex = buffers[0][i];
+		clipVertex.x = vertex.x;
+		clipVertex.y = vertex.y;
+		clipVertex.w = w[i];
+		float attributes[CLIP_ATTRIBUTES] = { float(GetRValue(vertex.colour)), float(GetGValue(vertex.colour)), float(GetBValue(vertex.colour)),
+			vertex.u, vertex.v, vertex.worldX, vertex.worldY, vertex.worldZ, vertex.normalX, vertex.normalY, vertex.normalZ };
+		std::copy(attributes, attributes + CLIP_ATTRIBUTES, clipVertex.attributes);
+	}
+	int count = 3;
+	int current = 0;
+	for (uint32_t plane = CLIP_NEAR; plane <= CLIP_BOTTOM && count > 0; plane <<= 1)
+	{
+		if ((clipFlags & plane) != 0)
+		{
+			count = ClipAgainstPlane(plane, buffers[current], count, buffers[1 - current]);
+			current = 1 - current;
+		}
+	}
+	if (count < 3)
+	{
+		return 0;
+	}
+
+	for (int i = 0; i < count; i++)
+	{
+		const ClipVertex& clipVertex = buffers[current][i];
+		const float* attributes = clipVertex.attributes;
+		RasterVertex& vertex = output[i];
+		float wRecip = 1 / clipVertex.w;
+		vertex.x = clipVertex.x * wRecip;
+		vertex.y = clipVertex.y * wRecip;
+		vertex.zRecip = wRecip;
+		vertex.colour = RGB(ToChannel(attributes[0]), ToChannel(attributes[1]), ToChannel(attributes[2]));
+		vertex.u = attributes[3];
+		vertex.v = attributes[4];
+		vertex.worldX = attributes[5];
+		vertex.worldY = attributes[6];
+		vertex.worldZ = attributes[7];
+		vertex.normalX = attributes[8];
+		vertex.normalY = attributes[9];
+		vertex.normalZ = attributes[10];
+	}
+	return count;
+}
+
+bool Clipper::ClipLine(float start[3], float end[3], uint32_t clipFlags)
+{
+	// Fractions of the way along the line that are inside every plane
+	float first = 0;
+	float last = 1;
+	for (uint32_t plane = CLIP_NEAR; plane <= CLIP_BOTTOM; plane <<= 1)
+	{
+		if ((clipFlags & plane) == 0)
+		{
+			continue;
+		}
+		float startDistance = PlaneDistance(plane, start[0], start[1], start[2]);
+		float endDistance = PlaneDistance(plane, end[0], end[1], end[2]);
+		if (startDistance < 0 && endDistance < 0)
+		{
+			return false;
+		}
+		if (startDistance < 0)
+		{
+			first = std::max(first, startDistance / (startDistance - endDistance));
+		}
+		else if (endDistance < 0)
+		{
+			last = std::min(last, startDistance / (startDistance - endDistance));
+		}
+	}
+	if (first > last)
+	{
+		return false;
+	}
+	float clippedStart[3];
+	float clippedEnd[3];
+	for (int i = 0; i < 3; i++)
+	{
+		clippedStart[i] = start[i] + (end[i] - start[i]) * first;
+		clippedEnd[i] = start[i] + (end[i] - start[i]) * last;
+	}
+	for (int i = 0; i < 2; i++)
+	{
+		start[i] = clippedStart[i] / clippedStart[2];
+		end[i] = clippedEnd[i] / clippedEnd[2];
+	}
+	start[2] = 1;
+	end[2] = 1;
+	return true;
+}
+
+// Liang-Barsky clipping against each side of the rectangle in turn
+bool Clipper::ScissorLine(float& x0, float& y0, float& x1, float& y1, float left, float top, float right, float bottom)
+{
+	float dx = x1 - x0;
+	float dy = y1 - y0;
+	// Each side as the change along the line and the distance inside it at the start
+	float steps[4] = { -dx, dx, -dy, dy };
+	float distances[4] = { x0 - left, right - x0, y0 - top, bottom - y0 };
+	float first = 0;
+	float last = 1;
+	for (int i = 0; i < 4; i++)
+	{
+		if (steps[i] == 0)
+		{
+			if (distances[i] < 0)
+			{
+				return false;
+			}
+			continue;
+		}
+		float t = distances[i] / steps[i];
+		if (steps[i] < 0)
+		{
+			first = std::max(first, t);
+		}
+		else
+		{
+			last = std::min(last, t);
+		}
+	}
+	if (first > last)
+	{
+		return false;
+	}
+	if (last < 1)
+	{
+		x1 = x0 + dx * last;
+		y1 = y0 + dy * last;
+	}
+	if (first > 0)
+	{
+		x0 += dx * first;
+		y0 += dy * first;
+	}
+	return true;
+}
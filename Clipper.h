@@ -0,0 +1,44 @@
+#pragma once
+#include <cstdint>
+
+struct RasterVertex;
+
+// Planes that a vertex can be outside of, as bits of its clip flags
+const uint32_t CLIP_NEAR = 1 << 0;
+const uint32_t CLIP_FAR = 1 << 1;
+const uint32_t CLIP_LEFT = 1 << 2;
+const uint32_t CLIP_RIGHT = 1 << 3;
+const uint32_t CLIP_TOP = 1 << 4;
+const uint32_t CLIP_BOTTOM = 1 << 5;
+
+// Camera space distances of the near and far planes. Nothing nearer than the near plane is
+// drawn, which keeps w well away from zero when dividing by it
+const float CLIP_NEAR_PLANE = 1.0f;
+const float CLIP_FAR_PLANE = 10000.0f;
+// Screen coordinates, in pixels, beyond which triangles are clipped. This is half of the range
+// the triangle rasteriser can draw, so clipped vertices are always safely inside it
+const float CLIP_GUARD_BAND = 8192.0f;
+
+// Clips triangles and lines in homogeneous screen space, after the view, perspective and screen
+// transforms but before the divide by w, where clipping against the near plane is a linear
+// interpolation. Triangles are clipped against the near and far planes and a guard band far
+// outside the screen. The rasteriser scissors each triangle to the tile it is drawing, so
+// triangles that only cross the edge of the screen are drawn without being clipped here
+class Clipper
+{
+public:
+	// Most vertices a clipped triangle can have, one more than before for each plane
+	static const int MAXIMUM_VERTICES = 9;
+
+	// Clips a triangle against the planes in clipFlags. The input vertices have homogeneous x and
+	// y, with their w given separately. The clipped polygon is written to output in screen space,
+	// with its attributes interpolated, and the number of vertices is returned. This is zero if
+	// nothing is left, otherwise the polygon is convex and can be drawn as a fan of triangles
+	static int ClipTriangle(const RasterVertex input[3], const float w[3], uint32_t clipFlags, RasterVertex output[MAXIMUM_VERTICES]);
+	// Clips a line with homogeneous end points against the planes in clipFlags, then divides the
+	// end points by w. Returns false if none of the line is left
+	static bool ClipLine(float start[3], float end[3], uint32_t clipFlags);
+	// Shortens a line in screen space so that it is inside a rectangle. Returns false if the line
+	// misses the rectangle
+	static bool ScissorLine(float& x0, float& y0, float& x1, float& y1, float left, float top, float right, float bottom);
+};
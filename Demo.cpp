@@ -1,5 +1,8 @@
 #include "Demo.h"
 
+// Rate the demo is designed to be updated at
+const float DEMO_FRAMES_PER_SECOND = 30.0f;
+
 // Constructor
 Demo::Demo() : _angles{ 0.0f }, _position{ 0.0f }
 {
@@ -8,14 +11,20 @@ Demo::Demo() : _angles{ 0.0f }, _position{ 0.0f }
 	_backface = false;
 	_smoothShading = false;
 	_specular = false;
+	_depthBuffer = true;
 	_scale = 1.0f;
 	_stage = "Wireframe";
 	_drawMode = "Wireframe";
 	_movingAway = true;
 	_shrinking = true;
-	_model = "Models\\cube.md2";
+	_model = "Models/cube.md2";
 	_texture = NULL;
+	_nextModel = "Models/marvin.md2";
+	_nextTexture = NULL;
 	_changedModel = false;
+	_animation = "";
+	_fixedModel = false;
+	_fixedTexture = false;
 	_ambientLight = NULL;
 	_directionalLights = {};
 	_pointLights = {};
@@ -43,6 +52,11 @@ bool Demo::GetSpecular()
 	return _specular;
 }
 
+bool Demo::GetDepthBuffer()
+{
+	return _depthBuffer;
+}
+
 std::string Demo::GetStage()
 {
 	return _stage;
@@ -53,22 +67,22 @@ std::string Demo::GetDrawMode()
 	return _drawMode;
 }
 
-AmbientLight Demo::GetAmbientLight()
+const AmbientLight& Demo::GetAmbientLight()
 {
 	return _ambientLight;
 }
 
-std::vector<DirectionalLight> Demo::GetDirectionalLights()
+const std::vector<DirectionalLight>& Demo::GetDirectionalLights()
 {
 	return _directionalLights;
 }
 
-std::vector<PointLight> Demo::GetPointLights()
+const std::vector<PointLight>& Demo::GetPointLights()
 {
 	return _pointLights;
 }
 
-std::vector<SpotLight> Demo::GetSpotLights()
+const std::vector<SpotLight>& Demo::GetSpotLights()
 {
 	return _spotLights;
 }
@@ -88,13 +102,18 @@ float Demo::GetRotation(int index)
 	return DegreesToRadians(_angles[index]);
 }
 
+// The model given to SetModel is used in place of the demo's own models if there is one
 const char* Demo::GetModel()
 {
-	return _model;
+	return _fixedModel ? _fixedModelPath.c_str() : _model;
 }
 
 const char* Demo::GetTexture()
 {
+	if (_fixedModel)
+	{
+		return _fixedTexture ? _fixedTexturePath.c_str() : NULL;
+	}
 	return _texture;
 }
 
@@ -103,6 +122,28 @@ bool Demo::GetChangedModel()
 	return _changedModel;
 }
 
+// Model and texture the demo will switch to next, so they can be loaded in advance
+const char* Demo::GetNextModel()
+{
+	return _fixedModel ? GetModel() : _nextModel;
+}
+
+const char* Demo::GetNextTexture()
+{
+	return _fixedModel ? GetTexture() : _nextTexture;
+}
+
+const char* Demo::GetAnimation()
+{
+	return _animation;
+}
+
+// Time into the demo, used to play the animation of the model
+float Demo::GetAnimationTime()
+{
+	return _frame / DEMO_FRAMES_PER_SECOND;
+}
+
 // Converts degrees to radians for use with trig functions
 float Demo::DegreesToRadians(float degrees)
 {
@@ -115,6 +156,15 @@ void Demo::SetChangedModel(bool changed)
 	_changedModel = changed;
 }
 
+void Demo::SetModel(const char* model, const char* texture)
+{
+	_fixedModel = true;
+	_fixedModelPath = model;
+	_fixedTexture = texture != NULL;
+	_fixedTexturePath = _fixedTexture ? texture : "";
+	_changedModel = false;
+}
+
 /*
 Stages of demo:
 1: Wireframe
@@ -126,11 +176,12 @@ Stages of demo:
 7: Directional light
 8: Point light
 9: My Solid fill
-10: Gouraud shading (Bresenham)
+10: Gouraud shading
 11: Specular lighting
 12: Spot light
-13: Textures
-14: Textures with perspective correction -> loop back to start
+13: Per-pixel lighting
+14: Textures
+15: Textures with perspective correction -> loop back to start
 */
 
 void Demo::Update()
@@ -152,8 +203,11 @@ void Demo::Update()
 		_backface = true;
 		break;
 	case 500:
-		_model = "Models\\marvin.md2";
+		_model = "Models/marvin.md2";
 		_changedModel = true;
+		_animation = "stand";
+		_nextModel = "Models/cube.md2";
+		_nextTexture = "Models/lines.pcx";
 		_stage = "Solid fill with ambient light";
 		_drawMode = "Solid";
 		_ambientLight = AmbientLight(RGB(0, 255, 255));
@@ -167,12 +221,12 @@ void Demo::Update()
 		_pointLights = { PointLight(RGB(255, 255, 255), Vertex(50, 0, -50), 0, 1, 0) };
 		break;
 	case 875:
-		_stage = "Solid fill using Bresenham algorithm";
+		_stage = "Solid fill using edge functions";
 		_drawMode = "MySolid";
 		break;
 	case 950:
-		_stage = "Smooth shading using Bresenham algorithm";
-		_drawMode = "Bresenham";
+		_stage = "Smooth shading";
+		_drawMode = "Gouraud";
 		_smoothShading = true;
 		break;
 	case 1050:
@@ -185,17 +239,24 @@ void Demo::Update()
 		_pointLights = {};
 		_spotLights = { SpotLight(RGB(0,255,0), Vertex(0, 0, -50), 0, 1, 0, DegreesToRadians(15), DegreesToRadians(30)) };	
 		break;
+	case 1200:
+		_stage = "Per-pixel lighting";
+		_drawMode = "Phong";
+		break;
 	case 1250:
-		_model = "Models\\cube.md2";
-		_texture = "Models\\lines.pcx";
+		_model = "Models/cube.md2";
+		_texture = "Models/lines.pcx";
 		_changedModel = true;
+		_animation = "";
+		_nextModel = "Models/cube.md2";
+		_nextTexture = NULL;
 		_drawMode = "Textured";
 		_stage = "Smooth shading with textures (not corrected for perspective)";
 		_directionalLights = { DirectionalLight(RGB(0, 255, 255), Vertex(1, 0, 0)) };
 		_pointLights = _pointLights = { PointLight(RGB(255, 255, 255), Vertex(50, 0, -50), 0, 1, 0) };
 		break;
 	case 1350:
-		_stage = "Textures corrected for perspective (not working correctly)";
+		_stage = "Textures corrected for perspective";
 		_drawMode = "TexturedCorrected";
 		break;
 	case 1450:
@@ -212,6 +273,9 @@ void Demo::Update()
 		_texture = NULL;
 		_changedModel = true;
 		_texture = NULL;
+		_animation = "";
+		_nextModel = "Models/marvin.md2";
+		_nextTexture = NULL;
 		_angles[0] = 0;
 		_angles[1] = 0;
 		_angles[2] = 0;
@@ -224,6 +288,12 @@ void Demo::Update()
 		_spotLights = {};
 	}
 
+	// A model given to SetModel is never switched for another
+	if (_fixedModel)
+	{
+		_changedModel = false;
+	}
+
 	// Makes model move away then back to original position
 	if (_stage == "Translation")
 	{
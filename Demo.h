@@ -16,11 +16,12 @@ Stages of demo:
 7: Directional light
 8: Point light
 9: My Solid fill
-10: Gouraud shading (Bresenham)
+10: Gouraud shading
 11: Specular lighting
 12: Spot light
-13: Textures
-14: Textures with perspective correction -> loop back to start
+13: Per-pixel lighting
+14: Textures
+15: Textures with perspective correction -> loop back to start
 */
 
 #pragma once
@@ -35,22 +36,30 @@ public:
 	bool GetBackface();
 	bool GetSmoothShading();
 	bool GetSpecular();
+	bool GetDepthBuffer();
 	std::string GetStage();
 	std::string GetDrawMode();
-	AmbientLight GetAmbientLight();
-	std::vector<DirectionalLight> GetDirectionalLights();
-	std::vector<PointLight> GetPointLights();
-	std::vector<SpotLight> GetSpotLights();
+	const AmbientLight& GetAmbientLight();
+	const std::vector<DirectionalLight>& GetDirectionalLights();
+	const std::vector<PointLight>& GetPointLights();
+	const std::vector<SpotLight>& GetSpotLights();
 	float GetPosition(int index);
 	float GetScale();
 	float GetRotation(int index);
 	const char* GetModel();
 	const char* GetTexture();
 	bool GetChangedModel();
+	const char* GetNextModel();
+	const char* GetNextTexture();
+	const char* GetAnimation();
+	float GetAnimationTime();
 	// Useful function
 	static float DegreesToRadians(float degrees);
 	// Mutator
 	void SetChangedModel(bool changed);
+	// Draws the given model, with the given texture (NULL for none), in every stage instead of
+	// switching between the demo's own models. Used to benchmark the demo with other models
+	void SetModel(const char* model, const char* texture);
 	// Updates the program
 	void Update();
 private:
@@ -60,6 +69,8 @@ private:
 	bool _backface;
 	bool _smoothShading;
 	bool _specular;
+	// Specifies whether polygons are depth tested per pixel rather than sorted
+	bool _depthBuffer;
 	// Saves rotation, position and scale of model
 	float _angles[3];
 	float _position[3];
@@ -75,10 +86,19 @@ private:
 	// Used to make model move away then back again and shrink then grow back to full size
 	bool _movingAway;
 	bool _shrinking;
-	// Path of model and texture
+	// Path of model and texture, and of the model and texture that will be used next
 	const char* _model;
 	const char* _texture;
+	const char* _nextModel;
+	const char* _nextTexture;
 	// Specifies if model has been changed and needs to be reloaded from file
 	bool _changedModel;
+	// Name of the animation played by the model, empty if it is not animated
+	const char* _animation;
+	// Model and texture set by SetModel, which are used throughout if _fixedModel is set
+	bool _fixedModel;
+	std::string _fixedModelPath;
+	std::string _fixedTexturePath;
+	bool _fixedTexture;
 };
 
@@ -1,7 +1,7 @@
 #pragma once
 #include "Vertex.h"
 #include "AmbientLight.h"
-#include <windows.h>
+#include "Platform.h"
 
 // Directional light inherits from Ambient light as they both share colour
 class DirectionalLight : public AmbientLight
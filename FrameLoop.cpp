@@ -0,0 +1,150 @@
+#include "FrameLoop.h"
+#include <cmath>
+
+FrameLoop::FrameLoop() : _mode(Mode::FixedRate), _rate(DEFAULT_RATE)
+{
+}
+
+void FrameLoop::SetMode(Mode mode, double rate)
+{
+	_mode = mode;
+	_rate = rate > 0 ? rate : double(DEFAULT_RATE);
+}
+
+FrameLoop::Mode FrameLoop::GetMode() const
+{
+	return _mode;
+}
+
+double FrameLoop::GetRate() const
+{
+	return _rate;
+}
+
+bool FrameLoop::ParseMode(const std::string& name, Mode& mode)
+{
+	if (name == "uncapped")
+	{
+		mode = Mode::Uncapped;
+	}
+	else if (name == "fixed")
+	{
+		mode = Mode::FixedRate;
+	}
+	else if (name == "timestep")
+	{
+		mode = Mode::FixedTimestep;
+	}
+	else
+	{
+		return false;
+	}
+	return true;
+}
+
+void FrameLoop::Start()
+{
+	_nextFrame = Clock::now();
+	_lastFrame = _nextFrame;
+	_unsimulatedTime = 0;
+	_firstFrame = true;
+}
+
+bool FrameLoop::Step(Framework& framework, const Bitmap& bitmap)
+{
+	if (!Prepare(framework, bitmap))
+	{
+		return false;
+	}
+	framework.Render(bitmap);
+	_frameTime = std::chrono::duration<double>(Clock::now() - _lastFrame).count();
+	return true;
+}
+
+bool FrameLoop::Prepare(Framework& framework, const Bitmap& bitmap)
+{
+	Clock::time_point startTime = Clock::now();
+	std::chrono::duration<double> period(1.0 / _rate);
+	int updates = 1;
+	switch (_mode)
+	{
+		case Mode::Uncapped:
+			break;
+
+		case Mode::FixedRate:
+			if (startTime < _nextFrame)
+			{
+				return false;
+			}
+			_nextFrame += std::chrono::duration_cast<Clock::duration>(period);
+			// If we get more than a frame behind, drop the frames we missed. Otherwise the
+			// error would accumulate and we would never catch up
+			if (_nextFrame < startTime)
+			{
+				_nextFrame = startTime + std::chrono::duration_cast<Clock::duration>(period);
+			}
+			break;
+
+		case Mode::FixedTimestep:
+			// The first frame runs a single update, so that there is something to draw
+			if (_firstFrame)
+			{
+				_unsimulatedTime = period.count();
+			}
+			else
+			{
+				_unsimulatedTime += std::chrono::duration<double>(startTime - _lastFrame).count();
+			}
+			updates = static_cast<int>(_unsimulatedTime / period.count());
+			if (updates > MAXIMUM_UPDATES_PER_FRAME)
+			{
+				updates = MAXIMUM_UPDATES_PER_FRAME;
+				_unsimulatedTime = fmod(_unsimulatedTime, period.count()) + updates * period.count();
+			}
+			_unsimulatedTime -= updates * period.count();
+			break;
+	}
+
+	for (int update = 0; update < updates; update++)
+	{
+		framework.Update(bitmap);
+	}
+	if (_mode == Mode::FixedTimestep)
+	{
+		framework.Interpolate(bitmap, static_cast<float>(_unsimulatedTime / period.count()));
+	}
+	framework.Prepare(bitmap);
+
+	Clock::time_point endTime = Clock::now();
+	_frameInterval = _firstFrame ? 0 : std::chrono::duration<double>(startTime - _lastFrame).count();
+	_frameTime = std::chrono::duration<double>(endTime - startTime).count();
+	_frameUpdates = updates;
+	_lastFrame = startTime;
+	_firstFrame = false;
+	return true;
+}
+
+double FrameLoop::GetTimeToNextFrame() const
+{
+	if (_mode != Mode::FixedRate)
+	{
+		return 0;
+	}
+	double seconds = std::chrono::duration<double>(_nextFrame - Clock::now()).count();
+	return seconds > 0 ? seconds : 0;
+}
+
+double FrameLoop::GetFrameInterval() const
+{
+	return _frameInterval;
+}
+
+double FrameLoop::GetFrameTime() const
+{
+	return _frameTime;
+}
+
+int FrameLoop::GetFrameUpdates() const
+{
+	return _frameUpdates;
+}
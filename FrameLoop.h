@@ -0,0 +1,82 @@
+#pragma once
+#include "Framework.h"
+#include <chrono>
+#include <string>
+
+// Decides when the platform's main loop updates and renders the framework. There are three
+// modes:
+//
+//   Uncapped       Updates and renders one frame after another as fast as possible. The demo
+//                  runs faster on faster machines, but it shows how fast the renderer really is
+//   FixedRate      Updates and renders the given number of times a second, waiting in between.
+//                  This is how the demo is meant to be watched
+//   FixedTimestep  Updates the given number of times a second, however fast frames are drawn,
+//                  and renders as often as it can in between. Each frame is drawn part of the
+//                  way between the last two updates (see Framework::Interpolate), so movement
+//                  stays smooth when the frame rate is not a multiple of the update rate
+//
+// The loop never waits itself, since each platform has its own way of waiting that lets it
+// carry on handling events. Instead the platform calls Step over and over, waiting for up to
+// GetTimeToNextFrame between calls
+class FrameLoop
+{
+public:
+	enum class Mode
+	{
+		Uncapped,
+		FixedRate,
+		FixedTimestep
+	};
+
+	// Frames or updates a second used when no rate is given
+	static const int DEFAULT_RATE = 30;
+	// Most updates run before a frame in FixedTimestep mode. If updating takes longer than the
+	// time it simulates, the loop would fall further behind with every frame, so instead any
+	// time beyond this is dropped and the simulation slows down
+	static const int MAXIMUM_UPDATES_PER_FRAME = 5;
+
+	FrameLoop();
+
+	void				SetMode(Mode mode, double rate);
+	Mode				GetMode() const;
+	double				GetRate() const;
+	// Parses the name of a mode, which is uncapped, fixed or timestep. Returns false if the
+	// name is not recognised
+	static bool			ParseMode(const std::string& name, Mode& mode);
+
+	// Times the loop from now. Called before the first Step
+	void				Start();
+	// Runs the updates that are due and renders a frame, if one is due. Returns true if a
+	// frame was rendered
+	bool				Step(Framework& framework, const Bitmap& bitmap);
+	// Runs the updates that are due and prepares a frame, if one is due, but leaves rendering
+	// it to the caller. Used when frames are rendered on another thread. Returns true if a frame
+	// was prepared
+	bool				Prepare(Framework& framework, const Bitmap& bitmap);
+	// Seconds until Step next has a frame to render, which is 0 unless the mode is FixedRate
+	double				GetTimeToNextFrame() const;
+
+	// Measurements of the last frame, in seconds. The interval is the time since the frame
+	// before it started, and the frame time is the time taken to update and prepare it, and to
+	// render it if Step rendered it
+	double				GetFrameInterval() const;
+	double				GetFrameTime() const;
+	// Number of updates run for the last frame
+	int					GetFrameUpdates() const;
+
+private:
+	typedef std::chrono::steady_clock Clock;
+
+	Mode				_mode;
+	double				_rate;
+	// When the next frame is due in FixedRate mode
+	Clock::time_point	_nextFrame;
+	// Time the last frame started
+	Clock::time_point	_lastFrame;
+	// Time that has passed in FixedTimestep mode but has not been simulated yet
+	double				_unsimulatedTime{ 0 };
+	bool				_firstFrame{ true };
+	double				_frameInterval{ 0 };
+	double				_frameTime{ 0 };
+	int					_frameUpdates{ 0 };
+};
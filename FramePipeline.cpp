@@ -0,0 +1,203 @@
+#include "FramePipeline.h"
+#include <chrono>
+
+FramePipeline::FramePipeline()
+{
+	for (int i = 0; i < BUFFER_COUNT; i++)
+	{
+		_states[i] = BufferState::Free;
+	}
+}
+
+FramePipeline::~FramePipeline()
+{
+	Stop();
+}
+
+bool FramePipeline::Start(Framework& framework, FrameLoop& frameLoop, const std::function<bool(Bitmap&)>& createBitmap,
+						  const std::function<void()>& frameRendered)
+{
+	if (_running || !framework.CanPipeline())
+	{
+		return false;
+	}
+	for (int i = 0; i < BUFFER_COUNT; i++)
+	{
+		if (!createBitmap(_bitmaps[i]))
+		{
+			return false;
+		}
+		_bitmaps[i].SetDepthBuffer(framework.GetBitmap().HasDepthBuffer());
+		_states[i] = BufferState::Free;
+	}
+	_framework = &framework;
+	_frameLoop = &frameLoop;
+	_frameRendered = frameRendered;
+	_rendered.clear();
+	_shown = -1;
+	// The framework's count of prepared frames has to start level with ours
+	_preparedFrameSlots = framework.GetPreparedFrameSlots();
+	_preparedFrames = 0;
+	_renderedFrames = 0;
+	framework.SetPipelined(true);
+	framework.DropPreparedFrames();
+	_quit = false;
+	_running = true;
+	_simulateThread = std::thread(&FramePipeline::SimulateMain, this);
+	_renderThread = std::thread(&FramePipeline::RenderMain, this);
+	return true;
+}
+
+void FramePipeline::Stop()
+{
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		if (!_running)
+		{
+			return;
+		}
+		_quit = true;
+		_running = false;
+	}
+	_changed.notify_all();
+	_simulateThread.join();
+	_renderThread.join();
+	_framework->DropPreparedFrames();
+	_framework->SetPipelined(false);
+	_rendered.clear();
+	_shown = -1;
+}
+
+bool FramePipeline::IsRunning() const
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	return _running;
+}
+
+const Bitmap* FramePipeline::NextFrame(bool wait)
+{
+	std::unique_lock<std::mutex> lock(_mutex);
+	if (wait)
+	{
+		_changed.wait(lock, [this] { return !_rendered.empty() || !_running; });
+	}
+	if (_rendered.empty())
+	{
+		return nullptr;
+	}
+	// The frame that was being shown can now be rendered into again
+	if (_shown >= 0)
+	{
+		_states[_shown] = BufferState::Free;
+	}
+	_shown = _rendered.front();
+	_rendered.pop_front();
+	_states[_shown] = BufferState::Shown;
+	lock.unlock();
+	_changed.notify_all();
+	return &_bitmaps[_shown];
+}
+
+const Bitmap* FramePipeline::GetShownFrame() const
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	return _shown >= 0 ? &_bitmaps[_shown] : nullptr;
+}
+
+double FramePipeline::GetPrepareTime() const
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	return _prepareTime;
+}
+
+double FramePipeline::GetRenderTime() const
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	return _renderTime;
+}
+
+// Prepares frames as the frame loop asks for them, as long as there is a slot free to prepare
+// them into. The first bitmap is passed to the framework for its size, but is never drawn on here
+
+void FramePipeline::SimulateMain()
+{
+	while (true)
+	{
+		{
+			std::unique_lock<std::mutex> lock(_mutex);
+			_changed.wait(lock, [this] { return _quit || _preparedFrames - _renderedFrames < _preparedFrameSlots; });
+			if (_quit)
+			{
+				return;
+			}
+		}
+		if (_frameLoop->Prepare(*_framework, _bitmaps[0]))
+		{
+			{
+				std::lock_guard<std::mutex> lock(_mutex);
+				_preparedFrames++;
+				_prepareTime = _frameLoop->GetFrameTime();
+			}
+			_changed.notify_all();
+		}
+		else
+		{
+			std::this_thread::sleep_for(std::chrono::duration<double>(_frameLoop->GetTimeToNextFrame()));
+		}
+	}
+}
+
+// Renders each prepared frame into a free bitmap, in the order they were prepared
+
+void FramePipeline::RenderMain()
+{
+	while (true)
+	{
+		int buffer = -1;
+		{
+			std::unique_lock<std::mutex> lock(_mutex);
+			_changed.wait(lock, [this, &buffer]
+			{
+				if (_quit)
+				{
+					return true;
+				}
+				if (_renderedFrames == _preparedFrames)
+				{
+					return false;
+				}
+				for (int i = 0; i < BUFFER_COUNT; i++)
+				{
+					if (_states[i] == BufferState::Free)
+					{
+						buffer = i;
+						return true;
+					}
+				}
+				return false;
+			});
+			if (_quit)
+			{
+				return;
+			}
+			_states[buffer] = BufferState::Rendering;
+		}
+
+		auto startTime = std::chrono::steady_clock::now();
+		_framework->Render(_bitmaps[buffer]);
+		auto endTime = std::chrono::steady_clock::now();
+
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			_states[buffer] = BufferState::Rendered;
+			_rendered.push_back(buffer);
+			_renderedFrames++;
+			_renderTime = std::chrono::duration<double>(endTime - startTime).count();
+		}
+		_changed.notify_all();
+		if (_frameRendered)
+		{
+			_frameRendered();
+		}
+	}
+}
@@ -0,0 +1,87 @@
+#pragma once
+#include "Bitmap.h"
+#include "FrameLoop.h"
+#include "Framework.h"
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+// Runs the three stages of a frame on different threads. While one frame is rendered, the next
+// is updated and prepared on the simulation thread and the one before is presented by the
+// platform's own thread. Once the pipeline is full, frames come out at the rate of the slowest
+// stage rather than the total of all three.
+//
+// The framework prepares frames into a fixed number of slots in turn (see
+// Framework::GetPreparedFrameSlots), so a frame is only prepared once the frame that many before
+// it has been rendered. Any frames the framework holds are dropped when the pipeline starts and
+// stops, so that its count of frames always matches the pipeline's. Frames are rendered into
+// BUFFER_COUNT bitmaps, so that one can be shown while another waits to be shown and the third is
+// rendered into. Frames are shown in the order they were rendered.
+//
+// The frame loop decides when the simulation thread prepares a frame, as it does when nothing is
+// pipelined
+class FramePipeline
+{
+public:
+	static const int BUFFER_COUNT = 3;
+
+	FramePipeline();
+	~FramePipeline();
+
+	// Creates the bitmaps with createBitmap, giving them a depth buffer if the framework's own
+	// bitmap has one, and starts the threads. frameRendered is called on the render thread
+	// whenever a frame is ready to be shown, and may be empty. Returns false if the framework
+	// cannot be pipelined or a bitmap could not be created
+	bool			Start(Framework& framework, FrameLoop& frameLoop, const std::function<bool(Bitmap&)>& createBitmap,
+						  const std::function<void()>& frameRendered);
+	// Stops and joins the threads. Frames that have been rendered but not shown are dropped
+	void			Stop();
+	bool			IsRunning() const;
+
+	// Moves on to the oldest frame that has been rendered but not shown, and returns its bitmap,
+	// which stays untouched until NextFrame is called again. If wait is false and no frame has
+	// been rendered, nullptr is returned and the frame being shown does not change
+	const Bitmap*	NextFrame(bool wait);
+	// Returns the bitmap of the frame being shown, or nullptr if there is none
+	const Bitmap*	GetShownFrame() const;
+	// Seconds taken to update and prepare, and to render, the last frame
+	double			GetPrepareTime() const;
+	double			GetRenderTime() const;
+
+private:
+	enum class BufferState
+	{
+		Free,
+		Rendering,
+		Rendered,
+		Shown
+	};
+
+	Framework*				_framework{ nullptr };
+	FrameLoop*				_frameLoop{ nullptr };
+	std::function<void()>	_frameRendered;
+	Bitmap					_bitmaps[BUFFER_COUNT];
+	BufferState				_states[BUFFER_COUNT];
+	// Buffers that have been rendered, oldest first, and the buffer being shown
+	std::deque<int>			_rendered;
+	int						_shown{ -1 };
+
+	std::thread				_simulateThread;
+	std::thread				_renderThread;
+	mutable std::mutex		_mutex;
+	std::condition_variable	_changed;
+	// Frames the framework has prepared and rendered since the pipeline started, and the most
+	// that can be prepared but not rendered
+	unsigned int			_preparedFrames{ 0 };
+	unsigned int			_renderedFrames{ 0 };
+	unsigned int			_preparedFrameSlots{ 1 };
+	double					_prepareTime{ 0 };
+	double					_renderTime{ 0 };
+	bool					_running{ false };
+	bool					_quit{ false };
+
+	void SimulateMain();
+	void RenderMain();
+};
@@ -1,12 +1,21 @@
 #pragma once
 #include <iostream>
-#include <windows.h>
-#include "Resource.h"
+#include "Platform.h"
 #include "Bitmap.h"
+#include <string>
 #include <vector>
 
 using namespace std;
 
+// What a frame shows, so that benchmark timings can be grouped by it and golden images named
+struct FrameDescription
+{
+	std::string		stage;
+	std::string		drawMode;
+	// Number of triangles given to the renderer
+	size_t			triangles;
+};
+
 class Framework
 {
 public:
@@ -14,26 +23,54 @@ public:
 	Framework(unsigned int width, unsigned int height);
 	virtual ~Framework();
 
-	int Run(HINSTANCE hInstance, int nCmdShow);
-
-	LRESULT MsgProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam);
+	// Runs the application on the specified platform
+	int Run(Platform& platform);
 
 	virtual bool Initialise();
 	virtual void Update(const Bitmap &bitmap);
+	// Does the work for the next frame that does not draw on the bitmap, such as transforming
+	// and lighting, after Update (and Interpolate). Render does it itself if it has not been done
+	virtual void Prepare(const Bitmap &bitmap);
 	virtual void Render(const Bitmap &bitmap);
+	// Returns true if Update, Interpolate and Prepare for the next frame may run on one thread
+	// while Render draws the frame prepared before it on another (see FramePipeline.h)
+	virtual bool CanPipeline();
+	// Most frames that can have been prepared but not yet rendered. A pipeline never lets
+	// preparing get further ahead of rendering than this
+	virtual unsigned int GetPreparedFrameSlots();
+	// Forgets any frames that have been prepared but not rendered. Called when a pipeline starts
+	// and stops, so that frames left from before are never drawn
+	virtual void DropPreparedFrames();
+	// Called with true before a pipeline starts its threads and false after it stops them. While
+	// pipelined, Render only draws frames that have been prepared, and never prepares one itself
+	virtual void SetPipelined(bool pipelined);
+	// Used by main loops that update at a fixed rate but render more often (see FrameLoop.h).
+	// Called before Render to draw the frame the given amount of the way from the state before
+	// the last update (0) to the state after it (1)
+	virtual void Interpolate(const Bitmap &bitmap, float amount);
 	virtual void Shutdown();
 
+	// Used by the benchmark and golden image checks to replay the application deterministically.
+	// Restart goes back to the first frame, drawing the given model (and texture, if not empty)
+	// throughout instead of the application's own, which is loaded before it returns. Returns
+	// false if the application cannot be restarted or the model cannot be loaded
+	virtual bool Restart(const std::string& modelPath, const std::string& texturePath);
+	// Describes the frame that was last updated
+	virtual FrameDescription DescribeFrame();
+
+	Bitmap&			GetBitmap();
+	unsigned int	GetWidth() const;
+	unsigned int	GetHeight() const;
+	// Number of threads the application may use for rendering. 0 uses one per core
+	void			SetThreadCount(unsigned int threadCount);
+	unsigned int	GetThreadCount() const;
+
+	// Returns the instance of the class that inherits from Framework
+	static Framework* GetFramework();
+
 private:
-	HINSTANCE		_hInstance;
-	HWND			_hWnd;
 	Bitmap			_bitmap;
 	unsigned int	_width;
 	unsigned int	_height;
-
-	// Used in timing loop
-	double			_timeSpan{ 0 };
-
-	bool InitialiseMainWindow(int nCmdShow);
-	int MainLoop();
+	unsigned int	_threadCount;
 };
-
@@ -0,0 +1,86 @@
+#include "Frustum.h"
+#include "Clipper.h"
+#include <algorithm>
+#include <cmath>
+
+Frustum::Frustum() : _planes{}
+{
+}
+
+Frustum::~Frustum()
+{
+}
+
+// A point is inside when 0 <= x <= width * w, 0 <= y <= height * w and the near plane <= w <= the
+// far plane, where x, y and w are rows of the matrix applied to the point. Each inequality is a
+// plane made from a combination of rows
+void Frustum::Set(const Matrix& worldToScreen, int width, int height)
+{
+	float rows[4][4];
+	for (int row = 0; row < 4; row++)
+	{
+		for (int column = 0; column < 4; column++)
+		{
+			rows[row][column] = worldToScreen.GetM(row, column);
+		}
+	}
+	for (int i = 0; i < 4; i++)
+	{
+		_planes[0][i] = rows[0][i];
+		_planes[1][i] = float(width) * rows[3][i] - rows[0][i];
+		_planes[2][i] = rows[1][i];
+		_planes[3][i] = float(height) * rows[3][i] - rows[1][i];
+		_planes[4][i] = rows[3][i];
+		_planes[5][i] = -rows[3][i];
+	}
+	_planes[4][3] -= CLIP_NEAR_PLANE;
+	_planes[5][3] += CLIP_FAR_PLANE;
+
+	// Normalises the planes so that they give the distance of a point from them
+	for (float* plane : _planes)
+	{
+		float length = sqrtf(plane[0] * plane[0] + plane[1] * plane[1] + plane[2] * plane[2]);
+		if (length > 0)
+		{
+			for (int i = 0; i < 4; i++)
+			{
+				plane[i] /= length;
+			}
+		}
+	}
+}
+
+bool Frustum::IsVisible(const BoundingVolume& volume, const Matrix& modelTransform) const
+{
+	if (volume.IsEmpty())
+	{
+		return false;
+	}
+	float x;
+	float y;
+	float z;
+	float radius;
+	volume.GetSphere(x, y, z, radius);
+
+	float centre[3];
+	float scale = 0;
+	for (int row = 0; row < 3; row++)
+	{
+		centre[row] = modelTransform.GetM(row, 0) * x + modelTransform.GetM(row, 1) * y + modelTransform.GetM(row, 2) * z + modelTransform.GetM(row, 3);
+		float column = sqrtf(modelTransform.GetM(0, row) * modelTransform.GetM(0, row) + modelTransform.GetM(1, row) * modelTransform.GetM(1, row) + modelTransform.GetM(2, row) * modelTransform.GetM(2, row));
+		scale = std::max(scale, column);
+	}
+	return IsSphereVisible(centre[0], centre[1], centre[2], radius * scale);
+}
+
+bool Frustum::IsSphereVisible(float x, float y, float z, float radius) const
+{
+	for (const float* plane : _planes)
+	{
+		if (plane[0] * x + plane[1] * y + plane[2] * z + plane[3] < -radius)
+		{
+			return false;
+		}
+	}
+	return true;
+}
@@ -0,0 +1,29 @@
+#pragma once
+#include "BoundingVolume.h"
+#include "Matrix.h"
+
+// The part of the world that can be seen, bounded by the edges of the screen and the near and
+// far clipping planes. Models and parts of models are tested against it before any work is done
+// on their vertices, so that nothing is transformed, lit or drawn when it cannot be seen
+class Frustum
+{
+public:
+	Frustum();
+	~Frustum();
+
+	// Takes the planes from the matrix that transforms world space into homogeneous screen space
+	// for a screen of the given size, the same space that triangles are clipped in
+	void				Set(const Matrix& worldToScreen, int width, int height);
+	// Returns false if the bounding sphere of a volume, transformed from model space into world
+	// space, is entirely outside one of the planes. The sphere is scaled by the largest scale in
+	// the transform, so it always contains the transformed volume
+	bool				IsVisible(const BoundingVolume& volume, const Matrix& modelTransform) const;
+	// Returns false if a sphere in world space is entirely outside one of the planes
+	bool				IsSphereVisible(float x, float y, float z, float radius) const;
+
+private:
+	static const int	PLANES = 6;
+
+	// a, b, c and d of each plane, with (a, b, c) a unit normal pointing into the frustum
+	float				_planes[PLANES][4];
+};
@@ -0,0 +1,297 @@
+#include "Golden.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+
+const double Golden::PIXEL_TOLERANCE = 0.001;
+
+// Frames in one loop of the demo
+const int GOLDEN_DEMO_FRAMES = 1450;
+// Frames after the start of a stage that it is captured at. Every stage lasts at least twice
+// this, and by then the model has moved away from where the previous stage left it
+const int GOLDEN_CAPTURE_DELAY = 25;
+
+std::vector<std::pair<std::string, std::string>> Golden::GetModels(const std::string& modelDirectory)
+{
+	// The models the demo itself uses, one animated and one with texture coordinates that
+	// show up errors in perspective correction
+	return { { modelDirectory + "/marvin.md2", modelDirectory + "/marvin.pcx" },
+			 { modelDirectory + "/cube.md2", modelDirectory + "/lines.pcx" } };
+}
+
+template <typename Function>
+bool Golden::Replay(Framework& framework, const std::string& modelPath, const std::string& texturePath, Function capture)
+{
+	if (!framework.Restart(modelPath, texturePath))
+	{
+		std::cerr << "Unable to load " << modelPath << std::endl;
+		return false;
+	}
+	size_t start = modelPath.find_last_of("/\\") + 1;
+	std::string modelName = modelPath.substr(start, modelPath.find_last_of('.') - start);
+
+	Bitmap& bitmap = framework.GetBitmap();
+	std::string stage;
+	int stageNumber = 0;
+	int stageStart = 0;
+	for (int frame = 0; frame < GOLDEN_DEMO_FRAMES; frame++)
+	{
+		framework.Update(bitmap);
+		framework.Render(bitmap);
+		FrameDescription description = framework.DescribeFrame();
+		if (description.stage != stage)
+		{
+			stage = description.stage;
+			stageNumber++;
+			stageStart = frame;
+		}
+		if (frame == stageStart + GOLDEN_CAPTURE_DELAY)
+		{
+			char number[16];
+			snprintf(number, sizeof(number), "_%02d_", stageNumber);
+			if (!capture(bitmap, modelName + number + description.drawMode + ".png"))
+			{
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+bool Golden::Write(Framework& framework, const std::string& modelDirectory, const std::string& directory)
+{
+	for (const auto& model : GetModels(modelDirectory))
+	{
+		bool written = Replay(framework, model.first, model.second, [&](const Bitmap& bitmap, const std::string& name)
+		{
+			std::string path = directory + "/" + name;
+			if (!bitmap.SavePNG(path.c_str()))
+			{
+				std::cerr << "Unable to write " << path << std::endl;
+				return false;
+			}
+			std::cout << "Wrote " << path << std::endl;
+			return true;
+		});
+		if (!written)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+bool Golden::Check(Framework& framework, const std::string& modelDirectory, const std::string& directory, const std::string& failureDirectory)
+{
+	int checked = 0;
+	int failed = 0;
+	for (const auto& model : GetModels(modelDirectory))
+	{
+		bool replayed = Replay(framework, model.first, model.second, [&](const Bitmap& bitmap, const std::string& name)
+		{
+			checked++;
+			Image reference;
+			if (!ReadImage(directory + "/" + name, reference))
+			{
+				std::cout << "MISSING " << name << std::endl;
+				failed++;
+				return true;
+			}
+			if (reference.width != bitmap.GetWidth() || reference.height != bitmap.GetHeight())
+			{
+				std::cout << "FAIL    " << name << ": reference is " << reference.width << "x" << reference.height
+						  << ", rendered at " << bitmap.GetWidth() << "x" << bitmap.GetHeight() << std::endl;
+				failed++;
+				return true;
+			}
+
+			int largestDifference = 0;
+			size_t different = Compare(bitmap, reference, largestDifference);
+			double fraction = double(different) / double(reference.pixels.size());
+			bool passed = fraction <= PIXEL_TOLERANCE;
+			std::cout << (passed ? "PASS    " : "FAIL    ") << name << ": " << different << " pixels differ ("
+					  << fraction * 100.0 << "%), largest difference " << largestDifference << std::endl;
+			if (!passed)
+			{
+				failed++;
+				if (!failureDirectory.empty())
+				{
+					bitmap.SavePNG((failureDirectory + "/" + name).c_str());
+				}
+			}
+			return true;
+		});
+		if (!replayed)
+		{
+			return false;
+		}
+	}
+	std::cout << checked - failed << " of " << checked << " golden images passed" << std::endl;
+	return failed == 0;
+}
+
+// Reads a big-endian 32-bit value, as used throughout PNG files
+static uint32_t ReadUInt(const unsigned char* data)
+{
+	return (uint32_t(data[0]) << 24) | (uint32_t(data[1]) << 16) | (uint32_t(data[2]) << 8) | uint32_t(data[3]);
+}
+
+// Reads a PNG file as written by Bitmap::SavePNG, which is 8-bit RGB with no interlacing or row
+// filters, and with the image data in stored (uncompressed) deflate blocks. Anything else,
+// including PNGs that have been compressed by another tool, cannot be read
+
+bool Golden::ReadImage(const std::string& filename, Image& image)
+{
+	std::ifstream file(filename, std::ios::in | std::ios::binary);
+	std::vector<unsigned char> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+	const unsigned char signature[8] = { 137, 'P', 'N', 'G', 13, 10, 26, 10 };
+	if (data.size() < sizeof(signature) || memcmp(data.data(), signature, sizeof(signature)) != 0)
+	{
+		return false;
+	}
+
+	// Collects the header and the image data from the chunks
+	std::vector<unsigned char> header;
+	std::vector<unsigned char> zlib;
+	size_t offset = sizeof(signature);
+	while (offset + 12 <= data.size())
+	{
+		size_t length = ReadUInt(&data[offset]);
+		std::string type(data.begin() + offset + 4, data.begin() + offset + 8);
+		if (length > data.size() - offset - 12)
+		{
+			return false;
+		}
+		const unsigned char* chunk = &data[offset + 8];
+		if (type == "IHDR")
+		{
+			header.assign(chunk, chunk + length);
+		}
+		else if (type == "IDAT")
+		{
+			zlib.insert(zlib.end(), chunk, chunk + length);
+		}
+		else if (type == "IEND")
+		{
+			break;
+		}
+		offset += length + 12;
+	}
+	if (header.size() != 13 || header[8] != 8 || header[9] != 2 || header[10] != 0 || header[11] != 0 || header[12] != 0)
+	{
+		return false;
+	}
+	image.width = ReadUInt(&header[0]);
+	image.height = ReadUInt(&header[4]);
+	if (image.width == 0 || image.height == 0)
+	{
+		return false;
+	}
+
+	// Joins the stored blocks back into the rows, each of which starts with its filter type
+	std::vector<unsigned char> raw;
+	size_t rowSize = size_t(image.width) * 3 + 1;
+	offset = 2;
+	bool last = false;
+	while (!last)
+	{
+		if (offset + 5 > zlib.size() || (zlib[offset] & 0x06) != 0)
+		{
+			return false;
+		}
+		last = (zlib[offset] & 1) != 0;
+		size_t blockSize = size_t(zlib[offset + 1]) | (size_t(zlib[offset + 2]) << 8);
+		offset += 5;
+		if (blockSize > zlib.size() - offset)
+		{
+			return false;
+		}
+		raw.insert(raw.end(), zlib.begin() + offset, zlib.begin() + offset + blockSize);
+		offset += blockSize;
+	}
+	if (raw.size() != rowSize * image.height)
+	{
+		return false;
+	}
+
+	image.pixels.resize(size_t(image.width) * size_t(image.height));
+	for (size_t y = 0; y < image.height; y++)
+	{
+		const unsigned char* row = &raw[y * rowSize];
+		if (row[0] != 0)
+		{
+			return false;
+		}
+		for (size_t x = 0; x < image.width; x++)
+		{
+			const unsigned char* pixel = row + 1 + x * 3;
+			image.pixels[y * image.width + x] = (uint32_t(pixel[0]) << 16) | (uint32_t(pixel[1]) << 8) | uint32_t(pixel[2]);
+		}
+	}
+	return true;
+}
+
+// Largest difference between the channels of two pixels
+static int PixelDifference(uint32_t a, uint32_t b)
+{
+	int difference = 0;
+	for (int shift = 0; shift < 24; shift += 8)
+	{
+		difference = std::max(difference, abs(int((a >> shift) & 0xFF) - int((b >> shift) & 0xFF)));
+	}
+	return difference;
+}
+
+// Returns true if a pixel within one pixel of (x, y) in an image is within tolerance of pixel.
+// getPixel returns the pixel at a position in the image
+template <typename GetPixel>
+static bool MatchesNeighbour(uint32_t pixel, int x, int y, int width, int height, GetPixel getPixel)
+{
+	for (int neighbourY = std::max(y - 1, 0); neighbourY <= std::min(y + 1, height - 1); neighbourY++)
+	{
+		for (int neighbourX = std::max(x - 1, 0); neighbourX <= std::min(x + 1, width - 1); neighbourX++)
+		{
+			if (PixelDifference(pixel, getPixel(neighbourX, neighbourY)) <= Golden::CHANNEL_TOLERANCE)
+			{
+				return true;
+			}
+		}
+	}
+	return false;
+}
+
+size_t Golden::Compare(const Bitmap& bitmap, const Image& reference, int& largestDifference)
+{
+	int width = int(reference.width);
+	int height = int(reference.height);
+	auto getRendered = [&](int x, int y) { return bitmap.GetRow(y)[x]; };
+	auto getReference = [&](int x, int y) { return reference.pixels[size_t(y) * reference.width + size_t(x)]; };
+
+	size_t different = 0;
+	largestDifference = 0;
+	for (int y = 0; y < height; y++)
+	{
+		for (int x = 0; x < width; x++)
+		{
+			uint32_t rendered = getRendered(x, y);
+			uint32_t expected = getReference(x, y);
+			int difference = PixelDifference(rendered, expected);
+			largestDifference = std::max(largestDifference, difference);
+			if (difference <= CHANNEL_TOLERANCE)
+			{
+				continue;
+			}
+			// Check both ways round, so that a line missing from either image is found
+			if (!MatchesNeighbour(rendered, x, y, width, height, getReference) ||
+				!MatchesNeighbour(expected, x, y, width, height, getRendered))
+			{
+				different++;
+			}
+		}
+	}
+	return different;
+}
@@ -0,0 +1,74 @@
+#pragma once
+#include "Framework.h"
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Golden image regression check, run from the headless platform with --golden-write DIR or
+// --golden-check DIR. The demo is replayed from the first frame with a fixed model, as the
+// benchmark does, and one frame from the middle of every stage is captured. Each stage has a
+// different combination of draw mode and lighting, so between them the captures cover every
+// draw mode. That includes the Gouraud stages, which were drawn by the Bresenham mode before it
+// was replaced by the half-space rasteriser and renamed. --golden-write saves the captures as the
+// reference images and --golden-check compares the captures against them.
+//
+// Images are compared with a tolerance rather than exactly, so that small changes in rounding
+// do not fail the check. A pixel only counts as different if no pixel within one pixel of it
+// in the other image is within CHANNEL_TOLERANCE of it in every channel. That lets an edge
+// move by a pixel, as happens when the fill rules or the order of calculations change, while
+// a missing or wrongly shaded triangle still fails. A capture fails if more than
+// PIXEL_TOLERANCE of its pixels differ
+//
+// Reference images are PNG files named <model>_<stage number>_<draw mode>.png. The references
+// in the Golden directory are checked in, rendered at REFERENCE_WIDTH x REFERENCE_HEIGHT, which
+// the headless platform uses for both options unless --size is given. To check them, run this
+// from the project directory:
+//
+//   rasteriser --golden-check Golden
+//
+// and add --output DIR to keep the captures that fail. After a change that is meant to alter the
+// output, look at those, then write new references with --golden-write Golden and check them in
+// with the change
+class Golden
+{
+public:
+	// Size of the checked in reference images. Small, as they are stored uncompressed
+	static const unsigned int REFERENCE_WIDTH = 160;
+	static const unsigned int REFERENCE_HEIGHT = 120;
+	// Largest difference allowed in any one channel of a pixel
+	static const int CHANNEL_TOLERANCE = 8;
+	// Largest fraction of pixels that may differ
+	static const double PIXEL_TOLERANCE;
+
+	// Writes the reference images for every model into directory, which must exist. Returns
+	// false if a model could not be loaded or an image could not be written
+	static bool Write(Framework& framework, const std::string& modelDirectory, const std::string& directory);
+	// Compares every capture against its reference image in directory, printing the result of
+	// each. Captures that fail are written to failureDirectory, unless it is empty. Returns
+	// false if any capture failed or its reference image could not be read
+	static bool Check(Framework& framework, const std::string& modelDirectory, const std::string& directory, const std::string& failureDirectory);
+
+private:
+	// Pixels of an image in the 0x00RRGGBB layout used by Bitmap
+	struct Image
+	{
+		unsigned int			width;
+		unsigned int			height;
+		std::vector<uint32_t>	pixels;
+	};
+
+	// Replays the demo with a model, calling capture with the bitmap at the frame to capture
+	// from each stage. Stops and returns false if capture does
+	template <typename Function>
+	static bool Replay(Framework& framework, const std::string& modelPath, const std::string& texturePath, Function capture);
+	// Models and textures the demo is replayed with
+	static std::vector<std::pair<std::string, std::string>> GetModels(const std::string& modelDirectory);
+
+	// Reads a PNG file written by Bitmap::SavePNG. Returns false if it is missing or in any
+	// other form
+	static bool ReadImage(const std::string& filename, Image& image);
+	// Returns the number of pixels that differ between the bitmap and the reference, and the
+	// largest difference in any channel of any pixel
+	static size_t Compare(const Bitmap& bitmap, const Image& reference, int& largestDifference);
+};
@@ -0,0 +1,368 @@
+#include "HeadlessPlatform.h"
+#include "BakedMesh.h"
+#include "Benchmark.h"
+#include "Golden.h"
+#include "Microbenchmarks.h"
+#include "Profiler.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <thread>
+
+const int DEFAULT_HEADLESS_FRAMES = 1450;
+
+#ifdef RASTERISER_HEADLESS
+int main(int argc, char* argv[])
+{
+	// We can only run if an instance of a class that inherits from Framework
+	// has been created
+	Framework* framework = Framework::GetFramework();
+	if (framework)
+	{
+		HeadlessPlatform platform(argc, argv);
+		return framework->Run(platform);
+	}
+	return -1;
+}
+
+#endif
+
+HeadlessPlatform::HeadlessPlatform(int argc, char* argv[])
+	: _frames(DEFAULT_HEADLESS_FRAMES), _width(0), _height(0), _dumpEvery(1), _format("png"), _threads(0),
+	  _modelDirectory("Models"), _goldenWrite(false), _sizeGiven(false), _pipelined(false)
+{
+	_frameLoop.SetMode(FrameLoop::Mode::Uncapped, FrameLoop::DEFAULT_RATE);
+	_validArguments = ParseArguments(argc, argv);
+}
+
+HeadlessPlatform::~HeadlessPlatform()
+{
+}
+
+// Parses the command line options described in HeadlessPlatform.h
+//
+// Returns false if any option is not recognised or has an invalid value
+
+bool HeadlessPlatform::ParseArguments(int argc, char* argv[])
+{
+	for (int i = 1; i < argc; i++)
+	{
+		std::string option = argv[i];
+		// Every option takes a value
+		if (i + 1 >= argc)
+		{
+			std::cerr << "Missing value for " << option << std::endl;
+			return false;
+		}
+		const char* value = argv[++i];
+		if (option == "--frames")
+		{
+			_frames = atoi(value);
+		}
+		else if (option == "--size")
+		{
+			const char* separator = strchr(value, 'x');
+			if (separator == nullptr)
+			{
+				std::cerr << "Invalid size " << value << std::endl;
+				return false;
+			}
+			_width = static_cast<unsigned int>(atoi(value));
+			_height = static_cast<unsigned int>(atoi(separator + 1));
+			_sizeGiven = true;
+		}
+		else if (option == "--threads")
+		{
+			_threads = atoi(value);
+		}
+		else if (option == "--output")
+		{
+			_outputDirectory = value;
+		}
+		else if (option == "--every")
+		{
+			_dumpEvery = atoi(value);
+		}
+		else if (option == "--format")
+		{
+			_format = value;
+			if (_format != "png" && _format != "ppm")
+			{
+				std::cerr << "Unknown image format " << value << std::endl;
+				return false;
+			}
+		}
+		else if (option == "--loop" || option == "--rate")
+		{
+			FrameLoop::Mode mode = _frameLoop.GetMode();
+			double rate = _frameLoop.GetRate();
+			if (option == "--loop" && !FrameLoop::ParseMode(value, mode))
+			{
+				std::cerr << "Unknown loop mode " << value << std::endl;
+				return false;
+			}
+			if (option == "--rate")
+			{
+				rate = atof(value);
+				if (rate <= 0)
+				{
+					std::cerr << "Invalid rate " << value << std::endl;
+					return false;
+				}
+			}
+			_frameLoop.SetMode(mode, rate);
+		}
+		else if (option == "--pipeline")
+		{
+			std::string setting = value;
+			if (setting != "on" && setting != "off")
+			{
+				std::cerr << "Invalid pipeline setting " << value << std::endl;
+				return false;
+			}
+			_pipelined = setting == "on";
+		}
+		else if (option == "--microbenchmark")
+		{
+			_microbenchmark = value;
+		}
+		else if (option == "--bake")
+		{
+			_bakeDirectory = value;
+		}
+		else if (option == "--benchmark")
+		{
+			_benchmarkFile = value;
+		}
+		else if (option == "--models")
+		{
+			_modelDirectory = value;
+		}
+		else if (option == "--golden-write" || option == "--golden-check")
+		{
+			_goldenDirectory = value;
+			_goldenWrite = option == "--golden-write";
+		}
+		else if (option == "--profile")
+		{
+#ifdef RASTERISER_PROFILE
+			_profileFile = value;
+#else
+			std::cerr << "--profile needs a build with RASTERISER_PROFILE defined" << std::endl;
+			return false;
+#endif
+		}
+		else
+		{
+			std::cerr << "Unknown option " << option << std::endl;
+			return false;
+		}
+	}
+	return _frames >= 0 && _dumpEvery > 0 && _threads >= 0;
+}
+
+// Create the in-memory bitmap that the framework draws on
+
+bool HeadlessPlatform::Initialise(Framework& framework)
+{
+	if (!_validArguments)
+	{
+		return false;
+	}
+	if (_width == 0 || _height == 0)
+	{
+		// Golden images must be rendered at the size of the references
+		_width = _goldenDirectory.empty() ? framework.GetWidth() : Golden::REFERENCE_WIDTH;
+		_height = _goldenDirectory.empty() ? framework.GetHeight() : Golden::REFERENCE_HEIGHT;
+	}
+	framework.SetThreadCount(static_cast<unsigned int>(_threads));
+	return framework.GetBitmap().Create(_width, _height);
+}
+
+// Runs the requested number of frames as fast as possible, writing any
+// requested frames to disk, then reports how long it took. If a microbenchmark,
+// baking, the benchmark or a golden image check was requested, that is done instead
+
+int HeadlessPlatform::MainLoop(Framework& framework)
+{
+	if (!_bakeDirectory.empty())
+	{
+		return BakedMesh::ConvertDirectory(_bakeDirectory) ? 0 : -1;
+	}
+	if (!_microbenchmark.empty())
+	{
+		if (!Microbenchmarks::Run(_microbenchmark))
+		{
+			std::cerr << "Unknown microbenchmark " << _microbenchmark << std::endl;
+			return -1;
+		}
+		return 0;
+	}
+
+	if (!_benchmarkFile.empty())
+	{
+		return RunBenchmark(framework);
+	}
+	if (!_goldenDirectory.empty())
+	{
+		return RunGolden(framework);
+	}
+	if (_pipelined)
+	{
+		return RunPipelined(framework);
+	}
+
+	Bitmap& bitmap = framework.GetBitmap();
+	double totalTime = 0;
+	int updates = 0;
+
+	_frameLoop.Start();
+	for (int frame = 0; frame < _frames; frame++)
+	{
+		while (!_frameLoop.Step(framework, bitmap))
+		{
+			std::this_thread::sleep_for(std::chrono::duration<double>(_frameLoop.GetTimeToNextFrame()));
+		}
+		totalTime += _frameLoop.GetFrameTime();
+		updates += _frameLoop.GetFrameUpdates();
+
+		// Writing a frame out is the nearest thing to presenting it when there is no window
+		if (!_outputDirectory.empty() && frame % _dumpEvery == 0)
+		{
+			PROFILE_SCOPE(ProfileStage::Present);
+			if (!SaveFrame(bitmap, frame))
+			{
+				std::cerr << "Unable to write frame " << frame << " to " << _outputDirectory << std::endl;
+				return -1;
+			}
+		}
+		PROFILE_END_FRAME();
+	}
+
+	std::cout << "Rendered " << _frames << " frames at " << _width << "x" << _height
+			  << " in " << totalTime << "s";
+	if (_frames > 0)
+	{
+		std::cout << " (" << totalTime * 1000.0 / _frames << "ms per frame)";
+	}
+	if (_frameLoop.GetMode() == FrameLoop::Mode::FixedTimestep)
+	{
+		std::cout << " with " << updates << " updates";
+	}
+	std::cout << std::endl;
+	return WriteProfile() ? 0 : -1;
+}
+
+// Runs the requested number of frames through the pipeline, writing out the requested frames
+// on this thread as each one is rendered
+
+int HeadlessPlatform::RunPipelined(Framework& framework)
+{
+	FramePipeline pipeline;
+	auto createBitmap = [this](Bitmap& bitmap) { return bitmap.Create(_width, _height); };
+	auto startTime = std::chrono::steady_clock::now();
+	_frameLoop.Start();
+	if (!pipeline.Start(framework, _frameLoop, createBitmap, nullptr))
+	{
+		std::cerr << "Unable to start the pipeline" << std::endl;
+		return -1;
+	}
+	for (int frame = 0; frame < _frames; frame++)
+	{
+		const Bitmap* bitmap = pipeline.NextFrame(true);
+		if (!_outputDirectory.empty() && frame % _dumpEvery == 0)
+		{
+			PROFILE_SCOPE(ProfileStage::Present);
+			if (!SaveFrame(*bitmap, frame))
+			{
+				std::cerr << "Unable to write frame " << frame << " to " << _outputDirectory << std::endl;
+				return -1;
+			}
+		}
+		PROFILE_END_FRAME();
+	}
+	pipeline.Stop();
+	double totalTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+
+	std::cout << "Rendered " << _frames << " frames at " << _width << "x" << _height
+			  << " in " << totalTime << "s through the pipeline";
+	if (_frames > 0)
+	{
+		std::cout << " (" << totalTime * 1000.0 / _frames << "ms per frame)";
+	}
+	std::cout << std::endl;
+	return WriteProfile() ? 0 : -1;
+}
+
+// Runs the benchmark at the size given on the command line, or at the default sizes
+
+int HeadlessPlatform::RunBenchmark(Framework& framework)
+{
+	std::vector<Benchmark::Size> sizes = Benchmark::GetDefaultSizes();
+	if (_sizeGiven)
+	{
+		sizes = { { _width, _height } };
+	}
+
+	bool succeeded;
+	if (_benchmarkFile == "-")
+	{
+		succeeded = Benchmark::Run(framework, _modelDirectory, sizes, _frames, std::cout);
+	}
+	else
+	{
+		std::ofstream file(_benchmarkFile);
+		if (!file)
+		{
+			std::cerr << "Unable to write benchmark results to " << _benchmarkFile << std::endl;
+			return -1;
+		}
+		succeeded = Benchmark::Run(framework, _modelDirectory, sizes, _frames, file);
+	}
+	return succeeded && WriteProfile() ? 0 : -1;
+}
+
+// Writes or checks the golden images at the size of the bitmap
+
+int HeadlessPlatform::RunGolden(Framework& framework)
+{
+	if (_goldenWrite)
+	{
+		return Golden::Write(framework, _modelDirectory, _goldenDirectory) ? 0 : -1;
+	}
+	return Golden::Check(framework, _modelDirectory, _goldenDirectory, _outputDirectory) ? 0 : -1;
+}
+
+// Prints the profile statistics and writes the trace, if --profile was given
+
+bool HeadlessPlatform::WriteProfile() const
+{
+#ifdef RASTERISER_PROFILE
+	if (!_profileFile.empty())
+	{
+		Profiler::Get().WriteStatistics(std::cout);
+		if (!Profiler::Get().WriteTrace(_profileFile.c_str()))
+		{
+			std::cerr << "Unable to write profile to " << _profileFile << std::endl;
+			return false;
+		}
+	}
+#endif
+	return true;
+}
+
+// Writes the bitmap to <output directory>/frame_NNNNN.<format>
+
+bool HeadlessPlatform::SaveFrame(const Bitmap& bitmap, int frame) const
+{
+	char filename[32];
+	snprintf(filename, sizeof(filename), "frame_%05d.", frame);
+	std::string path = _outputDirectory + "/" + filename + _format;
+	if (_format == "ppm")
+	{
+		return bitmap.SavePPM(path.c_str());
+	}
+	return bitmap.SavePNG(path.c_str());
+}
@@ -0,0 +1,90 @@
+#pragma once
+#include "Platform.h"
+#include "Framework.h"
+#include "FrameLoop.h"
+#include "FramePipeline.h"
+#include <string>
+
+// Platform layer that renders into an in-memory bitmap with no display attached.
+// Used to run, benchmark and regression test the rasteriser on machines without a window system.
+// On Windows define RASTERISER_HEADLESS and link with the Console subsystem to use it.
+// Elsewhere it is always used and the whole project can be built from the project
+// directory with:
+//
+//   g++ -std=c++17 -O2 *.cpp -o rasteriser
+//
+// Command line options:
+//   --frames N      Number of frames to run (default 1450, one full loop of the demo)
+//   --size WxH      Size of the bitmap to render into (default is the framework size)
+//   --threads N     Number of threads to render with (default 0, one per core)
+//   --output DIR    Directory that frames are written to. No frames are written if not specified
+//   --every N       Only write every Nth frame (default 1)
+//   --format F      Image format of written frames, either png or ppm (default png)
+//   --loop MODE     How often frames are updated and rendered, either uncapped, fixed or
+//                   timestep (default uncapped, see FrameLoop.h). Only the uncapped mode draws
+//                   the same frames every run
+//   --rate N        Frames a second for the fixed mode, or updates a second for the timestep
+//                   mode (default 30)
+//   --pipeline on|off
+//                   Prepares each frame while the one before is rendered and the one before
+//                   that is written out, each on its own thread (default off, see
+//                   FramePipeline.h). The time reported is then the total time taken
+//   --microbenchmark NAME
+//                   Runs one of the benchmarks in Microbenchmarks.h instead of rendering
+//   --bake DIR      Bakes every MD2 model in a directory into the format read by BakedMesh,
+//                   instead of rendering. Baked meshes are then loaded in place of the models
+//   --benchmark FILE
+//                   Replays the demo with every model in the models directory instead of
+//                   rendering, and writes the time taken by each stage to FILE, or to standard
+//                   output if FILE is -. The demo is run at the size given by --size, or at each
+//                   of several sizes if there is none, for --frames frames (see Benchmark.h)
+//   --models DIR    Directory of the models used by --benchmark and the golden image options
+//                   (default Models)
+//   --golden-write DIR
+//                   Replays the demo and writes a frame from each stage to DIR as the reference
+//                   images for --golden-check, instead of rendering (see Golden.h)
+//   --golden-check DIR
+//                   Replays the demo and compares a frame from each stage against the reference
+//                   images in DIR, instead of rendering. Frames that fail are written to the
+//                   --output directory, if there is one. Both golden image options render at
+//                   the size of the checked in references in Golden unless --size is given
+//   --profile FILE  Prints the time taken by each stage of the last frames, and writes their
+//                   timings to FILE as a Chrome trace. Only available when built with
+//                   RASTERISER_PROFILE defined (see Profiler.h). The statistics mix stages from
+//                   different frames when used with --pipeline on, so only the trace is useful
+class HeadlessPlatform : public Platform
+{
+public:
+	HeadlessPlatform(int argc, char* argv[]);
+	~HeadlessPlatform();
+
+	bool Initialise(Framework& framework);
+	int MainLoop(Framework& framework);
+
+private:
+	bool			_validArguments;
+	int				_frames;
+	unsigned int	_width;
+	unsigned int	_height;
+	std::string		_outputDirectory;
+	int				_dumpEvery;
+	std::string		_format;
+	int				_threads;
+	std::string		_microbenchmark;
+	std::string		_bakeDirectory;
+	std::string		_profileFile;
+	std::string		_benchmarkFile;
+	std::string		_modelDirectory;
+	std::string		_goldenDirectory;
+	bool			_goldenWrite;
+	bool			_sizeGiven;
+	FrameLoop		_frameLoop;
+	bool			_pipelined;
+
+	bool ParseArguments(int argc, char* argv[]);
+	bool SaveFrame(const Bitmap& bitmap, int frame) const;
+	int RunPipelined(Framework& framework);
+	int RunBenchmark(Framework& framework);
+	int RunGolden(Framework& framework);
+	bool WriteProfile() const;
+};
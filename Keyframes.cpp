@@ -0,0 +1,246 @@
+#include "Keyframes.h"
+#include "Simd.h"
+#include <algorithm>
+
+// Number of normals in the table that MD2 vertices index
+const size_t MD2_NORMAL_COUNT = 162;
+
+// The normals that MD2 vertices can have, in the MD2 axes where z is up. The extra zero normal
+// at the end is used for any index outside the table
+static const float MD2_NORMALS[MD2_NORMAL_COUNT + 1][3] =
+{
+	{ -0.525731f, 0.000000f, 0.850651f }, { -0.442863f, 0.238856f, 0.864188f }, { -0.295242f, 0.000000f, 0.955423f },
+	{ -0.309017f, 0.500000f, 0.809017f }, { -0.162460f, 0.262866f, 0.951056f }, { 0.000000f, 0.000000f, 1.000000f },
+	{ 0.000000f, 0.850651f, 0.525731f }, { -0.147621f, 0.716567f, 0.681718f }, { 0.147621f, 0.716567f, 0.681718f },
+	{ 0.000000f, 0.525731f, 0.850651f }, { 0.309017f, 0.500000f, 0.809017f }, { 0.525731f, 0.000000f, 0.850651f },
+	{ 0.295242f, 0.000000f, 0.955423f }, { 0.442863f, 0.238856f, 0.864188f }, { 0.162460f, 0.262866f, 0.951056f },
+	{ -0.681718f, 0.147621f, 0.716567f }, { -0.809017f, 0.309017f, 0.500000f }, { -0.587785f, 0.425325f, 0.688191f },
+	{ -0.850651f, 0.525731f, 0.000000f }, { -0.864188f, 0.442863f, 0.238856f }, { -0.716567f, 0.681718f, 0.147621f },
+	{ -0.688191f, 0.587785f, 0.425325f }, { -0.500000f, 0.809017f, 0.309017f }, { -0.238856f, 0.864188f, 0.442863f },
+	{ -0.425325f, 0.688191f, 0.587785f }, { -0.716567f, 0.681718f, -0.147621f }, { -0.500000f, 0.809017f, -0.309017f },
+	{ -0.525731f, 0.850651f, 0.000000f }, { 0.000000f, 0.850651f, -0.525731f }, { -0.238856f, 0.864188f, -0.442863f },
+	{ 0.000000f, 0.955423f, -0.295242f }, { -0.262866f, 0.951056f, -0.162460f }, { 0.000000f, 1.000000f, 0.000000f },
+	{ 0.000000f, 0.955423f, 0.295242f }, { -0.262866f, 0.951056f, 0.162460f }, { 0.238856f, 0.864188f, 0.442863f },
+	{ 0.262866f, 0.951056f, 0.162460f }, { 0.500000f, 0.809017f, 0.309017f }, { 0.238856f, 0.864188f, -0.442863f },
+	{ 0.262866f, 0.951056f, -0.162460f }, { 0.500000f, 0.809017f, -0.309017f }, { 0.850651f, 0.525731f, 0.000000f },
+	{ 0.716567f, 0.681718f, 0.147621f }, { 0.716567f, 0.681718f, -0.147621f }, { 0.525731f, 0.850651f, 0.000000f },
+	{ 0.425325f, 0.688191f, 0.587785f }, { 0.864188f, 0.442863f, 0.238856f }, { 0.688191f, 0.587785f, 0.425325f },
+	{ 0.809017f, 0.309017f, 0.500000f }, { 0.681718f, 0.147621f, 0.716567f }, { 0.587785f, 0.425325f, 0.688191f },
+	{ 0.955423f, 0.295242f, 0.000000f }, { 1.000000f, 0.000000f, 0.000000f }, { 0.951056f, 0.162460f, 0.262866f },
+	{ 0.850651f, -0.525731f, 0.000000f }, { 0.955423f, -0.295242f, 0.000000f }, { 0.864188f, -0.442863f, 0.238856f },
+	{ 0.951056f, -0.162460f, 0.262866f }, { 0.809017f, -0.309017f, 0.500000f }, { 0.681718f, -0.147621f, 0.716567f },
+	{ 0.850651f, 0.000000f, 0.525731f }, { 0.864188f, 0.442863f, -0.238856f }, { 0.809017f, 0.309017f, -0.500000f },
+	{ 0.951056f, 0.162460f, -0.262866f }, { 0.525731f, 0.000000f, -0.850651f }, { 0.681718f, 0.147621f, -0.716567f },
+	{ 0.681718f, -0.147621f, -0.716567f }, { 0.850651f, 0.000000f, -0.525731f }, { 0.809017f, -0.309017f, -0.500000f },
+	{ 0.864188f, -0.442863f, -0.238856f }, { 0.951056f, -0.162460f, -0.262866f }, { 0.147621f, 0.716567f, -0.681718f },
+	{ 0.309017f, 0.500000f, -0.809017f }, { 0.425325f, 0.688191f, -0.587785f }, { 0.442863f, 0.238856f, -0.864188f },
+	{ 0.587785f, 0.425325f, -0.688191f }, { 0.688191f, 0.587785f, -0.425325f }, { -0.147621f, 0.716567f, -0.681718f },
+	{ -0.309017f, 0.500000f, -0.809017f }, { 0.000000f, 0.525731f, -0.850651f }, { -0.525731f, 0.000000f, -0.850651f },
+	{ -0.442863f, 0.238856f, -0.864188f }, { -0.295242f, 0.000000f, -0.955423f }, { -0.162460f, 0.262866f, -0.951056f },
+	{ 0.000000f, 0.000000f, -1.000000f }, { 0.295242f, 0.000000f, -0.955423f }, { 0.162460f, 0.262866f, -0.951056f },
+	{ -0.442863f, -0.238856f, -0.864188f }, { -0.309017f, -0.500000f, -0.809017f }, { -0.162460f, -0.262866f, -0.951056f },
+	{ 0.000000f, -0.850651f, -0.525731f }, { -0.147621f, -0.716567f, -0.681718f }, { 0.147621f, -0.716567f, -0.681718f },
+	{ 0.000000f, -0.525731f, -0.850651f }, { 0.309017f, -0.500000f, -0.809017f }, { 0.442863f, -0.238856f, -0.864188f },
+	{ 0.162460f, -0.262866f, -0.951056f }, { 0.238856f, -0.864188f, -0.442863f }, { 0.500000f, -0.809017f, -0.309017f },
+	{ 0.425325f, -0.688191f, -0.587785f }, { 0.716567f, -0.681718f, -0.147621f }, { 0.688191f, -0.587785f, -0.425325f },
+	{ 0.587785f, -0.425325f, -0.688191f }, { 0.000000f, -0.955423f, -0.295242f }, { 0.000000f, -1.000000f, 0.000000f },
+	{ 0.262866f, -0.951056f, -0.162460f }, { 0.000000f, -0.850651f, 0.525731f }, { 0.000000f, -0.955423f, 0.295242f },
+	{ 0.238856f, -0.864188f, 0.442863f }, { 0.262866f, -0.951056f, 0.162460f }, { 0.500000f, -0.809017f, 0.309017f },
+	{ 0.716567f, -0.681718f, 0.147621f }, { 0.525731f, -0.850651f, 0.000000f }, { -0.238856f, -0.864188f, -0.442863f },
+	{ -0.500000f, -0.809017f, -0.309017f }, { -0.262866f, -0.951056f, -0.162460f }, { -0.850651f, -0.525731f, 0.000000f },
+	{ -0.716567f, -0.681718f, -0.147621f }, { -0.716567f, -0.681718f, 0.147621f }, { -0.525731f, -0.850651f, 0.000000f },
+	{ -0.500000f, -0.809017f, 0.309017f }, { -0.238856f, -0.864188f, 0.442863f }, { -0.262866f, -0.951056f, 0.162460f },
+	{ -0.864188f, -0.442863f, 0.238856f }, { -0.809017f, -0.309017f, 0.500000f }, { -0.688191f, -0.587785f, 0.425325f },
+	{ -0.681718f, -0.147621f, 0.716567f }, { -0.442863f, -0.238856f, 0.864188f }, { -0.587785f, -0.425325f, 0.688191f },
+	{ -0.309017f, -0.500000f, 0.809017f }, { -0.147621f, -0.716567f, 0.681718f }, { -0.425325f, -0.688191f, 0.587785f },
+	{ -0.162460f, -0.262866f, 0.951056f }, { 0.442863f, -0.238856f, 0.864188f }, { 0.162460f, -0.262866f, 0.951056f },
+	{ 0.309017f, -0.500000f, 0.809017f }, { 0.147621f, -0.716567f, 0.681718f }, { 0.000000f, -0.525731f, 0.850651f },
+	{ 0.425325f, -0.688191f, 0.587785f }, { 0.587785f, -0.425325f, 0.688191f }, { 0.688191f, -0.587785f, 0.425325f },
+	{ -0.955423f, 0.295242f, 0.000000f }, { -0.951056f, 0.162460f, 0.262866f }, { -1.000000f, 0.000000f, 0.000000f },
+	{ -0.850651f, 0.000000f, 0.525731f }, { -0.955423f, -0.295242f, 0.000000f }, { -0.951056f, -0.162460f, 0.262866f },
+	{ -0.864188f, 0.442863f, -0.238856f }, { -0.951056f, 0.162460f, -0.262866f }, { -0.809017f, 0.309017f, -0.500000f },
+	{ -0.864188f, -0.442863f, -0.238856f }, { -0.951056f, -0.162460f, -0.262866f }, { -0.809017f, -0.309017f, -0.500000f },
+	{ -0.681718f, 0.147621f, -0.716567f }, { -0.681718f, -0.147621f, -0.716567f }, { -0.850651f, 0.000000f, -0.525731f },
+	{ -0.688191f, 0.587785f, -0.425325f }, { -0.587785f, 0.425325f, -0.688191f }, { -0.425325f, 0.688191f, -0.587785f },
+	{ -0.425325f, -0.688191f, -0.587785f }, { -0.587785f, -0.425325f, -0.688191f }, { -0.688191f, -0.587785f, -0.425325f },
+	{ 0.000000f, 0.000000f, 0.000000f }
+};
+
+Keyframes::Keyframes()
+{
+}
+
+Keyframes::~Keyframes()
+{
+}
+
+void Keyframes::Clear()
+{
+	_vertexCount = 0;
+	_paddedCount = 0;
+	_frames.clear();
+	_coordinates.clear();
+	_coordinateData = nullptr;
+	_normalSign = 1.0f;
+}
+
+void Keyframes::AddFrame(const char* name, const float scale[3], const float translate[3], const uint8_t* vertices, size_t vertexCount)
+{
+	// Every frame has the same number of vertices as the first
+	if (_frames.empty())
+	{
+		_vertexCount = vertexCount;
+		_paddedCount = (vertexCount + 3) & ~size_t(3);
+	}
+	else if (vertexCount != _vertexCount)
+	{
+		return;
+	}
+
+	// MD2 files have z as the up axis, so y and z are swapped over. The normal index follows
+	const int fileAxis[KEYFRAME_STREAMS] = { 0, 2, 1, 3 };
+
+	Frame frame;
+	frame.name = name;
+	for (int axis = 0; axis < 3; axis++)
+	{
+		frame.scale[axis] = scale[fileAxis[axis]];
+		frame.translate[axis] = translate[fileAxis[axis]];
+	}
+	_frames.push_back(frame);
+
+	size_t start = _coordinates.size();
+	_coordinates.resize(start + _paddedCount * KEYFRAME_STREAMS, 0);
+	for (int stream = 0; stream < KEYFRAME_STREAMS; stream++)
+	{
+		uint8_t* coordinates = &_coordinates[start + _paddedCount * stream];
+		for (size_t i = 0; i < vertexCount; i++)
+		{
+			coordinates[i] = vertices[i * 4 + fileAxis[stream]];
+		}
+	}
+	_coordinateData = _coordinates.data();
+}
+
+size_t Keyframes::GetFrameCount() const
+{
+	return _frames.size();
+}
+
+size_t Keyframes::GetVertexCount() const
+{
+	return _vertexCount;
+}
+
+const std::string& Keyframes::GetFrameName(size_t frame) const
+{
+	return _frames[frame].name;
+}
+
+size_t Keyframes::GetMemorySize() const
+{
+	return _frames.capacity() * sizeof(Frame) + _coordinates.capacity();
+}
+
+bool Keyframes::FindAnimation(const std::string& name, size_t& first, size_t& last) const
+{
+	bool found = false;
+	for (size_t i = 0; i < _frames.size(); i++)
+	{
+		// Strips the frame number from the end of the name
+		const std::string& frameName = _frames[i].name;
+		size_t length = frameName.find_last_not_of("0123456789") + 1;
+		if (frameName.compare(0, length, name) == 0 && length == name.length())
+		{
+			if (!found)
+			{
+				first = i;
+				found = true;
+			}
+			last = i;
+		}
+		else if (found)
+		{
+			// The frames of an animation are always together
+			break;
+		}
+	}
+	return found;
+}
+
+const uint8_t* Keyframes::GetNormalIndices(size_t frame) const
+{
+	return GetCoordinates(frame, 3);
+}
+
+const uint8_t* Keyframes::GetCoordinates(size_t frame, int stream) const
+{
+	return _coordinateData + (frame * KEYFRAME_STREAMS + stream) * _paddedCount;
+}
+
+// Adds up how far the table normals of the first frame point the same way as the given normals.
+// The table normals point out of the model, but models do not agree on which way round their
+// polygons are wound, and the calculated normals follow the winding
+void Keyframes::OrientNormals(const VertexBuffer& vertices)
+{
+	if (_frames.empty())
+	{
+		return;
+	}
+	const uint8_t* indices = GetNormalIndices(0);
+	float agreement = 0;
+	for (size_t i = 0; i < std::min(_vertexCount, vertices.GetCount()); i++)
+	{
+		const float* normal = MD2_NORMALS[std::min(static_cast<size_t>(indices[i]), MD2_NORMAL_COUNT)];
+		agreement += normal[0] * vertices.GetNormalX()[i] + normal[2] * vertices.GetNormalY()[i] + normal[1] * vertices.GetNormalZ()[i];
+	}
+	_normalSign = agreement < 0 ? -1.0f : 1.0f;
+}
+
+// Each coordinate is (q0 * scale0 + translate0) * (1 - amount) + (q1 * scale1 + translate1) * amount,
+// which is rearranged so that the scales and translations of both frames are combined once
+// per axis, leaving two multiplies and two adds per coordinate
+void Keyframes::Interpolate(size_t frame0, size_t frame1, float amount, VertexBuffer& vertices) const
+{
+	vertices.Resize(_vertexCount);
+	if (_frames.empty())
+	{
+		return;
+	}
+
+	const Frame& from = _frames[frame0];
+	const Frame& to = _frames[frame1];
+	float* outputs[3] = { vertices.GetX(), vertices.GetY(), vertices.GetZ() };
+	for (int axis = 0; axis < 3; axis++)
+	{
+		Float4 scale0 = Float4::Set1(from.scale[axis] * (1 - amount));
+		Float4 scale1 = Float4::Set1(to.scale[axis] * amount);
+		Float4 translate = Float4::Set1(from.translate[axis] * (1 - amount) + to.translate[axis] * amount);
+		const uint8_t* coordinates0 = GetCoordinates(frame0, axis);
+		const uint8_t* coordinates1 = GetCoordinates(frame1, axis);
+		float* output = outputs[axis];
+		for (size_t i = 0; i < _paddedCount; i += 4)
+		{
+			Float4 coordinate0 = Int4::LoadBytes(coordinates0 + i).ToFloat();
+			Float4 coordinate1 = Int4::LoadBytes(coordinates1 + i).ToFloat();
+			(coordinate0 * scale0 + coordinate1 * scale1 + translate).Store(output + i);
+		}
+	}
+
+	// Normals are looked up in the table, swapping y and z over as for the positions
+	float weight0 = _normalSign * (1 - amount);
+	float weight1 = _normalSign * amount;
+	const uint8_t* normals0 = GetNormalIndices(frame0);
+	const uint8_t* normals1 = GetNormalIndices(frame1);
+	float* normalX = vertices.GetNormalX();
+	float* normalY = vertices.GetNormalY();
+	float* normalZ = vertices.GetNormalZ();
+	for (size_t i = 0; i < _vertexCount; i++)
+	{
+		const float* normal0 = MD2_NORMALS[std::min(static_cast<size_t>(normals0[i]), MD2_NORMAL_COUNT)];
+		const float* normal1 = MD2_NORMALS[std::min(static_cast<size_t>(normals1[i]), MD2_NORMAL_COUNT)];
+		normalX[i] = normal0[0] * weight0 + normal1[0] * weight1;
+		normalY[i] = normal0[2] * weight0 + normal1[2] * weight1;
+		normalZ[i] = normal0[1] * weight0 + normal1[1] * weight1;
+	}
+}
@@ -0,0 +1,69 @@
+#pragma once
+#include "VertexBuffer.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Number of byte streams stored for each frame
+const int KEYFRAME_STREAMS = 4;
+
+// Frames of an animated model, kept quantised the way they are stored in an MD2 file. Each
+// coordinate is a byte, with a scale and translation for each axis of each frame, and each vertex
+// also has the byte index of its normal in the MD2 normal table, so a frame takes four bytes per
+// vertex. Frames are never expanded to floats when they are stored; they are decoded and
+// interpolated straight into a vertex buffer when the model is animated
+class Keyframes
+{
+	friend class BakedMesh;
+
+public:
+	Keyframes();
+	~Keyframes();
+
+	void				Clear();
+	// Adds a frame. vertices points to one x, y, z byte triple per vertex, each followed by a
+	// normal index, as in an MD2 file. The y and z axes are swapped so that y is up
+	void				AddFrame(const char* name, const float scale[3], const float translate[3], const uint8_t* vertices, size_t vertexCount);
+	size_t				GetFrameCount() const;
+	size_t				GetVertexCount() const;
+	const std::string&	GetFrameName(size_t frame) const;
+	// Returns the normal indices of every vertex in a frame
+	const uint8_t*		GetNormalIndices(size_t frame) const;
+	// Number of bytes allocated for the frames
+	size_t				GetMemorySize() const;
+	// Finds the frames of a named animation. Frames belong to an animation if their name is the
+	// animation name followed by a number, for example "run1" to "run6"
+	bool				FindAnimation(const std::string& name, size_t& first, size_t& last) const;
+	// Decides which way the normals from the MD2 normal table face, so that they point the same
+	// way as the given normals of the first frame, which were calculated from the polygons
+	void				OrientNormals(const VertexBuffer& vertices);
+	// Decodes the positions between two frames into the vertex buffer. amount is 0 for frame0
+	// and 1 for frame1. Normals are interpolated from the MD2 normal table, and are not
+	// normalised
+	void				Interpolate(size_t frame0, size_t frame1, float amount, VertexBuffer& vertices) const;
+
+private:
+	struct Frame
+	{
+		std::string	name;
+		float		scale[3];
+		float		translate[3];
+	};
+
+	size_t				_vertexCount{ 0 };
+	// Number of vertices in each coordinate stream, padded to a multiple of four
+	size_t				_paddedCount{ 0 };
+	std::vector<Frame>	_frames;
+	// For each frame, a stream of x coordinates followed by streams of y and z coordinates and
+	// a stream of normal indices. The streams are either held in _coordinates or mapped from a
+	// baked mesh file, and _coordinateData points to whichever it is
+	std::vector<uint8_t> _coordinates;
+	const uint8_t*		_coordinateData{ nullptr };
+	// 1 if the table normals point the same way as the calculated normals, otherwise -1
+	float				_normalSign{ 1.0f };
+
+	// Returns a stream of a frame. Streams 0 to 2 are the x, y and z coordinates and stream 3 is
+	// the normal indices
+	const uint8_t*		GetCoordinates(size_t frame, int stream) const;
+};
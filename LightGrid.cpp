@@ -0,0 +1,156 @@
+#include "LightGrid.h"
+#include <algorithm>
+#include <cmath>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+// Returns the index of the lowest set bit, which must exist
+static inline int LowestBit(uint32_t bits)
+{
+#ifdef _MSC_VER
+	unsigned long index;
+	_BitScanForward(&index, bits);
+	return static_cast<int>(index);
+#else
+	return __builtin_ctz(bits);
+#endif
+}
+
+LightGrid::LightGrid()
+{
+}
+
+LightGrid::~LightGrid()
+{
+}
+
+void LightGrid::Reset(const float minimum[3], const float maximum[3], size_t lightCount)
+{
+	// Picks a cell size that fits roughly MAXIMUM_CELLS cells in the box. Flat sides are treated
+	// as being a little deep so that the volume is never zero
+	float extent[3];
+	float longest = 0;
+	for (int axis = 0; axis < 3; axis++)
+	{
+		extent[axis] = maximum[axis] - minimum[axis];
+		longest = std::max(longest, extent[axis]);
+	}
+	longest = std::max(longest, 1e-3f);
+	float volume = 1;
+	for (int axis = 0; axis < 3; axis++)
+	{
+		volume *= std::max(extent[axis], longest / MAXIMUM_CELLS_PER_AXIS);
+	}
+	_cellSize = std::max(cbrtf(volume / MAXIMUM_CELLS), longest / MAXIMUM_CELLS_PER_AXIS);
+	_inverseCellSize = 1.0f / _cellSize;
+	size_t cells = 1;
+	for (int axis = 0; axis < 3; axis++)
+	{
+		_origin[axis] = minimum[axis];
+		int cellCount = static_cast<int>(ceilf(extent[axis] * _inverseCellSize));
+		_cellCount[axis] = cellCount < 1 ? 1 : cellCount > MAXIMUM_CELLS_PER_AXIS ? MAXIMUM_CELLS_PER_AXIS : cellCount;
+		cells *= _cellCount[axis];
+	}
+
+	_words = (lightCount + 31) / 32;
+	_masks.assign(cells * _words, 0);
+	_gatheredMask.resize(_words);
+	_gatheredLast[0] = -1;
+}
+
+void LightGrid::GetCellRange(int axis, float minimum, float maximum, int& first, int& last) const
+{
+	// Clamps in floating point first so that huge or infinite bounds do not overflow an int
+	float highest = float(_cellCount[axis] - 1);
+	float start = (minimum - _origin[axis]) * _inverseCellSize;
+	float end = (maximum - _origin[axis]) * _inverseCellSize;
+	first = int(std::min(std::max(start, 0.0f), highest));
+	last = int(std::min(std::max(end, 0.0f), highest));
+}
+
+void LightGrid::Add(int lightIndex, float x, float y, float z, float radius)
+{
+	float centre[3] = { x, y, z };
+	int first[3];
+	int last[3];
+	for (int axis = 0; axis < 3; axis++)
+	{
+		// Lights that cannot reach the grid at all are left out
+		float lowest = _origin[axis];
+		float highest = _origin[axis] + _cellSize * _cellCount[axis];
+		if (!(centre[axis] + radius >= lowest && centre[axis] - radius <= highest))
+		{
+			return;
+		}
+		GetCellRange(axis, centre[axis] - radius, centre[axis] + radius, first[axis], last[axis]);
+	}
+	float radiusSquared = radius * radius;
+	size_t word = lightIndex / 32;
+	uint32_t bit = 1u << (lightIndex % 32);
+	for (int cellZ = first[2]; cellZ <= last[2]; cellZ++)
+	{
+		for (int cellY = first[1]; cellY <= last[1]; cellY++)
+		{
+			for (int cellX = first[0]; cellX <= last[0]; cellX++)
+			{
+				// Distance from the light to the nearest point of the cell
+				int cell[3] = { cellX, cellY, cellZ };
+				float distanceSquared = 0;
+				for (int axis = 0; axis < 3; axis++)
+				{
+					float cellMinimum = _origin[axis] + cell[axis] * _cellSize;
+					float nearest = std::min(std::max(centre[axis], cellMinimum), cellMinimum + _cellSize);
+					distanceSquared += (centre[axis] - nearest) * (centre[axis] - nearest);
+				}
+				if (distanceSquared <= radiusSquared)
+				{
+					size_t index = (static_cast<size_t>(cellZ) * _cellCount[1] + cellY) * _cellCount[0] + cellX;
+					_masks[index * _words + word] |= bit;
+				}
+			}
+		}
+	}
+}
+
+const std::vector<int>& LightGrid::Gather(const float minimum[3], const float maximum[3])
+{
+	int first[3];
+	int last[3];
+	for (int axis = 0; axis < 3; axis++)
+	{
+		GetCellRange(axis, minimum[axis], maximum[axis], first[axis], last[axis]);
+	}
+	if (std::equal(first, first + 3, _gatheredFirst) && std::equal(last, last + 3, _gatheredLast))
+	{
+		return _gathered;
+	}
+	std::copy(first, first + 3, _gatheredFirst);
+	std::copy(last, last + 3, _gatheredLast);
+
+	std::fill(_gatheredMask.begin(), _gatheredMask.end(), 0);
+	for (int cellZ = first[2]; cellZ <= last[2]; cellZ++)
+	{
+		for (int cellY = first[1]; cellY <= last[1]; cellY++)
+		{
+			for (int cellX = first[0]; cellX <= last[0]; cellX++)
+			{
+				size_t index = (static_cast<size_t>(cellZ) * _cellCount[1] + cellY) * _cellCount[0] + cellX;
+				const uint32_t* mask = &_masks[index * _words];
+				for (size_t word = 0; word < _words; word++)
+				{
+					_gatheredMask[word] |= mask[word];
+				}
+			}
+		}
+	}
+	_gathered.clear();
+	for (size_t word = 0; word < _words; word++)
+	{
+		for (uint32_t bits = _gatheredMask[word]; bits != 0; bits &= bits - 1)
+		{
+			_gathered.push_back(static_cast<int>(word * 32) + LowestBit(bits));
+		}
+	}
+	return _gathered;
+}
@@ -0,0 +1,48 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Divides a box around the vertices being lit into a grid of cubic cells and keeps a set of the
+// lights whose sphere of influence overlaps each cell, so that a group of vertices only has to
+// consider the lights near it. The sets are bit masks with a bit for each light, so the lights
+// from several cells are combined with a few ORs and always come out in increasing order of
+// index, which means the lights are added up in the same order however they were gathered
+class LightGrid
+{
+public:
+	// Upper limit on the number of cells, which are spread over the axes in proportion to the
+	// size of the box
+	static const int MAXIMUM_CELLS = 512;
+	static const int MAXIMUM_CELLS_PER_AXIS = 64;
+
+	LightGrid();
+	~LightGrid();
+
+	// Covers the box between minimum and maximum with the grid and empties all of the cells,
+	// ready for lights with indices up to lightCount - 1 to be added
+	void				Reset(const float minimum[3], const float maximum[3], size_t lightCount);
+	// Adds a light to every cell that its sphere of influence overlaps
+	void				Add(int lightIndex, float x, float y, float z, float radius);
+	// Returns the lights, in increasing order of index, that may reach anything inside the box
+	// between minimum and maximum. The list is only valid until the next call
+	const std::vector<int>& Gather(const float minimum[3], const float maximum[3]);
+
+private:
+	// Returns the range of cells covering minimum to maximum on an axis, clamped to the grid
+	void				GetCellRange(int axis, float minimum, float maximum, int& first, int& last) const;
+
+	float				_origin[3]{ 0, 0, 0 };
+	float				_cellSize{ 1 };
+	float				_inverseCellSize{ 1 };
+	int					_cellCount[3]{ 1, 1, 1 };
+	// Number of 32-bit words in each cell's mask
+	size_t				_words{ 0 };
+	// Masks for each cell, x varying fastest
+	std::vector<uint32_t> _masks;
+	// Result of the last gather, which is reused while consecutive gathers cover the same cells
+	std::vector<uint32_t> _gatheredMask;
+	std::vector<int>	_gathered;
+	int					_gatheredFirst[3]{ 0, 0, 0 };
+	int					_gatheredLast[3]{ -1, -1, -1 };
+};
@@ -0,0 +1,100 @@
+#include "Lighting.h"
+#include <algorithm>
+#include <cmath>
+
+// Light that a point or spot light must add to a colour channel before it is worth adding
+const float LIGHT_CUTOFF = 0.5f;
+
+Lighting::Lighting()
+{
+}
+
+Lighting::~Lighting()
+{
+}
+
+// Converts a light's colour to floats
+static void GetColour(COLORREF colour, float rgb[3])
+{
+	rgb[0] = static_cast<float>(GetRValue(colour));
+	rgb[1] = static_cast<float>(GetGValue(colour));
+	rgb[2] = static_cast<float>(GetBValue(colour));
+}
+
+void Lighting::Prepare(const AmbientLight& ambientLight, const std::vector<DirectionalLight>& directionalLights, const std::vector<PointLight>& pointLights, const std::vector<SpotLight>& spotLights, const Vertex& cameraPosition, bool specular,
+	float kAmbient, float kDirectionalDiffuse, float kPointDiffuse, float kPointSpecular, float roughness)
+{
+	_specular = specular;
+	GetColour(ambientLight.GetColour(), _ambient);
+	for (float& channel : _ambient)
+	{
+		channel *= kAmbient;
+	}
+	// Without specular highlights directional lights use their own diffuse coefficient,
+	// otherwise every light uses the point light coefficients
+	_directionalDiffuse = specular ? kPointDiffuse : kDirectionalDiffuse;
+	_pointDiffuse = kPointDiffuse;
+	_pointSpecular = kPointSpecular;
+	_camera[0] = cameraPosition.GetX();
+	_camera[1] = cameraPosition.GetY();
+	_camera[2] = cameraPosition.GetZ();
+
+	_directionalLights.resize(directionalLights.size());
+	for (size_t i = 0; i < directionalLights.size(); i++)
+	{
+		Vertex direction = directionalLights[i].GetDirection().Normalise();
+		LightTerms& terms = _directionalLights[i];
+		terms.x = direction.GetX();
+		terms.y = direction.GetY();
+		terms.z = direction.GetZ();
+		GetColour(directionalLights[i].GetColour(), terms.colour);
+	}
+	// Spot lights are only used with specular lighting
+	_pointLights.resize(pointLights.size() + (specular ? spotLights.size() : 0));
+	_allPointLights.resize(_pointLights.size());
+	for (size_t i = 0; i < _pointLights.size(); i++)
+	{
+		const PointLight& light = i < pointLights.size() ? pointLights[i] : spotLights[i - pointLights.size()];
+		LightTerms& terms = _pointLights[i];
+		Vertex position = light.GetPosition();
+		terms.x = position.GetX();
+		terms.y = position.GetY();
+		terms.z = position.GetZ();
+		GetColour(light.GetColour(), terms.colour);
+		terms.a = light.GetA();
+		terms.b = light.GetB();
+		terms.c = light.GetC();
+		// The brightest the light can be is its brightest channel with the diffuse and
+		// specular terms both at their largest, scaled by 100 as in the attenuation
+		float brightest = std::max(terms.colour[0], std::max(terms.colour[1], terms.colour[2])) * 100.0f * (kPointDiffuse + (specular ? kPointSpecular : 0.0f));
+		terms.radius = brightest > 0 ? light.GetRadius(LIGHT_CUTOFF / brightest) : 0.0f;
+		terms.spot = i >= pointLights.size();
+		if (terms.spot)
+		{
+			const SpotLight& spotLight = spotLights[i - pointLights.size()];
+			terms.cosOuter = cosf(spotLight.GetOuterAngle());
+			terms.cosInner = cosf(spotLight.GetInnerAngle());
+		}
+		_allPointLights[i] = static_cast<int>(i);
+	}
+
+	// The specular table is only rebuilt when the roughness changes
+	if (roughness != _roughness)
+	{
+		_roughness = roughness;
+		for (int i = 0; i <= SPECULAR_TABLE_SIZE; i++)
+		{
+			_specularTable[i] = powf(float(i) / SPECULAR_TABLE_SIZE, roughness);
+		}
+	}
+}
+
+const std::vector<Lighting::LightTerms>& Lighting::GetPointLights() const
+{
+	return _pointLights;
+}
+
+const std::vector<int>& Lighting::GetAllPointLights() const
+{
+	return _allPointLights;
+}
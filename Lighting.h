@@ -0,0 +1,201 @@
+#pragma once
+#include "AmbientLight.h"
+#include "DirectionalLight.h"
+#include "PointLight.h"
+#include "SpotLight.h"
+#include "Vertex.h"
+#include "Simd.h"
+#include <vector>
+
+// Lights of a scene prepared for lighting points four at a time. The lights and reflection
+// coefficients are worked out once a frame, then the same calculation is used to light the
+// vertices for Gouraud shading and the pixels for per-pixel (Phong) shading.
+//
+// Specular highlights use the Blinn-Phong halfway vector, and n.h is raised to the roughness
+// with a lookup table rather than pow, since there is no SIMD pow
+class Lighting
+{
+public:
+	// Number of steps in the specular lookup table between n.h = 0 and n.h = 1
+	static const int SPECULAR_TABLE_SIZE = 1024;
+
+	// Everything about a light that lighting needs
+	struct LightTerms
+	{
+		// Normalised direction of a directional light, or the position of a point or spot light
+		float x;
+		float y;
+		float z;
+		float colour[3];
+		// Attenuation coefficients
+		float a;
+		float b;
+		float c;
+		// Distance beyond which the light is too faint to make a difference
+		float radius;
+		// Spot lights fade out between the cosines of their inner and outer angles
+		bool spot;
+		float cosOuter;
+		float cosInner;
+	};
+
+	Lighting();
+	~Lighting();
+
+	// Works out everything about the lights that does not depend on the point being lit. Spot
+	// lights and specular highlights are only used if specular is true. Point and spot lights
+	// are ignored beyond the distance where they would add less than half a colour level
+	void				Prepare(const AmbientLight& ambientLight, const std::vector<DirectionalLight>& directionalLights, const std::vector<PointLight>& pointLights, const std::vector<SpotLight>& spotLights, const Vertex& cameraPosition, bool specular,
+							float kAmbient, float kDirectionalDiffuse, float kPointDiffuse, float kPointSpecular, float roughness);
+	// Point and spot lights, in the order their indices refer to
+	const std::vector<LightTerms>& GetPointLights() const;
+	// Indices of every point and spot light, for lighting points without culling the lights
+	const std::vector<int>& GetAllPointLights() const;
+
+	// Lights four points with unit normals, using the point and spot lights whose indices are
+	// listed. The lit colours are returned as unclamped floats from 0 to 255
+	inline void			Shade(const Float4& x, const Float4& y, const Float4& z, const Float4& normalX, const Float4& normalY, const Float4& normalZ, const std::vector<int>& pointLights, Float4& red, Float4& green, Float4& blue) const;
+
+private:
+	static inline Float4 Dot(const Float4& x0, const Float4& y0, const Float4& z0, const Float4& x1, const Float4& y1, const Float4& z1);
+	static inline void	Normalise(Float4& x, Float4& y, Float4& z);
+	static inline Float4 SmoothStep(float edge0, float edge1, const Float4& x);
+	static inline void	AddLight(const float colour[3], const Float4& intensity, Float4& red, Float4& green, Float4& blue);
+	// Returns n.h raised to the roughness
+	inline Float4		Specular(const Float4& nDotH) const;
+
+	std::vector<LightTerms> _directionalLights;
+	std::vector<LightTerms> _pointLights;
+	std::vector<int>	_allPointLights;
+	bool				_specular{ false };
+	float				_ambient[3]{ 0, 0, 0 };
+	float				_directionalDiffuse{ 0 };
+	float				_pointDiffuse{ 0 };
+	float				_pointSpecular{ 0 };
+	float				_camera[3]{ 0, 0, 0 };
+	// n.h raised to the roughness at each step from 0 to 1, with an extra entry so that a value
+	// of exactly 1 can be looked up
+	float				_roughness{ -1 };
+	float				_specularTable[SPECULAR_TABLE_SIZE + 1];
+};
+
+inline Float4 Lighting::Dot(const Float4& x0, const Float4& y0, const Float4& z0, const Float4& x1, const Float4& y1, const Float4& z1)
+{
+	return x0 * x1 + y0 * y1 + z0 * z1;
+}
+
+inline void Lighting::Normalise(Float4& x, Float4& y, Float4& z)
+{
+	Float4 scale = Float4::ReciprocalSqrt(Dot(x, y, z, x, y, z));
+	x = x * scale;
+	y = y * scale;
+	z = z * scale;
+}
+
+// Hermite interpolation between 0 at edge0 and 1 at edge1
+inline Float4 Lighting::SmoothStep(float edge0, float edge1, const Float4& x)
+{
+	Float4 t = (x - Float4::Set1(edge0)) / Float4::Set1(edge1 - edge0);
+	t = Float4::Min(Float4::Max(t, Float4::Set1(0.0f)), Float4::Set1(1.0f));
+	return (Float4::Set1(3.0f) - Float4::Set1(2.0f) * t) * (t * t);
+}
+
+// Adds a light's colour scaled by intensity to the rgb totals
+inline void Lighting::AddLight(const float colour[3], const Float4& intensity, Float4& red, Float4& green, Float4& blue)
+{
+	red += Float4::Set1(colour[0]) * intensity;
+	green += Float4::Set1(colour[1]) * intensity;
+	blue += Float4::Set1(colour[2]) * intensity;
+}
+
+// A square root is quicker than the table, so is used for the default roughness of 0.5. The
+// table is looked up one lane at a time using the nearest step
+inline Float4 Lighting::Specular(const Float4& nDotH) const
+{
+	if (_roughness == 0.5f)
+	{
+		return Float4::Sqrt(nDotH);
+	}
+	uint32_t steps[4];
+	Float4 scaled = Float4::Min(nDotH, Float4::Set1(1.0f)) * Float4::Set1(float(SPECULAR_TABLE_SIZE)) + Float4::Set1(0.5f);
+	scaled.ToInt().Store(steps);
+	return Float4::Set(_specularTable[steps[0]], _specularTable[steps[1]], _specularTable[steps[2]], _specularTable[steps[3]]);
+}
+
+inline void Lighting::Shade(const Float4& x, const Float4& y, const Float4& z, const Float4& normalX, const Float4& normalY, const Float4& normalZ, const std::vector<int>& pointLights, Float4& red, Float4& green, Float4& blue) const
+{
+	Float4 zero = Float4::Set1(0.0f);
+	red = Float4::Set1(_ambient[0]);
+	green = Float4::Set1(_ambient[1]);
+	blue = Float4::Set1(_ambient[2]);
+
+	// Normalised view vector, which is only needed for specular highlights
+	Float4 viewX = x - Float4::Set1(_camera[0]);
+	Float4 viewY = y - Float4::Set1(_camera[1]);
+	Float4 viewZ = z - Float4::Set1(_camera[2]);
+	if (_specular)
+	{
+		Normalise(viewX, viewY, viewZ);
+	}
+
+	Float4 directionalDiffuse = Float4::Set1(_directionalDiffuse);
+	Float4 pointDiffuse = Float4::Set1(_pointDiffuse);
+	Float4 pointSpecular = Float4::Set1(_pointSpecular);
+	for (const LightTerms& light : _directionalLights)
+	{
+		Float4 lightX = Float4::Set1(light.x);
+		Float4 lightY = Float4::Set1(light.y);
+		Float4 lightZ = Float4::Set1(light.z);
+		Float4 lDotN = Float4::Max(Dot(lightX, lightY, lightZ, normalX, normalY, normalZ), zero);
+		Float4 intensity = directionalDiffuse * lDotN;
+		if (_specular)
+		{
+			// Halfway vector between the light and view vectors
+			Float4 halfwayX = lightX + viewX;
+			Float4 halfwayY = lightY + viewY;
+			Float4 halfwayZ = lightZ + viewZ;
+			Normalise(halfwayX, halfwayY, halfwayZ);
+			Float4 nDotH = Float4::Max(Dot(normalX, normalY, normalZ, halfwayX, halfwayY, halfwayZ), zero);
+			intensity += pointSpecular * Specular(nDotH);
+		}
+		AddLight(light.colour, intensity, red, green, blue);
+	}
+
+	for (int lightIndex : pointLights)
+	{
+		const LightTerms& light = _pointLights[lightIndex];
+		// Normalised vector from the light to the point
+		Float4 lightX = x - Float4::Set1(light.x);
+		Float4 lightY = y - Float4::Set1(light.y);
+		Float4 lightZ = z - Float4::Set1(light.z);
+		Float4 distanceSquared = Dot(lightX, lightY, lightZ, lightX, lightY, lightZ);
+		Float4 inverseD = Float4::ReciprocalSqrt(distanceSquared);
+		Float4 d = distanceSquared * inverseD;
+		lightX = lightX * inverseD;
+		lightY = lightY * inverseD;
+		lightZ = lightZ * inverseD;
+
+		Float4 lDotN = Float4::Max(Dot(lightX, lightY, lightZ, normalX, normalY, normalZ), zero);
+		Float4 intensity = pointDiffuse * lDotN;
+		if (_specular)
+		{
+			Float4 halfwayX = lightX + viewX;
+			Float4 halfwayY = lightY + viewY;
+			Float4 halfwayZ = lightZ + viewZ;
+			Normalise(halfwayX, halfwayY, halfwayZ);
+			Float4 nDotH = Float4::Max(Dot(normalX, normalY, normalZ, halfwayX, halfwayY, halfwayZ), zero);
+			intensity += pointSpecular * Specular(nDotH);
+		}
+		// Attenuation, scaled by 100 as in the flat lighting
+		intensity = intensity * (Float4::Set1(100.0f) / (Float4::Set1(light.a) + (Float4::Set1(light.b) + Float4::Set1(light.c) * d) * d));
+		if (light.spot)
+		{
+			// Fades the light between the inner and outer angle
+			intensity = intensity * SmoothStep(light.cosOuter, light.cosInner, lDotN);
+		}
+		// Drops the light beyond its radius whether or not the lights were culled, so that the
+		// result is the same either way
+		intensity = (intensity.AsInt() & Float4::Set1(light.radius).GreaterThan(d)).AsFloat();
+		AddLight(light.colour, intensity, red, green, blue);
+	}
+}
@@ -1,10 +1,11 @@
 #include "MD2Loader.h"
 
 // File reading
-#include <iostream>
-#include <fstream>
-
-using namespace std;
+#include "MappedFile.h"
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <functional>
 
 // BYTE added in case Windows.h is not included.
 typedef unsigned char BYTE; 
@@ -92,22 +93,35 @@ MD2Loader::~MD2Loader()
 {
 }
 
-bool LoadPCX(const char* textureFilename, Texture& texture, const Md2Header* md2Header)
+// Returns true if count elements of elementSize bytes starting at offset are inside the file
+static bool InFile(const MappedFile& file, long long offset, long long count, long long elementSize)
 {
-	std::ifstream   file;   
+	return offset >= 0 && count >= 0 && elementSize >= 0 && offset + count * elementSize <= static_cast<long long>(file.GetSize());
+}
+
+// Copies a structure out of the file. Structures in the file are not always aligned, so they
+// are not read in place
+template <typename T> static T ReadStruct(const BYTE* data)
+{
+	T value;
+	memcpy(&value, data, sizeof(T));
+	return value;
+}
 
+// Decodes the palette indices of a PCX file and its palette from a view of the whole file
+
+bool LoadPCX(const MappedFile& file, Texture& texture, const Md2Header* md2Header)
+{
 	BYTE * paletteIndices = texture.GetPaletteIndices();
 	COLORREF * palette = texture.GetPalette();
 
-	// Try to open file
-	file.open(textureFilename, std::ios::in | std::ios::binary);
-	if (file.fail())
+	// Read PCX header. The file must also have room for the palette at the end
+	if (file.GetSize() < sizeof(PcxHeader) + 769)
 	{
 		return false;
 	}
-	// Read PCX header
-	PcxHeader header;
-	file.read(reinterpret_cast<char*>(&header), sizeof(PcxHeader));
+	const BYTE* data = file.GetData();
+	PcxHeader header = ReadStruct<PcxHeader>(data);
 
 	// Verify that this is a valid PCX file
 
@@ -117,7 +131,6 @@ bool LoadPCX(const char* textureFilename, Texture& texture, const Md2Header* md2
 		(md2Header && (header.BytesPerLine != md2Header->skinWidth)))
 	{
 		// This is not valid supported PCX
-		file.close();
 		return false;
 	}
 
@@ -132,127 +145,142 @@ bool LoadPCX(const char* textureFilename, Texture& texture, const Md2Header* md2
 	if (md2Header && (size > (md2Header->skinHeight * md2Header->skinWidth)))
 	{
 		// Doesn't match expected MD2 skin size
-		file.close();
 		return false;
 	}
 
-	// Reading file data
+	// Decoding the image data, which lies between the header and the palette
 
-	BYTE processByte, colourByte;
-	int count = 0;
-	while (count < size)
+	const BYTE* input = data + sizeof(PcxHeader);
+	const BYTE* inputEnd = data + file.GetSize() - 769;
+	BYTE* output = paletteIndices;
+	BYTE* outputEnd = paletteIndices + (size > 0 ? size : 0);
+	while (output < outputEnd && input < inputEnd)
 	{
-		file.read(reinterpret_cast<char*>(&processByte), 1);
+		BYTE processByte = *input++;
 
 		// Run length encoding - test if byte is an RLE byte
 		if ((processByte & 192) == 192)
 		{
-			// Extract number of times repeated byte
-			processByte &= 63;
-			file.read(reinterpret_cast<char*>(&colourByte), 1);
-			for (int index = 0; index < processByte; ++index)
+			if (input == inputEnd)
 			{
-				// repeatedly write colour 
-				paletteIndices[count] = colourByte;
-				++count;
+				break;
 			}
+			// Extract number of times repeated byte, which is never allowed to
+			// run past the end of the texture
+			size_t run = processByte & 63;
+			run = std::min(run, static_cast<size_t>(outputEnd - output));
+			memset(output, *input++, run);
+			output += run;
 		}
 		else
 		{
 			// Byte is the colour
-			paletteIndices[count] = processByte;
-			++count;
+			*output++ = processByte;
 		}
 	}
+	if (output < outputEnd)
+	{
+		// The image data was cut short
+		return false;
+	}
 
-	bool returnValue = false;
-
-	// read palette data...
-	file.seekg(-769, std::ios::end);	// This offset from end of file
-	file.read(reinterpret_cast<char*>(&processByte), 1);
-	if (processByte == 12)
+	// read palette data, which is 768 bytes following a marker byte of 12 at the end of the file
+	const BYTE* rawPalette = inputEnd + 1;
+	if (*inputEnd != 12)
 	{
-		BYTE rawPalette[768];
-		file.read(reinterpret_cast<char*>(&rawPalette), 768);
+		return false;
+	}
 
-		// Build palette
-		for (int palIndex = 0; palIndex < 256; ++palIndex)
-		{
-			palette[palIndex] = RGB(rawPalette[palIndex * 3],
-									rawPalette[(palIndex * 3) + 1],
-									rawPalette[(palIndex * 3) + 2]);
-		}
-		returnValue = true;
+	// Build palette
+	for (int palIndex = 0; palIndex < 256; ++palIndex)
+	{
+		palette[palIndex] = RGB(rawPalette[palIndex * 3],
+								rawPalette[(palIndex * 3) + 1],
+								rawPalette[(palIndex * 3) + 2]);
 	}
+	return true;
+}
+
+// Load a PCX texture made for a skin of the given size
 
-	file.close();
-	return returnValue;
+bool MD2Loader::LoadTexture(const char* textureFilename, Texture& texture, int skinWidth, int skinHeight)
+{
+	Md2Header header = {};
+	header.skinWidth = skinWidth;
+	header.skinHeight = skinHeight;
+	texture.SetTextureSize(skinWidth, skinHeight);
+	MappedFile textureFile;
+	return textureFile.Open(textureFilename) && LoadPCX(textureFile, texture, &header);
 }
 
-// Load model from file.
+// Load model from file. Both the model and its texture are mapped into memory and read in
+// place, so no buffers are allocated while loading
 
-bool MD2Loader::LoadModel(const char* md2Filename, const char * textureFilename, Model& model, AddPolygon addPolygon, AddVertex addVertex, AddTextureUV addTextureUV)
+bool MD2Loader::LoadModel(const char* md2Filename, const char * textureFilename, ModelAsset& model, AddPolygon addPolygon, AddVertex addVertex, AddTextureUV addTextureUV, AddFrame addFrame)
 {
-	ifstream   file;           
-	Md2Header header;
-	bool bHasTexture = false;
+	MappedFile file;
 
 	// Try to open MD2 file
-	file.open(md2Filename, ios::in | ios::binary);
-	if (file.fail())
+	if (!file.Open(md2Filename) || file.GetSize() < sizeof(Md2Header))
 	{
 		return false;
 	}
 	// Read file header
-	file.read(reinterpret_cast<char*>(&header), sizeof(Md2Header));
-		
+	const BYTE* data = file.GetData();
+	Md2Header header = ReadStruct<Md2Header>(data);
+
 	// Verify that this is a MD2 file (check for the magic number and version number)
-	if ((header.indent != MD2_IDENT) && (header.version != MD2_VERSION))
+	if ((header.indent != MD2_IDENT) || (header.version != MD2_VERSION))
 	{
 		// This is not a MD2 model
-		file.close();
 		return false;
 	}
 
-	// Allocate the memory we need
-	Md2Triangle* triangles = new Md2Triangle[header.numTriangles];
-	// We are only interested in the first frame 
-	BYTE* frameBuffer = new BYTE[header.frameSize];
-	Md2Frame* frame = reinterpret_cast<Md2Frame*>(frameBuffer);
-	Md2TextureCoord * textureCoords = new Md2TextureCoord[header.numTexCoords];
-
-	// Read polygon data...
-	file.seekg(header.offsetTriangles, ios::beg);
-	file.read(reinterpret_cast<char*>(triangles), sizeof(Md2Triangle) * header.numTriangles);	
-		
-	// Read frame data...
-	file.seekg(header.offsetFrames, ios::beg);
-	file.read(reinterpret_cast<char*>(frame), header.frameSize);	
-
-	// Read texture coordinate data
-	file.seekg(header.offsetTexCoords, std::ios::beg);
-	file.read(reinterpret_cast<char*>(textureCoords), sizeof(Md2TextureCoord) * header.numTexCoords);
-		
-	// Close the file 
-	file.close();
-
-	// Attempt to load any texture
-	if (textureFilename)
+	// Check that all of the data is inside the file
+	if (!InFile(file, header.offsetTriangles, header.numTriangles, sizeof(Md2Triangle)) ||
+		!InFile(file, header.offsetTexCoords, header.numTexCoords, sizeof(Md2TextureCoord)) ||
+		!InFile(file, header.offsetFrames, header.numFrames, header.frameSize) ||
+		header.numFrames < 1 ||
+		header.frameSize < static_cast<int>(offsetof(Md2Frame, verts) + sizeof(Md2Vertex) * header.numVertices))
 	{
-		model.GetTexture().SetTextureSize(header.skinWidth, header.skinHeight);
-		bHasTexture = LoadPCX(textureFilename, model.GetTexture(), &header);
+		return false;
+	}
+
+	// Load any texture
+	model.SetSkinSize(header.skinWidth, header.skinHeight);
+	if (textureFilename && !LoadTexture(textureFilename, model.GetTexture(), header.skinWidth, header.skinHeight))
+	{
+		return false;
 	}
 
 	// Polygon array initialization
+	const BYTE* triangles = data + header.offsetTriangles;
 	for ( int i = 0; i < header.numTriangles; ++i )
 	{
+		Md2Triangle triangle = ReadStruct<Md2Triangle>(triangles + sizeof(Md2Triangle) * i);
+		for (int j = 0; j < 3; j++)
+		{
+			// Models without texture coordinates never use their texture coordinate indices
+			if (triangle.vertexIndex[j] < 0 || triangle.vertexIndex[j] >= header.numVertices ||
+				(header.numTexCoords > 0 && (triangle.uvIndex[j] < 0 || triangle.uvIndex[j] >= header.numTexCoords)))
+			{
+				return false;
+			}
+		}
+
 		// Call supplied member function to add a new polygon to the list
 		std::invoke(addPolygon, model,
-				    triangles[i].vertexIndex[0], triangles[i].vertexIndex[1], triangles[i].vertexIndex[2],
-				    triangles[i].uvIndex[0], triangles[i].uvIndex[1], triangles[i].uvIndex[2]);
+				    triangle.vertexIndex[0], triangle.vertexIndex[1], triangle.vertexIndex[2],
+				    triangle.uvIndex[0], triangle.uvIndex[1], triangle.uvIndex[2]);
 	}
 
-	// Vertex array initialization
+	// Vertex array initialization, using the first frame
+	const BYTE* frames = data + header.offsetFrames;
+	float scale[3];
+	float translate[3];
+	memcpy(scale, frames + offsetof(Md2Frame, scale), sizeof(scale));
+	memcpy(translate, frames + offsetof(Md2Frame, translate), sizeof(translate));
+	const Md2Vertex* verts = reinterpret_cast<const Md2Vertex*>(frames + offsetof(Md2Frame, verts));
 	for( int i = 0; i < header.numVertices; ++i )
 	{
 		// The following are the expressions needed to access each of the co-ordinates.
@@ -263,28 +291,30 @@ bool MD2Loader::LoadModel(const char* md2Filename, const char * textureFilename,
 		//
 		// NOTE: We have to swap Y and Z over because Z is up in MD2 and we have Y as up-axis
 		std::invoke(addVertex, model, 
-					static_cast<float>((frame->verts[i].v[0] * frame->scale[0]) + frame->translate[0]),
-					static_cast<float>((frame->verts[i].v[2] * frame->scale[2]) + frame->translate[2]),
-					static_cast<float>((frame->verts[i].v[1] * frame->scale[1]) + frame->translate[1]));
+					static_cast<float>((verts[i].v[0] * scale[0]) + translate[0]),
+					static_cast<float>((verts[i].v[2] * scale[2]) + translate[2]),
+					static_cast<float>((verts[i].v[1] * scale[1]) + translate[1]));
 	}
-	// Texture coordinates initialisation
-	if (bHasTexture)
+
+	// Animation frames initialisation. The frames are passed on still quantised
+	for (int i = 0; i < header.numFrames; i++)
 	{
-		for (int i = 0; i < header.numTexCoords; i++)
-		{
-			std::invoke(addTextureUV, model, textureCoords[i].textureCoord[0], textureCoords[i].textureCoord[1]);
-		}
+		const BYTE* frame = frames + static_cast<size_t>(header.frameSize) * i;
+		char name[sizeof(Md2Frame::name) + 1] = {};
+		memcpy(name, frame + offsetof(Md2Frame, name), sizeof(Md2Frame::name));
+		memcpy(scale, frame + offsetof(Md2Frame, scale), sizeof(scale));
+		memcpy(translate, frame + offsetof(Md2Frame, translate), sizeof(translate));
+		std::invoke(addFrame, model, name, scale, translate, frame + offsetof(Md2Frame, verts), header.numVertices);
 	}
-	// Free dynamically allocated memory
-	delete [] triangles; // NOTE: this is 'array' delete. Must be sure to use this
-	triangles = 0;
-
-	delete [] frameBuffer;
-	frameBuffer = 0;
-	frame = 0;
 
-	delete[] textureCoords;
-	textureCoords = 0;
+	// Texture coordinates initialisation. These are added even when there is no texture, so that
+	// they can be baked along with the rest of the mesh
+	const BYTE* textureCoords = data + header.offsetTexCoords;
+	for (int i = 0; i < header.numTexCoords; i++)
+	{
+		Md2TextureCoord textureCoord = ReadStruct<Md2TextureCoord>(textureCoords + sizeof(Md2TextureCoord) * i);
+		std::invoke(addTextureUV, model, textureCoord.textureCoord[0], textureCoord.textureCoord[1]);
+	}
 
 	return true;
 }
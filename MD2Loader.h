@@ -1,17 +1,20 @@
 #pragma once
-#include "Model.h"
+#include "ModelAsset.h"
 
 // Declare typedefs used by the MD2Loader to call the methods to add a vertex, 
-// add a polygon and add a texture UV to the lists
+// add a polygon, add a texture UV and add an animation frame to the lists
 
-typedef void (Model::*AddVertex)(float x, float y, float z);
-typedef void (Model::*AddPolygon)(int i0, int i1, int i2, int uvIndex0, int uvIndex1, int uvIndex2);
-typedef void (Model::*AddTextureUV)(float u, float v);
+typedef void (ModelAsset::*AddVertex)(float x, float y, float z);
+typedef void (ModelAsset::*AddPolygon)(int i0, int i1, int i2, int uvIndex0, int uvIndex1, int uvIndex2);
+typedef void (ModelAsset::*AddTextureUV)(float u, float v);
+typedef void (ModelAsset::*AddFrame)(const char* name, const float scale[3], const float translate[3], const BYTE* vertices, int vertexCount);
 
 class MD2Loader
 {
 	public:
 		MD2Loader();
 		~MD2Loader();
-		static bool LoadModel(const char* md2Filename, const char * textureFilename, Model& model, AddPolygon addPolygon, AddVertex addVertex, AddTextureUV addTextureUV);
+		static bool LoadModel(const char* md2Filename, const char * textureFilename, ModelAsset& model, AddPolygon addPolygon, AddVertex addVertex, AddTextureUV addTextureUV, AddFrame addFrame);
+		// Loads a PCX texture for a model whose skin is the given size
+		static bool LoadTexture(const char* textureFilename, Texture& texture, int skinWidth, int skinHeight);
 };
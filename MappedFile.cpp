@@ -0,0 +1,124 @@
+#include "MappedFile.h"
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile()
+{
+}
+
+MappedFile::~MappedFile()
+{
+	Close();
+}
+
+#ifdef _WIN32
+
+bool MappedFile::Open(const char* filename)
+{
+	Close();
+	_file = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (_file == INVALID_HANDLE_VALUE)
+	{
+		return false;
+	}
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(_file, &size) || size.QuadPart == 0)
+	{
+		Close();
+		return false;
+	}
+	_mapping = CreateFileMappingA(_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (_mapping == nullptr)
+	{
+		Close();
+		return false;
+	}
+	_data = static_cast<const uint8_t*>(MapViewOfFile(_mapping, FILE_MAP_READ, 0, 0, 0));
+	if (_data == nullptr)
+	{
+		Close();
+		return false;
+	}
+	_size = static_cast<size_t>(size.QuadPart);
+	return true;
+}
+
+void MappedFile::Close()
+{
+	if (_data != nullptr)
+	{
+		UnmapViewOfFile(_data);
+		_data = nullptr;
+	}
+	if (_mapping != nullptr)
+	{
+		CloseHandle(_mapping);
+		_mapping = nullptr;
+	}
+	if (_file != INVALID_HANDLE_VALUE)
+	{
+		CloseHandle(_file);
+		_file = INVALID_HANDLE_VALUE;
+	}
+	_size = 0;
+}
+
+#else
+
+// The descriptor can be closed as soon as the file is mapped
+bool MappedFile::Open(const char* filename)
+{
+	Close();
+	int descriptor = open(filename, O_RDONLY);
+	if (descriptor < 0)
+	{
+		return false;
+	}
+	struct stat status;
+	if (fstat(descriptor, &status) != 0 || status.st_size <= 0)
+	{
+		close(descriptor);
+		return false;
+	}
+	void* data = mmap(nullptr, static_cast<size_t>(status.st_size), PROT_READ, MAP_PRIVATE, descriptor, 0);
+	close(descriptor);
+	if (data == MAP_FAILED)
+	{
+		return false;
+	}
+	_data = static_cast<const uint8_t*>(data);
+	_size = static_cast<size_t>(status.st_size);
+	return true;
+}
+
+void MappedFile::Close()
+{
+	if (_data != nullptr)
+	{
+		munmap(const_cast<uint8_t*>(_data), _size);
+		_data = nullptr;
+	}
+	_size = 0;
+}
+
+#endif
+
+bool MappedFile::IsOpen() const
+{
+	return _data != nullptr;
+}
+
+const uint8_t* MappedFile::GetData() const
+{
+	return _data;
+}
+
+size_t MappedFile::GetSize() const
+{
+	return _size;
+}
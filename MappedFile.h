@@ -0,0 +1,31 @@
+#pragma once
+#include "Platform.h"
+#include <cstddef>
+#include <cstdint>
+
+// Read only view of a whole file, mapped into memory by the operating system. Pages are only
+// read from disk as they are touched, and nothing is copied into buffers of our own
+class MappedFile
+{
+public:
+	MappedFile();
+	~MappedFile();
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	// Maps the file, closing any file that is already open. Returns false if the file could
+	// not be opened or is empty
+	bool			Open(const char* filename);
+	void			Close();
+	bool			IsOpen() const;
+	const uint8_t*	GetData() const;
+	size_t			GetSize() const;
+
+private:
+#ifdef _WIN32
+	HANDLE			_file{ INVALID_HANDLE_VALUE };
+	HANDLE			_mapping{ nullptr };
+#endif
+	const uint8_t*	_data{ nullptr };
+	size_t			_size{ 0 };
+};
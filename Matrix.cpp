@@ -1,4 +1,5 @@
 #include "Matrix.h"
+#include "Simd.h"
 #include <cmath>
 
 Matrix::Matrix() : _m{ 0 }
@@ -78,21 +79,25 @@ bool Matrix::operator==(const Matrix& other) const
 	return true;
 }
 
-// Multiply two matrices together
+// Multiply two matrices together. Each row of the result is a sum of the rows of the
+// other matrix, so four elements are calculated at once
 const Matrix Matrix::operator*(const Matrix& other) const
 {
+	Float4 otherRows[ROWS];
+	for (int k = 0; k < ROWS; k++)
+	{
+		otherRows[k] = Float4::Load(other._m[k]);
+	}
+
 	Matrix result;
 	for (int i = 0; i < ROWS; i++)
 	{
-		for (int j = 0; j < COLS; j++)
+		Float4 row = Float4::Set1(_m[i][0]) * otherRows[0];
+		for (int k = 1; k < ROWS; k++)
 		{
-			float resultValue = 0;
-			for (int k = 0; k < ROWS; k++)
-			{
-				resultValue += _m[i][k] * other.GetM(k, j);
-			}
-			result.SetM(i, j, resultValue);
+			row += Float4::Set1(_m[i][k]) * otherRows[k];
 		}
+		row.Store(result._m[i]);
 	}
 	return result;
 }
@@ -100,15 +105,107 @@ const Matrix Matrix::operator*(const Matrix& other) const
 // Multiply a matrix by a vector
 const Vertex Matrix::operator*(const Vertex& p) const
 {
-	Vertex newVertex(p);
+	float point[4] = { p.GetX(), p.GetY(), p.GetZ(), p.GetW() };
+	TransformPoints(point, point, 1);
 
-	newVertex.SetX(_m[0][0] * p.GetX() + _m[0][1] * p.GetY() + _m[0][2] * p.GetZ() + _m[0][3] * p.GetW());
-	newVertex.SetY(_m[1][0] * p.GetX() + _m[1][1] * p.GetY() + _m[1][2] * p.GetZ() + _m[1][3] * p.GetW());
-	newVertex.SetZ(_m[2][0] * p.GetX() + _m[2][1] * p.GetY() + _m[2][2] * p.GetZ() + _m[2][3] * p.GetW());
-	newVertex.SetW(_m[3][0] * p.GetX() + _m[3][1] * p.GetY() + _m[3][2] * p.GetZ() + _m[3][3] * p.GetW());
+	Vertex newVertex(p);
+	newVertex.SetX(point[0]);
+	newVertex.SetY(point[1]);
+	newVertex.SetZ(point[2]);
+	newVertex.SetW(point[3]);
 	return newVertex;
 }
 
+// Transforms points stored one after another as x, y, z, w. The result for each point is a
+// sum of the columns of the matrix, scaled by the coordinates of the point
+void Matrix::TransformPoints(const float* in, float* out, size_t n) const
+{
+	Float4 columns[COLS];
+	for (int j = 0; j < COLS; j++)
+	{
+		columns[j] = Float4::Set(_m[0][j], _m[1][j], _m[2][j], _m[3][j]);
+	}
+
+	for (size_t i = 0; i < n; i++, in += 4, out += 4)
+	{
+		Float4 result = columns[0] * Float4::Set1(in[0]) + columns[1] * Float4::Set1(in[1]) + columns[2] * Float4::Set1(in[2]) + columns[3] * Float4::Set1(in[3]);
+		result.Store(out);
+	}
+}
+
+// Transforms points stored as separate x, y, z and w streams, four points at a time
+void Matrix::TransformPoints(const float* inX, const float* inY, const float* inZ, const float* inW, float* outX, float* outY, float* outZ, float* outW, size_t n) const
+{
+	// Every element of the matrix is used for four points at a time
+	Float4 m[ROWS][COLS];
+	for (int row = 0; row < ROWS; row++)
+	{
+		for (int column = 0; column < COLS; column++)
+		{
+			m[row][column] = Float4::Set1(_m[row][column]);
+		}
+	}
+
+	size_t i = 0;
+	for (; i + 4 <= n; i += 4)
+	{
+		Float4 x = Float4::Load(inX + i);
+		Float4 y = Float4::Load(inY + i);
+		Float4 z = Float4::Load(inZ + i);
+		Float4 w = Float4::Load(inW + i);
+		(m[0][0] * x + m[0][1] * y + m[0][2] * z + m[0][3] * w).Store(outX + i);
+		(m[1][0] * x + m[1][1] * y + m[1][2] * z + m[1][3] * w).Store(outY + i);
+		(m[2][0] * x + m[2][1] * y + m[2][2] * z + m[2][3] * w).Store(outZ + i);
+		(m[3][0] * x + m[3][1] * y + m[3][2] * z + m[3][3] * w).Store(outW + i);
+	}
+
+	// Any points left over are transformed one at a time
+	for (; i < n; i++)
+	{
+		float x = inX[i];
+		float y = inY[i];
+		float z = inZ[i];
+		float w = inW[i];
+		outX[i] = _m[0][0] * x + _m[0][1] * y + _m[0][2] * z + _m[0][3] * w;
+		outY[i] = _m[1][0] * x + _m[1][1] * y + _m[1][2] * z + _m[1][3] * w;
+		outZ[i] = _m[2][0] * x + _m[2][1] * y + _m[2][2] * z + _m[2][3] * w;
+		outW[i] = _m[3][0] * x + _m[3][1] * y + _m[3][2] * z + _m[3][3] * w;
+	}
+}
+
+// The inverse of a 3 x 3 matrix is the transpose of its cofactors divided by its determinant,
+// so the inverse transpose is just the cofactors divided by the determinant
+Matrix Matrix::GetNormalMatrix() const
+{
+	float cofactors[3][3];
+	for (int row = 0; row < 3; row++)
+	{
+		int row1 = (row + 1) % 3;
+		int row2 = (row + 2) % 3;
+		for (int column = 0; column < 3; column++)
+		{
+			int column1 = (column + 1) % 3;
+			int column2 = (column + 2) % 3;
+			cofactors[row][column] = _m[row1][column1] * _m[row2][column2] - _m[row1][column2] * _m[row2][column1];
+		}
+	}
+	float determinant = _m[0][0] * cofactors[0][0] + _m[0][1] * cofactors[0][1] + _m[0][2] * cofactors[0][2];
+	if (determinant == 0)
+	{
+		return IdentityMatrix();
+	}
+
+	Matrix result = IdentityMatrix();
+	for (int row = 0; row < 3; row++)
+	{
+		for (int column = 0; column < 3; column++)
+		{
+			result._m[row][column] = cofactors[row][column] / determinant;
+		}
+	}
+	return result;
+}
+
 Matrix Matrix::IdentityMatrix()
 {
 	return Matrix{ 1, 0, 0, 0,
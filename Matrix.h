@@ -7,6 +7,7 @@ const int ROWS = 4;
 const int COLS = 4;
 
 #include <initializer_list>
+#include <cstddef>
 
 class Matrix
 {
@@ -42,6 +43,19 @@ public:
 	// Multiply a matrix by a vertex, returning a vertex
 	const Vertex operator*(const Vertex& other) const;
 
+	// Multiply n points by the matrix. The points are stored one after another as x, y, z, w.
+	// in and out may point to the same memory
+	void TransformPoints(const float* in, float* out, size_t n) const;
+
+	// Multiply n points stored as separate x, y, z and w streams by the matrix. The input
+	// and output streams may be the same
+	void TransformPoints(const float* inX, const float* inY, const float* inZ, const float* inW, float* outX, float* outY, float* outZ, float* outW, size_t n) const;
+
+	// Returns the matrix that transforms normals in the same way that this matrix transforms
+	// points. This is the inverse transpose of the upper 3 x 3 part, with no translation. The
+	// identity is returned if the matrix cannot be inverted
+	Matrix GetNormalMatrix() const;
+
 	static Matrix IdentityMatrix();
 
 private:
@@ -0,0 +1,265 @@
+#include "Microbenchmarks.h"
+#include "Matrix.h"
+#include "Vertex.h"
+#include "VertexBuffer.h"
+#include "Keyframes.h"
+#include "Model.h"
+#include "Bitmap.h"
+#include "Lighting.h"
+#include "TriangleRasteriser.h"
+#include <chrono>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+// Minimum time each kernel is repeated for
+const double MINIMUM_BENCHMARK_SECONDS = 0.25;
+
+// Repeatedly calls kernel, which processes itemCount items each call, and prints the
+// average time taken per item
+static void TimeKernel(const char* name, size_t itemCount, const std::function<void()>& kernel)
+{
+	// Warms up the caches before timing
+	kernel();
+
+	size_t calls = 0;
+	double seconds = 0;
+	auto startTime = std::chrono::steady_clock::now();
+	while (seconds < MINIMUM_BENCHMARK_SECONDS)
+	{
+		kernel();
+		calls++;
+		seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+	}
+
+	double nanoseconds = seconds * 1e9 / (double(calls) * double(itemCount));
+	std::cout << std::left << std::setw(40) << name << std::right << std::setw(10) << itemCount
+			  << std::fixed << std::setprecision(3) << std::setw(12) << nanoseconds << " ns per item" << std::endl;
+}
+
+bool Microbenchmarks::Run(const std::string& name)
+{
+	if (name == "transform")
+	{
+		RunTransform();
+		return true;
+	}
+	if (name == "animation")
+	{
+		RunAnimation();
+		return true;
+	}
+	if (name == "lighting")
+	{
+		RunLighting();
+		return true;
+	}
+	if (name == "shading")
+	{
+		RunShading();
+		return true;
+	}
+	return false;
+}
+
+// Compares the cost per vertex of the ways vertices can be transformed. The sizes cover a
+// typical MD2 model and a set of vertices too large for the caches
+void Microbenchmarks::RunTransform()
+{
+	Matrix transform({ 0.8f, -0.2f, 0.1f, 4.0f,
+					   0.3f,  0.9f, 0.2f, -2.0f,
+					   0.1f, -0.3f, 0.7f, 50.0f,
+					   0.0f,  0.0f, 1.0f, 0.0f });
+
+	for (size_t count : { size_t(2048), size_t(1 << 20) })
+	{
+		// The same points in each layout
+		std::vector<Vertex> vertices;
+		std::vector<float> points;
+		VertexBuffer source;
+		VertexBuffer destination;
+		for (size_t i = 0; i < count; i++)
+		{
+			float x = float(i % 97) - 48.0f;
+			float y = float(i % 89) - 44.0f;
+			float z = float(i % 83) - 41.0f;
+			vertices.push_back(Vertex(x, y, z, 1));
+			points.insert(points.end(), { x, y, z, 1.0f });
+			source.Add(x, y, z);
+		}
+		std::vector<Vertex> transformedVertices(count);
+		std::vector<float> transformedPoints(points.size());
+
+		TimeKernel("Matrix * Vertex", count, [&]()
+		{
+			for (size_t i = 0; i < count; i++)
+			{
+				transformedVertices[i] = transform * vertices[i];
+			}
+		});
+		TimeKernel("Matrix::TransformPoints (x, y, z, w)", count, [&]()
+		{
+			transform.TransformPoints(points.data(), transformedPoints.data(), count);
+		});
+		TimeKernel("VertexBuffer::Transform (streams)", count, [&]()
+		{
+			destination.Transform(transform, source);
+		});
+		TimeKernel("VertexBuffer::Transform + Project", count, [&]()
+		{
+			destination.Transform(transform, source);
+			destination.Project(transform);
+		});
+	}
+}
+
+// Cost per vertex of decoding an animated model between two frames
+void Microbenchmarks::RunAnimation()
+{
+	const float scale[3] = { 0.1f, 0.2f, 0.3f };
+	const float translate[3] = { -12.0f, -25.0f, -38.0f };
+
+	for (size_t count : { size_t(2048), size_t(1 << 20) })
+	{
+		// Two frames of MD2 vertices, each x, y, z and a normal index
+		std::vector<uint8_t> frame0(count * 4);
+		std::vector<uint8_t> frame1(count * 4);
+		for (size_t i = 0; i < frame0.size(); i++)
+		{
+			frame0[i] = uint8_t(i * 7);
+			frame1[i] = uint8_t(i * 13);
+		}
+		Keyframes keyframes;
+		keyframes.AddFrame("run1", scale, translate, frame0.data(), count);
+		keyframes.AddFrame("run2", scale, translate, frame1.data(), count);
+		VertexBuffer vertices;
+
+		TimeKernel("Keyframes::Interpolate", count, [&]()
+		{
+			keyframes.Interpolate(0, 1, 0.25f, vertices);
+		});
+	}
+}
+
+// Cost per vertex of lighting a model with the lights used by the demo
+void Microbenchmarks::RunLighting()
+{
+	AmbientLight ambientLight(RGB(0, 255, 255));
+	std::vector<DirectionalLight> directionalLights = { DirectionalLight(RGB(0, 255, 255), Vertex(1, 0, 0)) };
+	std::vector<PointLight> pointLights = { PointLight(RGB(255, 255, 255), Vertex(50, 0, -50), 0, 1, 0) };
+	std::vector<SpotLight> spotLights = { SpotLight(RGB(0, 255, 0), Vertex(0, 0, -50), 0, 1, 0, 0.26f, 0.52f) };
+	Camera camera(0, 0, 0, Vertex(0, 0, -50));
+
+	for (size_t count : { size_t(2048), size_t(1 << 20) })
+	{
+		// A wavy strip of triangles, so that the vertices have a variety of normals
+		std::shared_ptr<ModelAsset> asset = std::make_shared<ModelAsset>();
+		for (size_t i = 0; i < count; i++)
+		{
+			asset->AddVertex(float(i % 2) * 10.0f, float(i / 2) * 0.1f, sinf(float(i) * 0.01f) * 20.0f);
+			if (i >= 2)
+			{
+				asset->AddPolygon(int(i) - 2, int(i) - 1, int(i), 0, 0, 0);
+			}
+		}
+		asset->CalculateNormals();
+		Model model;
+		model.SetAsset(asset);
+		model.ApplyTransformToLocalVertices(Matrix::IdentityMatrix());
+		model.CollectVisiblePolygons();
+		model.TransformNormals(Matrix::IdentityMatrix());
+
+		TimeKernel("Model::CalculateSmoothLighting", count, [&]()
+		{
+			model.CalculateSmoothLighting(ambientLight, directionalLights, pointLights, spotLights, camera, false);
+		});
+		TimeKernel("Model::CalculateSmoothLighting (specular)", count, [&]()
+		{
+			model.CalculateSmoothLighting(ambientLight, directionalLights, pointLights, spotLights, camera, true);
+		});
+
+		// Many small lights spread along the strip, each of which only reaches a few of the vertices
+		std::vector<PointLight> manyLights;
+		float length = float(count / 2) * 0.1f;
+		for (int i = 0; i < 256; i++)
+		{
+			manyLights.push_back(PointLight(RGB(255, 128 + i % 128, 255 - i % 128), Vertex(5, length * (float(i) + 0.5f) / 256, -10), 1, 0, 50));
+		}
+		TimeKernel("Model::CalculateSmoothLighting (256 point lights)", count, [&]()
+		{
+			model.CalculateSmoothLighting(ambientLight, directionalLights, manyLights, spotLights, camera, false);
+		});
+	}
+}
+
+// Cost per pixel of drawing triangles with Gouraud shading, which only interpolates the colours
+// lit at the vertices, against lighting every pixel. Per-pixel lighting is timed with the
+// default roughness, which uses a square root, and with a roughness that needs the specular table
+void Microbenchmarks::RunShading()
+{
+	const int size = 512;
+	const int cells = 32;
+	Bitmap bitmap;
+	bitmap.Create(size, size);
+	Tile tile = { 0, 0, size - 1, size - 1 };
+
+	// A wavy surface covering the bitmap, lit by the lights of the specular stage of the demo
+	std::vector<RasterVertex> grid;
+	for (int row = 0; row <= cells; row++)
+	{
+		for (int column = 0; column <= cells; column++)
+		{
+			RasterVertex vertex;
+			vertex.x = float(column * size / cells);
+			vertex.y = float(row * size / cells);
+			vertex.zRecip = 1.0f / 50.0f;
+			vertex.colour = RGB(column * 8 % 256, row * 8 % 256, 128);
+			vertex.u = 0;
+			vertex.v = 0;
+			vertex.worldX = float(column - cells / 2);
+			vertex.worldY = float(cells / 2 - row);
+			vertex.worldZ = sinf(float(column) * 0.3f) * 2.0f;
+			Vertex normal = Vertex(-cosf(float(column) * 0.3f) * 0.6f, 0, -1).Normalise();
+			vertex.normalX = normal.GetX();
+			vertex.normalY = normal.GetY();
+			vertex.normalZ = normal.GetZ();
+			grid.push_back(vertex);
+		}
+	}
+	AmbientLight ambientLight(RGB(0, 255, 255));
+	std::vector<DirectionalLight> directionalLights = { DirectionalLight(RGB(0, 255, 255), Vertex(1, 0, 0)) };
+	std::vector<PointLight> pointLights = { PointLight(RGB(255, 255, 255), Vertex(50, 0, -50), 0, 1, 0) };
+	std::vector<SpotLight> spotLights;
+	Lighting lighting;
+
+	auto drawGrid = [&](ShadeMode mode)
+	{
+		for (int row = 0; row < cells; row++)
+		{
+			for (int column = 0; column < cells; column++)
+			{
+				const RasterVertex& topLeft = grid[row * (cells + 1) + column];
+				const RasterVertex& topRight = grid[row * (cells + 1) + column + 1];
+				const RasterVertex& bottomLeft = grid[(row + 1) * (cells + 1) + column];
+				const RasterVertex& bottomRight = grid[(row + 1) * (cells + 1) + column + 1];
+				TriangleRasteriser::DrawTriangle(bitmap, tile, mode, topLeft, topRight, bottomLeft, nullptr, &lighting);
+				TriangleRasteriser::DrawTriangle(bitmap, tile, mode, topRight, bottomRight, bottomLeft, nullptr, &lighting);
+			}
+		}
+	};
+
+	size_t pixelCount = size_t(size) * size;
+	TimeKernel("DrawTriangle (Gouraud)", pixelCount, [&]()
+	{
+		drawGrid(ShadeMode::Gouraud);
+	});
+	for (float roughness : { 0.5f, 8.0f })
+	{
+		lighting.Prepare(ambientLight, directionalLights, pointLights, spotLights, Vertex(0, 0, -50), true, 0.2f, 0.5f, 0.4f, 0.4f, roughness);
+		TimeKernel(roughness == 0.5f ? "DrawTriangle (Phong, roughness 0.5)" : "DrawTriangle (Phong, roughness 8)", pixelCount, [&]()
+		{
+			drawGrid(ShadeMode::Phong);
+		});
+	}
+}
@@ -0,0 +1,25 @@
+#pragma once
+#include <string>
+
+// Small timing loops for the inner kernels of the rasteriser, run from the headless platform
+// with --microbenchmark NAME. Each kernel is repeated until enough time has passed to give a
+// stable result, and the time per item is written to standard output.
+//
+// Benchmarks:
+//   transform   Transforming vertices by a matrix, one Vertex at a time and in batches
+//   animation   Interpolating between two quantised keyframes
+//   lighting    Smooth lighting with the demo's lights, with and without specular highlights,
+//               and with 256 small point lights
+//   shading     Drawing triangles with Gouraud shading and with per-pixel lighting
+class Microbenchmarks
+{
+public:
+	// Runs the named benchmark. Returns false if there is no benchmark with that name
+	static bool Run(const std::string& name);
+
+private:
+	static void RunTransform();
+	static void RunAnimation();
+	static void RunLighting();
+	static void RunShading();
+};
@@ -2,9 +2,11 @@
 #include <algorithm>
 #include <functional>
 #include <math.h>
+#include <cfloat>
+#include "Simd.h"
 
-// Default constructor
-Model::Model() 
+// Default constructor. The model is empty until it is given an asset
+Model::Model() : _asset(std::make_shared<ModelAsset>())
 {
 }
 
@@ -13,25 +15,43 @@ Model::~Model()
 {
 }
 
+// Uses a loaded asset for the model. Each model has its own copy of the polygons, since they
+// are lit, culled and sorted every frame, but everything else is shared with the asset
+void Model::SetAsset(const std::shared_ptr<const ModelAsset>& asset)
+{
+	_asset = asset;
+	_polygons = asset->GetPolygons();
+	_animation.clear();
+	_animating = false;
+	_posed = false;
+}
+
+const std::shared_ptr<const ModelAsset>& Model::GetAsset() const
+{
+	return _asset;
+}
+
 // Accessor methods
-const std::vector<Polygon3D>& Model::GetPolygons()
+const std::vector<Polygon3D>& Model::GetPolygons() const
 {
 	return _polygons;
 }
 
-const std::vector<Vertex>& Model::GetVertices()
+// Returns the vertices of the current animation frame, or those loaded from the file if the
+// model has not been posed
+const VertexBuffer& Model::GetVertices() const
 {
-	return _vertices;
+	return _posed ? _posedVertices : _asset->GetVertices();
 }
 
-const std::vector<Vertex>& Model::GetTransformedVertices()
+const VertexBuffer& Model::GetTransformedVertices() const
 {
 	return _transformedVertices;
 }
 
-const std::vector<UVPair>& Model::GetUVPairs()
+const std::vector<UVPair>& Model::GetUVPairs() const
 {
-	return _uvPairs;
+	return _asset->GetUVPairs();
 }
 
 size_t Model::GetPolygonCount() const
@@ -41,58 +61,131 @@ size_t Model::GetPolygonCount() const
 
 size_t Model::GetVertexCount() const 
 {
-	return _vertices.size();
+	return _asset->GetVertices().GetCount();
 }
 
-// Adds new vertex to the _vertices vector
-void Model::AddVertex(float x, float y, float z) 
+size_t Model::GetFrameCount() const
 {
-	_vertices.push_back(Vertex(x, y, z, 1));
+	return _asset->GetKeyframes().GetFrameCount();
 }
 
-// Adds new polygon to the _polygons vector
-void Model::AddPolygon(int i0, int i1, int i2, int uvIndex0, int uvIndex1, int uvIndex2)
+bool Model::SetAnimation(const std::string& name)
 {
-	_polygons.push_back(Polygon3D(i0, i1, i2, uvIndex0, uvIndex1, uvIndex2));
+	if (name == _animation)
+	{
+		return _animating;
+	}
+	_animation = name;
+	_animating = !name.empty() && _asset->GetKeyframes().FindAnimation(name, _animationFirst, _animationLast);
+	// Goes back to the rest pose rather than keeping whichever frame the last animation was on
+	if (!_animating)
+	{
+		_posed = false;
+		_frame0 = 0;
+		_frame1 = 0;
+	}
+	return _animating;
 }
 
-// Adds new UV pair to the _uvPairs vector
-void Model::AddTextureUV(float u, float v)
+// Interpolates between the two frames either side of the time. The last frame of the
+// animation is interpolated back to the first so that it loops smoothly
+void Model::SetAnimationTime(float seconds)
 {
-	_uvPairs.push_back(UVPair(u, v));
+	if (!_animating)
+	{
+		return;
+	}
+	size_t frameCount = _animationLast - _animationFirst + 1;
+	float position = fmodf(seconds * _framesPerSecond, float(frameCount));
+	if (position < 0)
+	{
+		position += float(frameCount);
+	}
+	size_t frame = std::min(static_cast<size_t>(position), frameCount - 1);
+	size_t nextFrame = (frame + 1) % frameCount;
+	SetFrame(_animationFirst + frame, _animationFirst + nextFrame, position - float(frame));
+}
+
+void Model::SetFrame(size_t frame0, size_t frame1, float amount)
+{
+	const Keyframes& keyframes = _asset->GetKeyframes();
+	if (frame0 < keyframes.GetFrameCount() && frame1 < keyframes.GetFrameCount())
+	{
+		keyframes.Interpolate(frame0, frame1, amount, _posedVertices);
+		_posed = true;
+		_frame0 = frame0;
+		_frame1 = frame1;
+	}
 }
 
 // Returns model texture
-Texture& Model::GetTexture()
+const Texture& Model::GetTexture() const
 {
-	return _texture;
+	return _asset->GetTexture();
 }
 
-// Applies tranformation to local vertices then adds the result to _transformedVertices which is cleared each time this method is called
+// Applies tranformation to local vertices and stores the result in _transformedVertices, which keeps its storage between frames
 void Model::ApplyTransformToLocalVertices(const Matrix& transform)
 {
-	_transformedVertices.clear();
-	for(Vertex vertex : _vertices) 
-	{
-		_transformedVertices.push_back(transform * vertex);
-	}
+	_transformedVertices.Transform(transform, GetVertices());
 }
 
 // Applies tranformation to tranformed vertices then overwrites the existing value with the new result
 void Model::ApplyTransformToTransformedVertices(const Matrix& transform)
 {
-	for (Vertex& vertex : _transformedVertices) 
-	{
-		vertex = transform * vertex;
-	}
+	_transformedVertices.Transform(transform, _transformedVertices);
+}
+
+// Normals are transformed by the inverse transpose of the transform, so that they stay at right
+// angles to the surface when the model is scaled unevenly
+void Model::TransformNormals(const Matrix& transform)
+{
+	_transformedVertices.TransformNormals(transform.GetNormalMatrix(), GetVertices(), _visibleBlocks);
+}
+
+// Applies a projection to the tranformed vertices and dehomogenises them in the same pass
+void Model::Project(const Matrix& transform)
+{
+	_transformedVertices.Project(transform);
 }
 
-// Dehomogenises all transformed vertices
-void Model::Dehomogenise()
+// The bounds cover every frame of the animation, so the model can be tested before it is posed
+bool Model::IsVisible(const Frustum& frustum, const Matrix& modelTransform) const
 {
-	for (Vertex& vertex : _transformedVertices)
+	return frustum.IsVisible(_asset->GetBounds(), modelTransform);
+}
+
+// A pose between two frames lies inside the bounds of the two frames together. Models whose
+// asset has no clusters are never culled here
+void Model::CullClusters(const Frustum& frustum, const Matrix& modelTransform)
+{
+	size_t clusterCount = _asset->GetClusterCount();
+	if (clusterCount == 0)
+	{
+		for (Polygon3D& poly : _polygons)
+		{
+			poly.SetCulling(false);
+		}
+		return;
+	}
+	_clusterVisible.resize(clusterCount);
+	for (size_t i = 0; i < clusterCount; i++)
+	{
+		BoundingVolume bounds;
+		if (_posed)
+		{
+			bounds.Add(_asset->GetClusterBounds(i, _frame0));
+			bounds.Add(_asset->GetClusterBounds(i, _frame1));
+		}
+		else
+		{
+			bounds = _asset->GetClusterBounds(i);
+		}
+		_clusterVisible[i] = frustum.IsVisible(bounds, modelTransform);
+	}
+	for (Polygon3D& poly : _polygons)
 	{
-		vertex.Dehomogenise();
+		poly.SetCulling(!_clusterVisible[poly.GetCluster()]);
 	}
 }
 
@@ -102,12 +195,15 @@ void Model::CalculateBackfaces(Camera camera)
 	// Loops through all polygons in the model
 	for (Polygon3D &poly : _polygons) 
 	{
-		// Ensures that polygon is not marked for culling before calculations are made incase it has now moved into view
-		poly.SetCulling(false);
+		// Polygons outside the view are already culled
+		if (poly.GetCulling())
+		{
+			continue;
+		}
 		// Gets vertices in polygon
-		Vertex vertex0 = GetTransformedVertices()[poly.GetIndex(0)];
-		Vertex vertex1 = GetTransformedVertices()[poly.GetIndex(1)];
-		Vertex vertex2 = GetTransformedVertices()[poly.GetIndex(2)];
+		Vertex vertex0 = _transformedVertices.GetPosition(poly.GetIndex(0));
+		Vertex vertex1 = _transformedVertices.GetPosition(poly.GetIndex(1));
+		Vertex vertex2 = _transformedVertices.GetPosition(poly.GetIndex(2));
 
 		// Gets difference between vertex0 and vertex1
 		Vertex vectorA = vertex0 - vertex1;
@@ -128,31 +224,64 @@ void Model::CalculateBackfaces(Camera camera)
 	}
 }
 
-// Sorts polygons in the model so in descending order of average z values
-void Model::Sort(void)
+// Vertices are marked in groups of four, since that is how they are lit
+void Model::CollectVisiblePolygons()
 {
-	// Loops through all polygons in the model
-	for (Polygon3D &poly : _polygons)
+	_visiblePolygons.clear();
+	_blockUsed.assign((GetVertices().GetCount() + 3) / 4, 0);
+	for (size_t i = 0; i < _polygons.size(); i++)
 	{
-		// Gets vertices in polygon
-		Vertex vertex0 = GetTransformedVertices()[poly.GetIndex(0)];
-		Vertex vertex1 = GetTransformedVertices()[poly.GetIndex(1)];
-		Vertex vertex2 = GetTransformedVertices()[poly.GetIndex(2)];
+		const Polygon3D& poly = _polygons[i];
+		if (!poly.GetCulling())
+		{
+			_visiblePolygons.push_back(int(i));
+			_blockUsed[poly.GetIndex(0) / 4] = 1;
+			_blockUsed[poly.GetIndex(1) / 4] = 1;
+			_blockUsed[poly.GetIndex(2) / 4] = 1;
+		}
+	}
+	_visibleBlocks.clear();
+	for (size_t i = 0; i < _blockUsed.size(); i++)
+	{
+		if (_blockUsed[i])
+		{
+			_visibleBlocks.push_back(i * 4);
+		}
+	}
+}
+
+const std::vector<int>& Model::GetVisiblePolygons() const
+{
+	return _visiblePolygons;
+}
 
-		// Calculates avergae z value for the 3 vertices and stores it in the polygon instance
-		poly.SetAverageZ((vertex0.GetZ() + vertex1.GetZ() + vertex2.GetZ()) / 3);
+// Sorts the indices of the visible polygons rather than the polygons themselves, so that
+// polygons that are not drawn are not sorted and nothing is copied
+void Model::Sort(void)
+{
+	// Loops through the visible polygons
+	for (int index : _visiblePolygons)
+	{
+		Polygon3D& poly = _polygons[index];
+		// Calculates average camera space z value for the 3 vertices, which is saved when the
+		// vertices are projected, and stores it in the polygon instance
+		const float* z = _transformedVertices.GetPreTransformZ();
+		poly.SetAverageZ((z[poly.GetIndex(0)] + z[poly.GetIndex(1)] + z[poly.GetIndex(2)]) / 3);
 	}
 	// Uses std::sort to sort the list of polygons in descending order of average z values
-	std::sort(_polygons.begin(), _polygons.end(), std::less<Polygon3D>());
-	std::reverse(_polygons.begin(), _polygons.end());
+	std::sort(_visiblePolygons.begin(), _visiblePolygons.end(), [this](int a, int b)
+	{
+		return _polygons[b] < _polygons[a];
+	});
 }
 
-// Applies ambient lighting to each polygon in the model
-void Model::CalculateFlatLightingAmbient(AmbientLight ambientLight)
+// Applies ambient lighting to each visible polygon in the model
+void Model::CalculateFlatLightingAmbient(const AmbientLight& ambientLight)
 {
 	float rgb[3];
-	for (Polygon3D& poly : _polygons)
+	for (int index : _visiblePolygons)
 	{
+		Polygon3D& poly = _polygons[index];
 		rgb[0] = GetRValue(ambientLight.GetColour());
 		rgb[1] = GetGValue(ambientLight.GetColour());
 		rgb[2] = GetBValue(ambientLight.GetColour());
@@ -165,24 +294,25 @@ void Model::CalculateFlatLightingAmbient(AmbientLight ambientLight)
 	}
 }
 
-// Applies directional lighting to each polygon in the model
-void Model::CalculateFlatLightingDirectional(std::vector<DirectionalLight> directionalLights)
+// Applies directional lighting to each visible polygon in the model
+void Model::CalculateFlatLightingDirectional(const std::vector<DirectionalLight>& directionalLights)
 {
 	float rgbTotal[3];
 	float rgbTemp[3];
 
-	// Loops through all polygons in the model
-	for (Polygon3D& poly : _polygons)
+	// Loops through the visible polygons in the model
+	for (int index : _visiblePolygons)
 	{
+		Polygon3D& poly = _polygons[index];
 		//Resets total rgb to ambient light
 		rgbTotal[0] = GetRValue(poly.GetColour());
 		rgbTotal[1] = GetGValue(poly.GetColour());
 		rgbTotal[2] = GetBValue(poly.GetColour());
 
 		// Gets vertices in polygon
-		Vertex vertex0 = GetTransformedVertices()[poly.GetIndex(0)];
-		Vertex vertex1 = GetTransformedVertices()[poly.GetIndex(1)];
-		Vertex vertex2 = GetTransformedVertices()[poly.GetIndex(2)];
+		Vertex vertex0 = _transformedVertices.GetPosition(poly.GetIndex(0));
+		Vertex vertex1 = _transformedVertices.GetPosition(poly.GetIndex(1));
+		Vertex vertex2 = _transformedVertices.GetPosition(poly.GetIndex(2));
 
 		// Gets difference between vertex0 and vertex1
 		Vertex vectorA = vertex0 - vertex1;
@@ -193,7 +323,7 @@ void Model::CalculateFlatLightingDirectional(std::vector<DirectionalLight> direc
 		Vertex normalVector = vectorB * vectorA;
 
 		// Loops through all directional light sources
-		for (DirectionalLight light : directionalLights)
+		for (const DirectionalLight& light : directionalLights)
 		{
 			// Sets temp rgb values to light rgb intensity
 			rgbTemp[0] = GetRValue(light.GetColour());
@@ -234,24 +364,25 @@ void Model::CalculateFlatLightingDirectional(std::vector<DirectionalLight> direc
 	}
 }
 
-// Applies point lighting to each polygon in the model
-void Model::CalculateFlatLightingPoint(std::vector<PointLight> pointLights)
+// Applies point lighting to each visible polygon in the model
+void Model::CalculateFlatLightingPoint(const std::vector<PointLight>& pointLights)
 {
 	float rgbTotal[3];
 	float rgbTemp[3];
 
-	// Loops through all polygons in the model
-	for (Polygon3D& poly : _polygons)
+	// Loops through the visible polygons in the model
+	for (int index : _visiblePolygons)
 	{
+		Polygon3D& poly = _polygons[index];
 		//Resets total rgb to current light
 		rgbTotal[0] = GetRValue(poly.GetColour());
 		rgbTotal[1] = GetGValue(poly.GetColour());
 		rgbTotal[2] = GetBValue(poly.GetColour());
 
 		// Gets vertices in polygon
-		Vertex vertex0 = GetTransformedVertices()[poly.GetIndex(0)];
-		Vertex vertex1 = GetTransformedVertices()[poly.GetIndex(1)];
-		Vertex vertex2 = GetTransformedVertices()[poly.GetIndex(2)];
+		Vertex vertex0 = _transformedVertices.GetPosition(poly.GetIndex(0));
+		Vertex vertex1 = _transformedVertices.GetPosition(poly.GetIndex(1));
+		Vertex vertex2 = _transformedVertices.GetPosition(poly.GetIndex(2));
 
 		// Gets difference between vertex0 and vertex1
 		Vertex vectorA = vertex0 - vertex1;
@@ -262,7 +393,7 @@ void Model::CalculateFlatLightingPoint(std::vector<PointLight> pointLights)
 		Vertex normalVector = vectorB * vectorA;
 
 		// Loops through all point light sources
-		for (PointLight light : pointLights)
+		for (const PointLight& light : pointLights)
 		{
 			// Sets temp rgb values to light rgb intensity
 			rgbTemp[0] = GetRValue(light.GetColour());
@@ -314,423 +445,97 @@ void Model::CalculateFlatLightingPoint(std::vector<PointLight> pointLights)
 	}
 }
 
-// Applies ambient lighting to each vertex in the model
-void Model::CalculateSmoothLightingAmbient(AmbientLight ambientLight)
-{
-	float rgb[3];
-
-	// Loops through all vertices
-	for (Vertex& vertex : _transformedVertices)
-	{
-		rgb[0] = GetRValue(ambientLight.GetColour());
-		rgb[1] = GetGValue(ambientLight.GetColour());
-		rgb[2] = GetBValue(ambientLight.GetColour());
-
-		rgb[0] *= _kAmbient;
-		rgb[1] *= _kAmbient;
-		rgb[2] *= _kAmbient;
-
-		vertex.SetColour(RGB(rgb[0], rgb[1], rgb[2]));
-	}
-}
-
-// Applies directional lighting to each vertex in the model
-void Model::CalculateSmoothLightingDirectional(std::vector<DirectionalLight> directionalLights)
+// Clamps red, green and blue values between 0 and 255 and packs them into four COLORREFs
+static inline void PackColours(uint32_t* colours, const Float4& red, const Float4& green, const Float4& blue)
 {
-	float rgbTotal[3];
-	float rgbTemp[3];
-
-	// Loops through all vertices
-	for (Vertex& vertex : _transformedVertices)
-	{
-		//Resets total rgb to ambient light
-		rgbTotal[0] = GetRValue(vertex.GetColour());
-		rgbTotal[1] = GetGValue(vertex.GetColour());
-		rgbTotal[2] = GetBValue(vertex.GetColour());
-
-		// Loops through all directional light sources
-		for (DirectionalLight light : directionalLights)
-		{
-			// Sets temp rgb values to light rgb intensity
-			rgbTemp[0] = GetRValue(light.GetColour());
-			rgbTemp[1] = GetGValue(light.GetColour());
-			rgbTemp[2] = GetBValue(light.GetColour());
-
-			// Modulates temp rgb by material reflectance coefficient 
-			rgbTemp[0] *= _kDirectionalDiffuse;
-			rgbTemp[1] *= _kDirectionalDiffuse;
-			rgbTemp[2] *= _kDirectionalDiffuse;
-
-			// Gets dot product of polygon normal vector and light source direction
-			float dotProduct = light.GetDirection().Normalise() & vertex.GetNormal().Normalise();
-			if (dotProduct < 0)
-			{
-				dotProduct = 0;
-			}
-
-			// Multiplies rgb values by dot product
-			rgbTemp[0] *= dotProduct;
-			rgbTemp[1] *= dotProduct;
-			rgbTemp[2] *= dotProduct;
-
-			// Add temp rgb to total rgb
-			rgbTotal[0] += rgbTemp[0];
-			rgbTotal[1] += rgbTemp[1];
-			rgbTotal[2] += rgbTemp[2];
-		}
-
-		// Clamps rgb values between 0 and 255
-		for (float& value : rgbTotal)
-		{
-			value = value <= 0 ? 0 : value <= 255 ? value : 255;
-		}
-
-		// Stored colour in vertex
-		vertex.SetColour(RGB(rgbTotal[0], rgbTotal[1], rgbTotal[2]));
-	}
+	Float4 lowest = Float4::Set1(0.0f);
+	Float4 highest = Float4::Set1(255.0f);
+	Int4 r = Float4::Min(Float4::Max(red, lowest), highest).ToInt();
+	Int4 g = Float4::Min(Float4::Max(green, lowest), highest).ToInt();
+	Int4 b = Float4::Min(Float4::Max(blue, lowest), highest).ToInt();
+	(r | (g << 8) | (b << 16)).Store(colours);
 }
 
-// Applies point lighting to each vertex in the model
-void Model::CalculateSmoothLightingPoint(std::vector<PointLight> pointLights)
-{
-	float rgbTotal[3];
-	float rgbTemp[3];
-
-	// Loops through all vertices
-	for (Vertex& vertex : _transformedVertices)
-	{
-		//Resets total rgb to current light
-		rgbTotal[0] = GetRValue(vertex.GetColour());
-		rgbTotal[1] = GetGValue(vertex.GetColour());
-		rgbTotal[2] = GetBValue(vertex.GetColour());
-
-		// Loops through all point light sources
-		for (PointLight light : pointLights)
-		{
-			// Sets temp rgb values to light rgb intensity
-			rgbTemp[0] = GetRValue(light.GetColour());
-			rgbTemp[1] = GetGValue(light.GetColour());
-			rgbTemp[2] = GetBValue(light.GetColour());
-
-			// Modulates temp rgb by material reflectance coefficient 
-			rgbTemp[0] *= _kPointDiffuse;
-			rgbTemp[1] *= _kPointDiffuse;
-			rgbTemp[2] *= _kPointDiffuse;
-
-			// Gets attentuation value and applies it to rgb
-			Vertex difference = vertex - light.GetPosition();
-			Vertex normalisedDifference = difference.Normalise();
-			float d = difference.Length();
-			float atten = 1 / (light.GetA() + light.GetB() * d + light.GetC() * pow(d, 2));
-			atten *= 100;
-
-			rgbTemp[0] *= atten;
-			rgbTemp[1] *= atten;
-			rgbTemp[2] *= atten;
-
-			// Gets dot product of of polygon and light sources normal vectors
-			float dotProduct = normalisedDifference & vertex.GetNormal().Normalise();
-			if (dotProduct < 0)
-			{
-				dotProduct = 0;
-			}
-
-			// Multiplies rgb values by dot product
-			rgbTemp[0] *= dotProduct;
-			rgbTemp[1] *= dotProduct;
-			rgbTemp[2] *= dotProduct;
-
-			// Add temp rgb to total rgb
-			rgbTotal[0] += rgbTemp[0];
-			rgbTotal[1] += rgbTemp[1];
-			rgbTotal[2] += rgbTemp[2];
-		}
-
-		// Clamps rgb values between 0 and 255
-		for (float& value : rgbTotal)
-		{
-			value = value <= 0 ? 0 : value <= 255 ? value : 255;
-		}
-
-		// Stored colour in vertex
-		vertex.SetColour(RGB(rgbTotal[0], rgbTotal[1], rgbTotal[2]));
-	}
-}
+// Number of point and spot lights above which they are sorted into a LightGrid rather than
+// every light being tried against every vertex
+static const size_t LIGHT_GRID_THRESHOLD = 8;
 
-// Applies directional specular lighting to each vertex in the model
-void Model::CalculateSmoothLightingDirectionalSpecular(std::vector<DirectionalLight> directionalLights, Camera camera)
+// Lights the groups of four vertices used by visible polygons. The padding at the end of the
+// streams, and any vertices in a group that no visible polygon uses, are lit along with the
+// rest and ignored afterwards. The lit colour of each vertex is only clamped and
+// packed into a COLORREF once every light has been added
+void Model::CalculateSmoothLighting(const AmbientLight& ambientLight, const std::vector<DirectionalLight>& directionalLights, const std::vector<PointLight>& pointLights, const std::vector<SpotLight>& spotLights, const Camera& camera, bool specular)
 {
-	float rgbTotal[3];
-	float rgbTemp[3];
+	_lighting.Prepare(ambientLight, directionalLights, pointLights, spotLights, camera.GetPosition(), specular, _kAmbient, _kDirectionalDiffuse, _kPointDiffuse, _kPointSpecular, _roughness);
+	const std::vector<Lighting::LightTerms>& lights = _lighting.GetPointLights();
 
-	// Loops through all vertices
-	for (Vertex& vertex : _transformedVertices)
+	VertexBuffer& vertices = _transformedVertices;
+	bool cullLights = lights.size() > LIGHT_GRID_THRESHOLD && !_visibleBlocks.empty();
+	if (cullLights)
 	{
-		//Resets total rgb to current light
-		rgbTotal[0] = GetRValue(vertex.GetColour());
-		rgbTotal[1] = GetGValue(vertex.GetColour());
-		rgbTotal[2] = GetBValue(vertex.GetColour());
-
-		// Loops through all point light sources
-		for (DirectionalLight light : directionalLights)
+		// Covers the vertices that are lit, including the padding since it is lit too, with the grid
+		float minimum[3] = { FLT_MAX, FLT_MAX, FLT_MAX };
+		float maximum[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+		const float* streams[3] = { vertices.GetX(), vertices.GetY(), vertices.GetZ() };
+		for (int axis = 0; axis < 3; axis++)
 		{
-			// Sets temp rgb values to light rgb intensity
-			rgbTemp[0] = GetRValue(light.GetColour());
-			rgbTemp[1] = GetGValue(light.GetColour());
-			rgbTemp[2] = GetBValue(light.GetColour());
-
-			Vertex L = light.GetDirection();
-			Vertex N = vertex.GetNormal();
-			Vertex V = vertex - camera.GetPosition();
-			Vertex LPlusV = L.Normalise() + V.Normalise();
-			Vertex H = LPlusV.Normalise();
-
-			// Gets dot product of normal vector and light source direction
-			float LDotN = L.Normalise() & N.Normalise();
-			if (LDotN < 0)
-			{
-				LDotN = 0;
-			}
-
-			// Gets dot product of polygon normal vector and halfway vector
-			float NDotH = N.Normalise() & H.Normalise();
-			if (NDotH < 0)
+			for (size_t block : _visibleBlocks)
 			{
-				NDotH = 0;
+				for (size_t i = block; i < block + 4; i++)
+				{
+					minimum[axis] = std::min(minimum[axis], streams[axis][i]);
+					maximum[axis] = std::max(maximum[axis], streams[axis][i]);
+				}
 			}
-
-			float iPD = (_kPointDiffuse * LDotN) + (_kPointSpecular * (pow(NDotH, _roughness)));
-
-			// Multiplies rgb values by dot product
-			rgbTemp[0] *= iPD;
-			rgbTemp[1] *= iPD;
-			rgbTemp[2] *= iPD;
-
-			// Add temp rgb to total rgb
-			rgbTotal[0] += rgbTemp[0];
-			rgbTotal[1] += rgbTemp[1];
-			rgbTotal[2] += rgbTemp[2];
 		}
-
-		// Clamps rgb values between 0 and 255
-		for (float& value : rgbTotal)
+		_lightGrid.Reset(minimum, maximum, lights.size());
+		for (size_t i = 0; i < lights.size(); i++)
 		{
-			value = value <= 0 ? 0 : value <= 255 ? value : 255;
+			_lightGrid.Add(static_cast<int>(i), lights[i].x, lights[i].y, lights[i].z, lights[i].radius);
 		}
-
-		// Stored colour in vertex
-		vertex.SetColour(RGB(rgbTotal[0], rgbTotal[1], rgbTotal[2]));
 	}
-}
 
-// Applies point specular lighting to each vertex in the model
-void Model::CalculateSmoothLightingPointSpecular(std::vector<PointLight> pointLights, Camera camera)
-{
-	float rgbTotal[3];
-	float rgbTemp[3];
-
-	// Loops through all vertices
-	for (Vertex& vertex : _transformedVertices)
+	for (size_t i : _visibleBlocks)
 	{
-		//Resets total rgb to current light
-		rgbTotal[0] = GetRValue(vertex.GetColour());
-		rgbTotal[1] = GetGValue(vertex.GetColour());
-		rgbTotal[2] = GetBValue(vertex.GetColour());
-
-		// Loops through all point light sources
-		for (PointLight light : pointLights)
+		const std::vector<int>* nearbyLights = &_lighting.GetAllPointLights();
+		if (cullLights)
 		{
-			// Sets temp rgb values to light rgb intensity
-			rgbTemp[0] = GetRValue(light.GetColour());
-			rgbTemp[1] = GetGValue(light.GetColour());
-			rgbTemp[2] = GetBValue(light.GetColour());
-
-			Vertex L = vertex - light.GetPosition();
-			Vertex N = vertex.GetNormal();
-			Vertex V = vertex - camera.GetPosition();
-			Vertex LPlusV = L.Normalise() + V.Normalise();
-			Vertex H = LPlusV.Normalise();
-
-			// Gets dot product of normal vector and light source direction
-			float LDotN = L.Normalise() & N.Normalise();
-			if (LDotN < 0)
+			float minimum[3];
+			float maximum[3];
+			const float* streams[3] = { vertices.GetX(), vertices.GetY(), vertices.GetZ() };
+			for (int axis = 0; axis < 3; axis++)
 			{
-				LDotN = 0;
+				const float* values = streams[axis] + i;
+				minimum[axis] = std::min(std::min(values[0], values[1]), std::min(values[2], values[3]));
+				maximum[axis] = std::max(std::max(values[0], values[1]), std::max(values[2], values[3]));
 			}
-
-			// Gets dot product of polygon normal vector and halfway vector
-			float NDotH = N.Normalise() & H.Normalise();
-			if (NDotH < 0)
-			{
-				NDotH = 0;
-			}
-
-			// Gets attentuation value
-			float d = L.Length();
-			float atten = 1 / (light.GetA() + light.GetB() * d + light.GetC() * pow(d, 2));
-			atten *= 100;
-
-			float iPD = ((_kPointDiffuse * LDotN) * atten) + (_kPointSpecular * (pow((NDotH), _roughness)) * atten);
-
-			// Multiplies rgb values by dot product
-			rgbTemp[0] *= iPD;
-			rgbTemp[1] *= iPD;
-			rgbTemp[2] *= iPD;
-
-			// Add temp rgb to total rgb
-			rgbTotal[0] += rgbTemp[0];
-			rgbTotal[1] += rgbTemp[1];
-			rgbTotal[2] += rgbTemp[2];
-		}
-
-		// Clamps rgb values between 0 and 255
-		for (float& value : rgbTotal)
-		{
-			value = value <= 0 ? 0 : value <= 255 ? value : 255;
+			nearbyLights = &_lightGrid.Gather(minimum, maximum);
 		}
 
-		// Stored colour in vertex
-		vertex.SetColour(RGB(rgbTotal[0], rgbTotal[1], rgbTotal[2]));
+		Float4 red;
+		Float4 green;
+		Float4 blue;
+		_lighting.Shade(Float4::Load(vertices.GetX() + i), Float4::Load(vertices.GetY() + i), Float4::Load(vertices.GetZ() + i),
+						Float4::Load(vertices.GetNormalX() + i), Float4::Load(vertices.GetNormalY() + i), Float4::Load(vertices.GetNormalZ() + i),
+						*nearbyLights, red, green, blue);
+		PackColours(vertices.GetColour() + i, red, green, blue);
 	}
 }
 
-// Used to calculate light intensity for spot lights
-float Model::SmoothStep(float edge0, float edge1, float x)
+// Only prepares the lights, since the lighting is worked out for each pixel as the model is
+// drawn. The vertices are kept as they are before projection, for their positions and normals
+void Model::CalculatePixelLighting(const AmbientLight& ambientLight, const std::vector<DirectionalLight>& directionalLights, const std::vector<PointLight>& pointLights, const std::vector<SpotLight>& spotLights, const Camera& camera, bool specular)
 {
-	float result;
-	if (x < edge0)
-	{
-		result = 0.0f;
-	}
-	else if (x >= edge1)
-	{
-		result = 1.0f;
-	}
-	else
-	{
-		float t = (x - edge0) / (edge1 - edge0);
-		result = (3.0f - 2.0f * t) * (t * t);
-	}
-	return result;
+	_lighting.Prepare(ambientLight, directionalLights, pointLights, spotLights, camera.GetPosition(), specular, _kAmbient, _kDirectionalDiffuse, _kPointDiffuse, _kPointSpecular, _roughness);
+	_worldVertices = _transformedVertices;
 }
 
-// Applies spot lighting to each vertex in the model
-void Model::CalculateSpotLighting(std::vector<SpotLight> spotLights, Camera camera)
+const Lighting& Model::GetLighting() const
 {
-	float rgbTotal[3];
-	float rgbTemp[3];
-
-	// Loops through all vertices
-	for (Vertex& vertex : _transformedVertices)
-	{
-		//Resets total rgb to current light
-		rgbTotal[0] = GetRValue(vertex.GetColour());
-		rgbTotal[1] = GetGValue(vertex.GetColour());
-		rgbTotal[2] = GetBValue(vertex.GetColour());
-
-		// Loops through all point light sources
-		for (SpotLight light : spotLights)
-		{
-			// Sets temp rgb values to light rgb intensity
-			rgbTemp[0] = GetRValue(light.GetColour());
-			rgbTemp[1] = GetGValue(light.GetColour());
-			rgbTemp[2] = GetBValue(light.GetColour());
-
-			Vertex L = vertex - light.GetPosition();
-			Vertex N = vertex.GetNormal();
-			Vertex V = vertex - camera.GetPosition();
-			Vertex LPlusV = L.Normalise() + V.Normalise();
-			Vertex H = LPlusV.Normalise();
-
-			// Gets dot product of normal vector and light source direction
-			float LDotN = L.Normalise() & N.Normalise();
-			if (LDotN < 0)
-			{
-				LDotN = 0;
-			}
-
-			// Gets dot product of polygon normal vector and halfway vector
-			float NDotH = N.Normalise() & H.Normalise();
-			if (NDotH < 0)
-			{
-				NDotH = 0;
-			}
-
-			// Gets attentuation value
-			float d = L.Length();
-			float atten = 1 / (light.GetA() + light.GetB() * d + light.GetC() * pow(d, 2));
-			atten *= 100;
-
-			float iPD = ((_kPointDiffuse * LDotN) * atten) + (_kPointSpecular * (pow((NDotH), _roughness)) * atten);
-
-			// Gets smooothstep value to fade light between inner and outer angle
-			float smoothstepVal = SmoothStep(cos(light.GetOuterAngle()), cos(light.GetInnerAngle()), LDotN);
-			iPD *= smoothstepVal;
-
-			// Multiplies rgb values by dot product
-			rgbTemp[0] *= iPD;
-			rgbTemp[1] *= iPD;
-			rgbTemp[2] *= iPD;
-
-			// Add temp rgb to total rgb
-			rgbTotal[0] += rgbTemp[0];
-			rgbTotal[1] += rgbTemp[1];
-			rgbTotal[2] += rgbTemp[2];
-		}
-
-		// Clamps rgb values between 0 and 255
-		for (float& value : rgbTotal)
-		{
-			value = value <= 0 ? 0 : value <= 255 ? value : 255;
-		}
-
-		// Stored colour in vertex
-		vertex.SetColour(RGB(rgbTotal[0], rgbTotal[1], rgbTotal[2]));
-	}
+	return _lighting;
 }
 
-// Calculates the normal vectors at each vertex
-void Model::CalculateNormals()
+const VertexBuffer& Model::GetWorldVertices() const
 {
-	for (Vertex& vertex : _transformedVertices)
-	{
-		vertex.SetNormal(Vertex(0, 0, 0));
-		vertex.SetContributions(0);
-	}
-
-	for (Polygon3D& poly : _polygons)
-	{
-		// Gets vertices in polygon
-		Vertex& vertex0 = _transformedVertices[poly.GetIndex(0)];
-		Vertex& vertex1 = _transformedVertices[poly.GetIndex(1)];
-		Vertex& vertex2 = _transformedVertices[poly.GetIndex(2)];
-
-		// Gets difference between vertex0 and vertex1
-		Vertex vectorA = vertex0 - vertex1;
-		// Gets difference between vertex0 and vertex2
-		Vertex vectorB = vertex0 - vertex2;
-
-		// Calculates the normal vector
-		Vertex normalVector = vectorB * vectorA;
-
-		vertex0.SetNormal(vertex0.GetNormal() + normalVector);
-		vertex1.SetNormal(vertex1.GetNormal() + normalVector);
-		vertex2.SetNormal(vertex2.GetNormal() + normalVector);
-
-		vertex0.IncreaseContributions();
-		vertex1.IncreaseContributions();
-		vertex2.IncreaseContributions();
-	}
-
-	for (Vertex& vertex : _transformedVertices)
-	{
-		float newx = vertex.GetNormal().GetX() / vertex.GetContributions();
-		float newy = vertex.GetNormal().GetY() / vertex.GetContributions();
-		float newz = vertex.GetNormal().GetZ() / vertex.GetContributions();
-		Vertex temp = Vertex(newx, newy, newz);
-		vertex.SetNormal(temp.Normalise());
-	}
+	return _worldVertices;
 }
-
-
-
@@ -11,6 +11,13 @@
 #include "SpotLight.h"
 #include "Texture.h"
 #include "UVPair.h"
+#include "VertexBuffer.h"
+#include "ModelAsset.h"
+#include "LightGrid.h"
+#include "Lighting.h"
+#include "Frustum.h"
+#include <memory>
+#include <string>
 
 class Model
 {
@@ -19,50 +26,88 @@ public:
 	Model();
 	// Destructor
 	~Model();
+	// Loaded geometry and texture, which may be shared with other models
+	void SetAsset(const std::shared_ptr<const ModelAsset>& asset);
+	const std::shared_ptr<const ModelAsset>& GetAsset() const;
 	// Accessors and mutators
-	const std::vector<Polygon3D>& GetPolygons();
-	const std::vector<Vertex>& GetVertices();
-	const std::vector<Vertex>& GetTransformedVertices();
-	const std::vector<UVPair>& GetUVPairs();
+	const std::vector<Polygon3D>& GetPolygons() const;
+	const VertexBuffer& GetVertices() const;
+	const VertexBuffer& GetTransformedVertices() const;
+	const std::vector<UVPair>& GetUVPairs() const;
 	size_t GetPolygonCount() const;
 	size_t GetVertexCount() const;
-	void AddVertex(float x, float y, float z);
-	void AddPolygon(int i0, int i1, int i2, int uvIndex0, int uvIndex1, int uvIndex2);
-	void AddTextureUV(float u, float v);
-	Texture& GetTexture();
+	const Texture& GetTexture() const;
+	// Keyframe animation. The local vertices are replaced by the animated positions
+	size_t GetFrameCount() const;
+	// Selects the frames played by SetAnimationTime, e.g. "stand" or "run". An empty name, or one
+	// that is not found, stops the animation and puts the model back in its rest pose. Returns
+	// false if the animation was not found
+	bool SetAnimation(const std::string& name);
+	// Sets the local vertices to their positions the given time into the current animation, which loops
+	void SetAnimationTime(float seconds);
+	// Sets the local vertices to a position between two frames
+	void SetFrame(size_t frame0, size_t frame1, float amount);
 	// Other methods
 	void ApplyTransformToLocalVertices(const Matrix& transform);
 	void ApplyTransformToTransformedVertices(const Matrix& transform);
-	void Dehomogenise();
+	// Transforms the normals of the local vertices used by visible polygons into the transformed
+	// vertices. transform is the matrix that was applied to the positions
+	void TransformNormals(const Matrix& transform);
+	void Project(const Matrix& transform);
+	// Returns false if no part of the model can be seen in any frame of its animation, in which
+	// case nothing else needs to be done with it this frame
+	bool IsVisible(const Frustum& frustum, const Matrix& modelTransform) const;
+	// Marks the polygons of every cluster that cannot be seen in the current pose for culling and
+	// clears the culling of the rest. Called every frame before the backfaces are calculated
+	void CullClusters(const Frustum& frustum, const Matrix& modelTransform);
+	// Marks polygons facing away from the camera for culling. Polygons already marked are skipped
 	void CalculateBackfaces(Camera camera);
+	// Lists the polygons that are not culled, and the vertices they use, so that lighting and
+	// drawing only touch what can be seen. Called once culling is finished
+	void CollectVisiblePolygons();
+	// Indices of the polygons that are not culled, in the order they should be drawn
+	const std::vector<int>& GetVisiblePolygons() const;
+	// Sorts the visible polygons in descending order of average z values
 	void Sort(void);
 
 	// Lighting calculation functions
-	// Flat lighting
-	void CalculateFlatLightingAmbient(AmbientLight ambientLight);
-	void CalculateFlatLightingDirectional(std::vector<DirectionalLight> directionalLights);
-	void CalculateFlatLightingPoint(std::vector<PointLight> pointLights);
-	// Smooth lighting
-	void CalculateSmoothLightingAmbient(AmbientLight ambientLight);
-	void CalculateSmoothLightingDirectional(std::vector<DirectionalLight> directionalLights);
-	void CalculateSmoothLightingPoint(std::vector<PointLight> pointLights);
-	// Specular lighting
-	void CalculateSmoothLightingDirectionalSpecular(std::vector<DirectionalLight> directionalLights, Camera camera);
-	void CalculateSmoothLightingPointSpecular(std::vector<PointLight> pointLights, Camera camera);
-	static float SmoothStep(float edge0, float edge1, float x);
-	void CalculateSpotLighting(std::vector<SpotLight> spotLights, Camera camera);
-
-	// Saves vertex normals
-	void CalculateNormals();
+	// Flat lighting, applied to the visible polygons
+	void CalculateFlatLightingAmbient(const AmbientLight& ambientLight);
+	void CalculateFlatLightingDirectional(const std::vector<DirectionalLight>& directionalLights);
+	void CalculateFlatLightingPoint(const std::vector<PointLight>& pointLights);
+	// Smooth lighting. Every light is applied to four vertices at a time in a single pass over
+	// the vertices of the visible polygons. Specular highlights and spot lights are only used if specular is true.
+	// Point and spot lights are ignored beyond the distance where they would add less than
+	// half a colour level, and when there are many of them each group of vertices only
+	// considers the lights within reach of it
+	void CalculateSmoothLighting(const AmbientLight& ambientLight, const std::vector<DirectionalLight>& directionalLights, const std::vector<PointLight>& pointLights, const std::vector<SpotLight>& spotLights, const Camera& camera, bool specular);
+	// Per-pixel lighting. Prepares the lights, which are then applied to each pixel by the
+	// triangle rasteriser using the positions and normals of the world vertices. Must be called
+	// before the model is projected
+	void CalculatePixelLighting(const AmbientLight& ambientLight, const std::vector<DirectionalLight>& directionalLights, const std::vector<PointLight>& pointLights, const std::vector<SpotLight>& spotLights, const Camera& camera, bool specular);
+	const Lighting& GetLighting() const;
+	const VertexBuffer& GetWorldVertices() const;
 
 private:
+	// Shared data loaded from file
+	std::shared_ptr<const ModelAsset> _asset;
 	// Collections
 	std::vector<Polygon3D> _polygons;
-	std::vector<Vertex> _vertices;
-	std::vector<Vertex> _transformedVertices;
-	std::vector<UVPair> _uvPairs;
-	// Texture for model
-	Texture _texture;
+	VertexBuffer _transformedVertices;
+	// Vertices of the current animation frame, used instead of the vertices of the asset once
+	// the model has been posed
+	VertexBuffer _posedVertices;
+	bool _posed = false;
+	// Frames the model was posed between
+	size_t _frame0 = 0;
+	size_t _frame1 = 0;
+	// Range of frames being played
+	std::string _animation;
+	bool _animating = false;
+	size_t _animationFirst = 0;
+	size_t _animationLast = 0;
+	// MD2 animations were made to be played at 10 frames per second
+	float _framesPerSecond = 10.0f;
 	// Reflection coefficients
 	float _kAmbient = 0.2f;
 	float _kDirectionalDiffuse = 0.5f;
@@ -70,5 +115,20 @@ private:
 	float _kPointDiffuse = 0.4f;
 	float _kPointSpecular = 0.4f;
 	float _roughness = 0.5f;
+
+	// Whether each cluster of polygons could be seen this frame
+	std::vector<char> _clusterVisible;
+	// Polygons that are not culled, and the first vertex of each group of four vertices that
+	// they use
+	std::vector<int> _visiblePolygons;
+	std::vector<char> _blockUsed;
+	std::vector<size_t> _visibleBlocks;
+
+	// Lights prepared for smooth and per-pixel lighting, kept between frames so that they are not reallocated
+	Lighting _lighting;
+	// Point and spot lights near each part of the model, used when there are many of them
+	LightGrid _lightGrid;
+	// Transformed vertices as they were before being projected, used for per-pixel lighting
+	VertexBuffer _worldVertices;
 };
 
@@ -0,0 +1,247 @@
+#include "ModelAsset.h"
+#include <algorithm>
+#include <cmath>
+
+ModelAsset::ModelAsset()
+{
+}
+
+ModelAsset::~ModelAsset()
+{
+}
+
+// Adds new vertex to the _vertices buffer
+void ModelAsset::AddVertex(float x, float y, float z)
+{
+	_vertices.Add(x, y, z);
+}
+
+// Adds new polygon to the _polygons vector
+void ModelAsset::AddPolygon(int i0, int i1, int i2, int uvIndex0, int uvIndex1, int uvIndex2)
+{
+	_polygons.push_back(Polygon3D(i0, i1, i2, uvIndex0, uvIndex1, uvIndex2));
+}
+
+// Adds new UV pair to the _uvPairs vector
+void ModelAsset::AddTextureUV(float u, float v)
+{
+	_uvPairs.push_back(UVPair(u, v));
+}
+
+// Adds an animation frame to the keyframes
+void ModelAsset::AddFrame(const char* name, const float scale[3], const float translate[3], const BYTE* vertices, int vertexCount)
+{
+	_keyframes.AddFrame(name, scale, translate, vertices, static_cast<size_t>(vertexCount));
+}
+
+// Records the skin size given in the model file
+void ModelAsset::SetSkinSize(int width, int height)
+{
+	_skinWidth = width;
+	_skinHeight = height;
+}
+
+Texture& ModelAsset::GetTexture()
+{
+	return _texture;
+}
+
+// Sums the normals of the polygons that share each vertex and normalises the sums. Vertices that
+// are not used by any polygon are given a zero normal. The normals of the animation frames come
+// from the MD2 normal table, which is then turned to face the same way
+void ModelAsset::CalculateNormals()
+{
+	float* normalX = _vertices.GetNormalX();
+	float* normalY = _vertices.GetNormalY();
+	float* normalZ = _vertices.GetNormalZ();
+	std::fill(normalX, normalX + _vertices.GetPaddedCount(), 0.0f);
+	std::fill(normalY, normalY + _vertices.GetPaddedCount(), 0.0f);
+	std::fill(normalZ, normalZ + _vertices.GetPaddedCount(), 0.0f);
+
+	for (const Polygon3D& poly : _polygons)
+	{
+		Vertex vertex0 = _vertices.GetPosition(poly.GetIndex(0));
+		Vertex vertex1 = _vertices.GetPosition(poly.GetIndex(1));
+		Vertex vertex2 = _vertices.GetPosition(poly.GetIndex(2));
+		Vertex normal = (vertex0 - vertex2) * (vertex0 - vertex1);
+		for (int j = 0; j < 3; j++)
+		{
+			int index = poly.GetIndex(j);
+			normalX[index] += normal.GetX();
+			normalY[index] += normal.GetY();
+			normalZ[index] += normal.GetZ();
+		}
+	}
+
+	for (size_t i = 0; i < _vertices.GetCount(); i++)
+	{
+		float length = sqrtf(normalX[i] * normalX[i] + normalY[i] * normalY[i] + normalZ[i] * normalZ[i]);
+		if (length > 0)
+		{
+			normalX[i] /= length;
+			normalY[i] /= length;
+			normalZ[i] /= length;
+		}
+	}
+	_keyframes.OrientNormals(_vertices);
+}
+
+void ModelAsset::CalculateBounds()
+{
+	std::vector<int> polygons(_polygons.size());
+	for (size_t i = 0; i < polygons.size(); i++)
+	{
+		polygons[i] = int(i);
+	}
+	_clusterCount = 0;
+	if (!polygons.empty())
+	{
+		BuildClusters(polygons, 0, polygons.size());
+	}
+
+	size_t frameCount = _keyframes.GetFrameCount();
+	_clusterBounds.assign(_clusterCount * (frameCount + 1), BoundingVolume());
+	AddClusterBounds(_vertices, _clusterBounds.data());
+	VertexBuffer frame;
+	for (size_t f = 0; f < frameCount; f++)
+	{
+		_keyframes.Interpolate(f, f, 0, frame);
+		AddClusterBounds(frame, _clusterBounds.data() + _clusterCount * (f + 1));
+	}
+
+	_bounds = BoundingVolume();
+	for (const BoundingVolume& bounds : _clusterBounds)
+	{
+		_bounds.Add(bounds);
+	}
+}
+
+void ModelAsset::BuildClusters(std::vector<int>& polygons, size_t first, size_t last)
+{
+	if (last - first <= CLUSTER_SIZE)
+	{
+		int cluster = int(_clusterCount++);
+		for (size_t i = first; i < last; i++)
+		{
+			_polygons[polygons[i]].SetCluster(cluster);
+		}
+		return;
+	}
+
+	// Centres are taken from the vertices as loaded, which is enough to keep neighbouring
+	// polygons together. They are left as the sum of the three vertices, since only their order
+	// matters
+	auto centre = [this](int polygon, int axis)
+	{
+		const float* coordinates = axis == 0 ? _vertices.GetX() : axis == 1 ? _vertices.GetY() : _vertices.GetZ();
+		const Polygon3D& poly = _polygons[polygon];
+		return coordinates[poly.GetIndex(0)] + coordinates[poly.GetIndex(1)] + coordinates[poly.GetIndex(2)];
+	};
+	BoundingVolume centres;
+	for (size_t i = first; i < last; i++)
+	{
+		centres.Add(centre(polygons[i], 0), centre(polygons[i], 1), centre(polygons[i], 2));
+	}
+	int axis = 0;
+	for (int i = 1; i < 3; i++)
+	{
+		if (centres.GetMaximum()[i] - centres.GetMinimum()[i] > centres.GetMaximum()[axis] - centres.GetMinimum()[axis])
+		{
+			axis = i;
+		}
+	}
+
+	size_t middle = first + (last - first) / 2;
+	std::nth_element(polygons.begin() + first, polygons.begin() + middle, polygons.begin() + last, [&centre, axis](int a, int b)
+	{
+		return centre(a, axis) < centre(b, axis);
+	});
+	BuildClusters(polygons, first, middle);
+	BuildClusters(polygons, middle, last);
+}
+
+void ModelAsset::AddClusterBounds(const VertexBuffer& vertices, BoundingVolume* clusterBounds)
+{
+	const float* x = vertices.GetX();
+	const float* y = vertices.GetY();
+	const float* z = vertices.GetZ();
+	for (const Polygon3D& poly : _polygons)
+	{
+		BoundingVolume& bounds = clusterBounds[poly.GetCluster()];
+		for (int j = 0; j < 3; j++)
+		{
+			size_t index = static_cast<size_t>(poly.GetIndex(j));
+			if (index < vertices.GetCount())
+			{
+				bounds.Add(x[index], y[index], z[index]);
+			}
+		}
+	}
+}
+
+const std::vector<Polygon3D>& ModelAsset::GetPolygons() const
+{
+	return _polygons;
+}
+
+const VertexBuffer& ModelAsset::GetVertices() const
+{
+	return _vertices;
+}
+
+const std::vector<UVPair>& ModelAsset::GetUVPairs() const
+{
+	return _uvPairs;
+}
+
+const Keyframes& ModelAsset::GetKeyframes() const
+{
+	return _keyframes;
+}
+
+const Texture& ModelAsset::GetTexture() const
+{
+	return _texture;
+}
+
+const BoundingVolume& ModelAsset::GetBounds() const
+{
+	return _bounds;
+}
+
+size_t ModelAsset::GetClusterCount() const
+{
+	return _clusterCount;
+}
+
+const BoundingVolume& ModelAsset::GetClusterBounds(size_t cluster) const
+{
+	return _clusterBounds[cluster];
+}
+
+const BoundingVolume& ModelAsset::GetClusterBounds(size_t cluster, size_t frame) const
+{
+	return _clusterBounds[_clusterCount * (frame + 1) + cluster];
+}
+
+int ModelAsset::GetSkinWidth() const
+{
+	return _skinWidth;
+}
+
+int ModelAsset::GetSkinHeight() const
+{
+	return _skinHeight;
+}
+
+size_t ModelAsset::GetMemorySize() const
+{
+	return sizeof(ModelAsset)
+		+ _file.GetSize()
+		+ _polygons.capacity() * sizeof(Polygon3D)
+		+ _vertices.GetMemorySize()
+		+ _uvPairs.capacity() * sizeof(UVPair)
+		+ _clusterBounds.capacity() * sizeof(BoundingVolume)
+		+ _keyframes.GetMemorySize()
+		+ _texture.GetMemorySize();
+}
@@ -0,0 +1,84 @@
+#pragma once
+#include "Platform.h"
+#include "Polygon3D.h"
+#include "BoundingVolume.h"
+#include "VertexBuffer.h"
+#include "Keyframes.h"
+#include "MappedFile.h"
+#include "Texture.h"
+#include "UVPair.h"
+#include <cstddef>
+#include <vector>
+
+// Everything loaded from the files of a model: its polygons, vertices, animation frames, texture
+// coordinates and texture. An asset is filled in by the MD2 loader or read from a baked mesh and
+// is never changed after that, so one asset can be shared by every Model that draws it
+class ModelAsset
+{
+	friend class BakedMesh;
+
+public:
+	ModelAsset();
+	~ModelAsset();
+	ModelAsset(const ModelAsset&) = delete;
+	ModelAsset& operator=(const ModelAsset&) = delete;
+
+	// Used by the MD2 loader to fill in the asset
+	void AddVertex(float x, float y, float z);
+	void AddPolygon(int i0, int i1, int i2, int uvIndex0, int uvIndex1, int uvIndex2);
+	void AddTextureUV(float u, float v);
+	void AddFrame(const char* name, const float scale[3], const float translate[3], const BYTE* vertices, int vertexCount);
+	void SetSkinSize(int width, int height);
+	Texture& GetTexture();
+	// Calculates the normal of each vertex of the first frame from the polygons around it. Called
+	// once the loader has added every polygon and vertex
+	void CalculateNormals();
+	// Groups the polygons into clusters of neighbouring polygons, and works out the bounding
+	// volumes of the model and of each cluster in every animation frame, so that parts of a
+	// large model can be culled on their own. Called once the asset is loaded
+	void CalculateBounds();
+
+	// Accessors
+	const std::vector<Polygon3D>& GetPolygons() const;
+	const VertexBuffer& GetVertices() const;
+	const std::vector<UVPair>& GetUVPairs() const;
+	const Keyframes& GetKeyframes() const;
+	const Texture& GetTexture() const;
+	// Bounding volume of the model over every animation frame
+	const BoundingVolume& GetBounds() const;
+	// Number of clusters the polygons are grouped into, and the bounding volume of a cluster
+	// either as loaded or in an animation frame
+	size_t GetClusterCount() const;
+	const BoundingVolume& GetClusterBounds(size_t cluster) const;
+	const BoundingVolume& GetClusterBounds(size_t cluster, size_t frame) const;
+	// Size of the texture the texture coordinates were made for
+	int GetSkinWidth() const;
+	int GetSkinHeight() const;
+	// Approximate number of bytes of memory used by the asset
+	size_t GetMemorySize() const;
+
+private:
+	// Most polygons in a cluster
+	static const size_t CLUSTER_SIZE = 64;
+
+	// Splits the polygons listed between first and last in half at the median of their centres
+	// along the longest axis until there are few enough of them to make a cluster
+	void BuildClusters(std::vector<int>& polygons, size_t first, size_t last);
+	// Adds the polygons of each cluster to its bounding volume, using the given vertices
+	void AddClusterBounds(const VertexBuffer& vertices, BoundingVolume* clusterBounds);
+
+	// Baked mesh file that the keyframes are read from in place. This is declared first so that
+	// it is unmapped after everything that points into it has gone
+	MappedFile _file;
+	std::vector<Polygon3D> _polygons;
+	VertexBuffer _vertices;
+	std::vector<UVPair> _uvPairs;
+	Keyframes _keyframes;
+	Texture _texture;
+	int _skinWidth{ 0 };
+	int _skinHeight{ 0 };
+	BoundingVolume _bounds;
+	size_t _clusterCount{ 0 };
+	// Bounding volume of each cluster as loaded, followed by those of each frame in turn
+	std::vector<BoundingVolume> _clusterBounds;
+};
@@ -0,0 +1,44 @@
+#pragma once
+
+// Platform layer for the rasteriser.
+//
+// The Win32 window and message pump are used on Windows unless RASTERISER_HEADLESS is
+// defined. Every other platform always uses the headless backend, which renders into an
+// in-memory bitmap with no display attached.
+
+#if !defined(_WIN32) && !defined(RASTERISER_HEADLESS)
+#define RASTERISER_HEADLESS
+#endif
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <cstdint>
+
+// Windows types and colour macros that the rest of the rasteriser relies on
+typedef unsigned char	BYTE;
+typedef uint16_t		WORD;
+typedef uint32_t		DWORD;
+typedef DWORD			COLORREF;
+
+#define RGB(r, g, b)	((COLORREF)(((BYTE)(r) | ((WORD)((BYTE)(g)) << 8)) | (((DWORD)(BYTE)(b)) << 16)))
+#define GetRValue(rgb)	((BYTE)(rgb))
+#define GetGValue(rgb)	((BYTE)(((WORD)(rgb)) >> 8))
+#define GetBValue(rgb)	((BYTE)((rgb) >> 16))
+#endif
+
+class Framework;
+
+// Interface for the code that hosts a Framework - creating the bitmap it draws on,
+// driving the Update/Render loop and presenting the results.
+class Platform
+{
+public:
+	virtual ~Platform() {}
+
+	// Create whatever is needed to display the framework (window, bitmap etc).
+	// Returns false if this could not be done.
+	virtual bool Initialise(Framework& framework) = 0;
+	// Runs the main loop until the application exits. Returns the exit code
+	virtual int MainLoop(Framework& framework) = 0;
+};
@@ -1,4 +1,6 @@
 #include "PointLight.h"
+#include <cfloat>
+#include <cmath>
 
 // Constructors
 PointLight::PointLight() : AmbientLight()
@@ -50,3 +52,27 @@ float PointLight::GetC() const
 {
 	return _c;
 }
+
+// Solves a + b * d + c * d * d = 1 / minimumAttenuation for the largest d
+float PointLight::GetRadius(float minimumAttenuation) const
+{
+	if (minimumAttenuation <= 0)
+	{
+		return FLT_MAX;
+	}
+	float constant = _a - 1 / minimumAttenuation;
+	if (constant >= 0)
+	{
+		// The light is never bright enough
+		return 0.0f;
+	}
+	if (_c > 0)
+	{
+		return (-_b + sqrtf(_b * _b - 4 * _c * constant)) / (2 * _c);
+	}
+	if (_b > 0)
+	{
+		return -constant / _b;
+	}
+	return FLT_MAX;
+}
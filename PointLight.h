@@ -1,7 +1,7 @@
 #pragma once
 #include "Vertex.h"
 #include "AmbientLight.h"
-#include <windows.h>
+#include "Platform.h"
 
 // Class for point light that loses intensity over range
 // Inherits from ambient light, spot light inherits from this
@@ -19,6 +19,9 @@ public:
 	float GetA() const;
 	float GetB() const;
 	float GetC() const;
+	// Distance at which the attenuation 1 / (a + b * d + c * d * d) falls to minimumAttenuation,
+	// beyond which the light can be ignored. Returns FLT_MAX if the light never falls that far
+	float GetRadius(float minimumAttenuation) const;
 protected:
 	Vertex _position;
 	float _a;
@@ -32,6 +32,7 @@ Polygon3D::Polygon3D(const Polygon3D& p)
 	_markedForCulling = p.GetCulling();
 	_averageZ = p.GetAverageZ();
 	_colour = p.GetColour();
+	_cluster = p.GetCluster();
 }
 
 // Destructor
@@ -80,6 +81,16 @@ COLORREF Polygon3D::GetColour() const
 	return _colour;
 }
 
+void Polygon3D::SetCluster(int cluster)
+{
+	_cluster = cluster;
+}
+
+int Polygon3D::GetCluster() const
+{
+	return _cluster;
+}
+
 Polygon3D& Polygon3D::operator=(const Polygon3D& rhs)
 {
 	// Only do the assignment if we are not assigning
@@ -95,6 +106,7 @@ Polygon3D& Polygon3D::operator=(const Polygon3D& rhs)
 		_markedForCulling = rhs.GetCulling();
 		_averageZ = rhs.GetAverageZ();
 		_colour = rhs.GetColour();
+		_cluster = rhs.GetCluster();
 	}
 	return *this;
 }
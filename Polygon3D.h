@@ -1,5 +1,5 @@
 #pragma once
-#include <Windows.h>
+#include "Platform.h"
 #include "Vertex.h"
 
 class Polygon3D
@@ -20,6 +20,9 @@ public:
 	float GetAverageZ() const;
 	void SetColour(COLORREF colour);
 	COLORREF GetColour() const;
+	// Cluster of neighbouring polygons that this polygon is culled with (see ModelAsset)
+	void SetCluster(int cluster);
+	int GetCluster() const;
 	// Assingment operator
 	Polygon3D& operator= (const Polygon3D& rhs);
 	// Other operator
@@ -32,6 +35,7 @@ private:
 	bool _markedForCulling = false;
 	float _averageZ;
 	COLORREF _colour;
+	int _cluster = 0;
 };
 
 
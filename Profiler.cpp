@@ -0,0 +1,168 @@
+#include "Profiler.h"
+
+#ifdef RASTERISER_PROFILE
+
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <iomanip>
+
+static const char* const STAGE_NAMES[int(ProfileStage::Count)] =
+{
+	"frame",
+	"animation",
+	"transform",
+	"cull",
+	"backface",
+	"normals",
+	"lighting ambient",
+	"lighting directional",
+	"lighting point",
+	"lighting smooth",
+	"lighting pixel",
+	"project",
+	"sort",
+	"clear",
+	"raster",
+	"present"
+};
+
+Profiler& Profiler::Get()
+{
+	static Profiler profiler;
+	return profiler;
+}
+
+const char* Profiler::GetName(ProfileStage stage)
+{
+	return STAGE_NAMES[int(stage)];
+}
+
+Profiler::Profiler()
+	: _origin(std::chrono::steady_clock::now()), _frameTotals{}, _frameTimed{},
+	  _history(size_t(HISTORY_FRAMES) * size_t(ProfileStage::Count)), _trace(TRACE_EVENTS)
+{
+}
+
+int64_t Profiler::Now() const
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - _origin).count();
+}
+
+int Profiler::GetThreadNumber()
+{
+	static std::atomic<int> nextThread{ 0 };
+	thread_local int thread = nextThread++;
+	return thread;
+}
+
+void Profiler::Record(ProfileStage stage, int64_t start, int64_t end)
+{
+	int thread = GetThreadNumber();
+	std::lock_guard<std::mutex> lock(_mutex);
+	_frameTotals[int(stage)] += end - start;
+	_frameTimed[int(stage)] = true;
+	_trace[_traceNext] = { stage, thread, start, end - start };
+	_traceNext = (_traceNext + 1) % TRACE_EVENTS;
+	_traceCount = std::min(_traceCount + 1, int(TRACE_EVENTS));
+}
+
+void Profiler::EndFrame()
+{
+	int64_t now = Now();
+	std::lock_guard<std::mutex> lock(_mutex);
+	// The first frame is timed from when the profiler was created
+	_frameTotals[int(ProfileStage::Frame)] = now - _lastFrameEnd;
+	_frameTimed[int(ProfileStage::Frame)] = true;
+	_lastFrameEnd = now;
+
+	int64_t* frame = &_history[size_t(_historyNext) * size_t(ProfileStage::Count)];
+	for (int stage = 0; stage < int(ProfileStage::Count); stage++)
+	{
+		frame[stage] = _frameTimed[stage] ? _frameTotals[stage] : -1;
+		_frameTotals[stage] = 0;
+		_frameTimed[stage] = false;
+	}
+	_historyNext = (_historyNext + 1) % HISTORY_FRAMES;
+	_historyCount = std::min(_historyCount + 1, int(HISTORY_FRAMES));
+}
+
+Profiler::Statistics Profiler::GetStatistics(ProfileStage stage) const
+{
+	std::vector<int64_t> times;
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		for (int i = 0; i < _historyCount; i++)
+		{
+			int64_t time = _history[size_t(i) * size_t(ProfileStage::Count) + size_t(stage)];
+			if (time >= 0)
+			{
+				times.push_back(time);
+			}
+		}
+	}
+
+	Statistics statistics = { 0, 0, 0, int(times.size()) };
+	if (times.empty())
+	{
+		return statistics;
+	}
+	int64_t total = 0;
+	for (int64_t time : times)
+	{
+		total += time;
+	}
+	const double toMilliseconds = 1e-6;
+	statistics.minimum = double(*std::min_element(times.begin(), times.end())) * toMilliseconds;
+	statistics.mean = double(total) / double(times.size()) * toMilliseconds;
+	// Nearest rank, so the percentile is always one of the times
+	size_t rank = (times.size() * 99 + 99) / 100 - 1;
+	std::nth_element(times.begin(), times.begin() + rank, times.end());
+	statistics.percentile99 = double(times[rank]) * toMilliseconds;
+	return statistics;
+}
+
+void Profiler::WriteStatistics(std::ostream& stream) const
+{
+	stream << std::left << std::setw(24) << "stage" << std::right
+		   << std::setw(10) << "min ms" << std::setw(10) << "mean ms" << std::setw(10) << "p99 ms" << std::setw(8) << "frames" << std::endl;
+	std::ios::fmtflags flags = stream.flags();
+	stream << std::fixed << std::setprecision(3);
+	for (int stage = 0; stage < int(ProfileStage::Count); stage++)
+	{
+		Statistics statistics = GetStatistics(ProfileStage(stage));
+		if (statistics.frames == 0)
+		{
+			continue;
+		}
+		stream << std::left << std::setw(24) << GetName(ProfileStage(stage)) << std::right
+			   << std::setw(10) << statistics.minimum << std::setw(10) << statistics.mean << std::setw(10) << statistics.percentile99
+			   << std::setw(8) << statistics.frames << std::endl;
+	}
+	stream.flags(flags);
+}
+
+// Each timing is a complete ("X") event, with times in microseconds
+bool Profiler::WriteTrace(const char* filename) const
+{
+	std::ofstream file(filename, std::ios::out);
+	if (!file)
+	{
+		return false;
+	}
+	std::lock_guard<std::mutex> lock(_mutex);
+	file << std::fixed << std::setprecision(3);
+	file << "{\"traceEvents\":[" << std::endl;
+	int first = (_traceNext - _traceCount + TRACE_EVENTS) % TRACE_EVENTS;
+	for (int i = 0; i < _traceCount; i++)
+	{
+		const TraceEvent& event = _trace[(first + i) % TRACE_EVENTS];
+		file << "{\"name\":\"" << GetName(event.stage) << "\",\"ph\":\"X\",\"pid\":0,\"tid\":" << event.thread
+			 << ",\"ts\":" << double(event.start) * 1e-3 << ",\"dur\":" << double(event.duration) * 1e-3 << "}"
+			 << (i + 1 < _traceCount ? "," : "") << std::endl;
+	}
+	file << "],\"displayTimeUnit\":\"ms\"}" << std::endl;
+	return file.good();
+}
+
+#endif
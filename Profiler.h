@@ -0,0 +1,147 @@
+#pragma once
+
+// Timing of the stages of each frame. Profiling is only compiled in when RASTERISER_PROFILE is
+// defined, for example with -DRASTERISER_PROFILE or in the project's preprocessor definitions.
+// Otherwise the PROFILE_ macros compile to nothing and none of this exists.
+//
+// A stage is timed by putting PROFILE_SCOPE(stage) at the start of a block, which times until
+// the end of the block. Each frame ends with PROFILE_END_FRAME(), which moves the total time of
+// every stage in the frame into a history of recent frames. The minimum, mean and 99th
+// percentile of each stage over the history can then be printed, and the individual timings
+// written out as a Chrome trace, which can be opened in chrome://tracing or Perfetto
+//
+// When frames are pipelined (see FramePipeline.h), frames end on the thread that presents them,
+// while the stages before Raster are already being timed for the frame or two after. The
+// statistics for each frame then mix stages from different frames, so only the trace, which
+// shows each stage on its own thread, is meaningful
+
+// Stages of a frame, in the order they happen
+enum class ProfileStage
+{
+	Frame,
+	Animation,
+	Transform,
+	Cull,
+	Backface,
+	Normals,
+	LightingAmbient,
+	LightingDirectional,
+	LightingPoint,
+	LightingSmooth,
+	LightingPixel,
+	// Dehomogenising and the screen transform, which are done in the same pass
+	Project,
+	Sort,
+	Clear,
+	Raster,
+	Present,
+	Count
+};
+
+#ifdef RASTERISER_PROFILE
+
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <ostream>
+#include <vector>
+
+class Profiler
+{
+public:
+	// Number of frames kept for the statistics
+	static const int HISTORY_FRAMES = 256;
+	// Number of timings kept for the trace
+	static const int TRACE_EVENTS = 1 << 16;
+
+	struct Statistics
+	{
+		// Milliseconds per frame
+		double minimum;
+		double mean;
+		double percentile99;
+		// Number of frames in the history that the stage was timed in
+		int frames;
+	};
+
+	// The profiler shared by the whole program
+	static Profiler&	Get();
+	static const char*	GetName(ProfileStage stage);
+
+	// Nanoseconds since the profiler was created
+	int64_t				Now() const;
+	// Adds a timing of a stage. May be called from any thread
+	void				Record(ProfileStage stage, int64_t start, int64_t end);
+	// Moves the stage totals of the frame into the history, and records the frame itself as the
+	// time since the last frame ended
+	void				EndFrame();
+	Statistics			GetStatistics(ProfileStage stage) const;
+	// Writes a table of the statistics of every stage
+	void				WriteStatistics(std::ostream& stream) const;
+	// Writes the timings kept for the trace in the Chrome trace event format. Returns false if
+	// the file could not be written
+	bool				WriteTrace(const char* filename) const;
+
+private:
+	struct TraceEvent
+	{
+		ProfileStage	stage;
+		int				thread;
+		int64_t			start;
+		int64_t			duration;
+	};
+
+	Profiler();
+
+	// Returns a small number for the calling thread, since the trace viewer shows threads in order
+	static int			GetThreadNumber();
+
+	std::chrono::steady_clock::time_point _origin;
+	mutable std::mutex	_mutex;
+	int64_t				_frameTotals[int(ProfileStage::Count)];
+	bool				_frameTimed[int(ProfileStage::Count)];
+	int64_t				_lastFrameEnd{ 0 };
+	// Ring buffer of stage totals for each frame, in nanoseconds, with -1 for stages that were
+	// not timed in the frame
+	std::vector<int64_t> _history;
+	int					_historyNext{ 0 };
+	int					_historyCount{ 0 };
+	// Ring buffer of timings for the trace
+	std::vector<TraceEvent> _trace;
+	int					_traceNext{ 0 };
+	int					_traceCount{ 0 };
+};
+
+// Times from construction to destruction
+class ProfileScope
+{
+public:
+	explicit ProfileScope(ProfileStage stage) : _stage(stage), _start(Profiler::Get().Now())
+	{
+	}
+
+	~ProfileScope()
+	{
+		Profiler& profiler = Profiler::Get();
+		profiler.Record(_stage, _start, profiler.Now());
+	}
+
+	ProfileScope(const ProfileScope&) = delete;
+	ProfileScope& operator=(const ProfileScope&) = delete;
+
+private:
+	ProfileStage		_stage;
+	int64_t				_start;
+};
+
+#define PROFILE_CONCATENATE_(a, b) a##b
+#define PROFILE_CONCATENATE(a, b) PROFILE_CONCATENATE_(a, b)
+#define PROFILE_SCOPE(stage) ProfileScope PROFILE_CONCATENATE(profileScope, __LINE__)(stage)
+#define PROFILE_END_FRAME() Profiler::Get().EndFrame()
+
+#else
+
+#define PROFILE_SCOPE(stage)
+#define PROFILE_END_FRAME()
+
+#endif
@@ -7,28 +7,78 @@ bool Rasteriser::Initialise()
 {
 	// Initialises variables
 	_demo = Demo();
+	// Attaches a depth buffer to the bitmap if the demo wants one instead of sorting polygons
+	GetBitmap().SetDepthBuffer(_demo.GetDepthBuffer());
+	// Starts the threads that polygons are binned and drawn on
+	_workers.Start(GetThreadCount());
 	// Defines camera
 	_camera = Camera(0, 0, 0, Vertex(0, 0, -50));
 	// Loads model
 	return LoadModel(_demo.GetModel(), _demo.GetTexture());
 }
 
-// Loads model and textures from paths specified into _model
+// Loads model and textures from paths specified, and shows the model from the next frame
 bool Rasteriser::LoadModel(const char* modelPath, const char* texturePath)
 {
-	_model = Model();
-	// Loads model from md2 file, storing vertices and polygon indexes
-	if (!MD2Loader::LoadModel(modelPath, texturePath, _model,
-		&Model::AddPolygon,
-		&Model::AddVertex,
-		&Model::AddTextureUV))
+	// Gets the model and texture from the cache, which only loads them from the md2 and pcx
+	// files the first time they are used
+	std::shared_ptr<const ModelAsset> asset = _assets.Load(modelPath, texturePath);
+	if (!asset)
 	{
 		return false;
 	}
+	_asset = asset;
 
+	// Starts loading the model the demo will switch to next, so it is ready when it is needed
+	_assets.Prefetch(_demo.GetNextModel(), _demo.GetNextTexture());
 	return true;
 }
 
+// The model is loaded before returning and the demo never switches it, so every run with the
+// same model draws exactly the same frames
+bool Rasteriser::Restart(const std::string& modelPath, const std::string& texturePath)
+{
+	_demo = Demo();
+	_demo.SetModel(modelPath.c_str(), texturePath.empty() ? NULL : texturePath.c_str());
+	GetBitmap().SetDepthBuffer(_demo.GetDepthBuffer());
+	// Nothing is kept from the last run, so the first frame never moves on from its pose
+	_pose = ModelPose();
+	_previousPose = ModelPose();
+	_drawPose = ModelPose();
+	_poseStage.clear();
+	DropPreparedFrames();
+	if (!LoadModel(_demo.GetModel(), _demo.GetTexture()))
+	{
+		return false;
+	}
+	// Starts every prepared frame's model again from the rest pose, even if the model is the same
+	for (PreparedFrame& frame : _frames)
+	{
+		frame.model.SetAsset(_asset);
+	}
+	return true;
+}
+
+FrameDescription Rasteriser::DescribeFrame()
+{
+	return { _demo.GetStage(), _demo.GetDrawMode(), _asset ? _asset->GetPolygons().size() : 0 };
+}
+
+// Starts loading a model on a background thread. The current model carries on being drawn
+// until it has loaded, so loading never holds up a frame. If the model failed to load, the
+// current model is kept
+void Rasteriser::LoadModelAsync(const char* modelPath, const char* texturePath)
+{
+	_assets.LoadAsync(modelPath, texturePath, [this](const std::shared_ptr<const ModelAsset>& asset)
+	{
+		if (asset)
+		{
+			_asset = asset;
+		}
+	});
+	_assets.Prefetch(_demo.GetNextModel(), _demo.GetNextTexture());
+}
+
 // Returns viewing matrix to be applied to the model
 Matrix Rasteriser::GenerateViewMatrix(Camera camera) 
 {
@@ -120,13 +170,16 @@ Matrix Rasteriser::GenerateRotationMatrix(float x, float y, float z)
 // Output a string to the bitmap at co-ordinates 10, 10
 // 
 // Parameters: bitmap - A reference to the bitmap object
-//             text   - A pointer to a string of wide characters
+//             text   - The string to display
 //
 // For example, you might call this using:
 //
-//   DrawString(bitmap, L"Text to display");
-void Rasteriser::DrawString(const Bitmap& bitmap, LPCTSTR text)
+//   DrawString(bitmap, "Text to display");
+//
+// Text is drawn using GDI, so nothing is drawn when running headless
+void Rasteriser::DrawString(const Bitmap& bitmap, const std::string& text)
 {
+#ifndef RASTERISER_HEADLESS
 	HDC hdc = bitmap.GetDC();
 	HFONT hFont, hOldFont;
 
@@ -140,1694 +193,603 @@ void Rasteriser::DrawString(const Bitmap& bitmap, LPCTSTR text)
 		SetTextColor(hdc, RGB(255, 255, 255));
 		SetBkColor(hdc, RGB(0, 0, 0));
 
-		// Display the text string.  
-		TextOut(hdc, 10, 10, text, lstrlen(text));
+		// Display the text string. wstring(text.begin(), text.end()) converts the string to
+		// a wide string which is required for the TextOut function
+		std::wstring wideText(text.begin(), text.end());
+		TextOut(hdc, 10, 10, wideText.c_str(), static_cast<int>(wideText.length()));
 
 		// Restore the original font.        
 		SelectObject(hdc, hOldFont);
 	}
 	DeleteObject(hFont);
+#else
+	(void)bitmap;
+	(void)text;
+#endif
 }
 
 // Updates model and applies tranformations
-void Rasteriser::Update(const Bitmap& bitmap)
+void Rasteriser::Update(const Bitmap& /*bitmap*/)
 {
 	// Updates demo class every frame
 	_demo.Update();
-	// If model has been changed, it is reloaded from md2 and pcx files
+	// If model has been changed, it is loaded from md2 and pcx files in the background
 	if (_demo.GetChangedModel())
 	{
-		LoadModel(_demo.GetModel(), _demo.GetTexture());
+		LoadModelAsync(_demo.GetModel(), _demo.GetTexture());
 		_demo.SetChangedModel(false);
 	}
+	// Swaps in any model that has finished loading
+	_assets.Update();
 
-	// Applies model transformation
-	_model.ApplyTransformToLocalVertices(GenerateTranslationMatrix(_demo.GetPosition(0), _demo.GetPosition(1), _demo.GetPosition(2)));
-	_model.ApplyTransformToTransformedVertices(GenerateRotationMatrix(_demo.GetRotation(0), _demo.GetRotation(1), _demo.GetRotation(2)));
-	_model.ApplyTransformToTransformedVertices(GenerateScalingMatrix(_demo.GetScale()));
-}
-
-// Draws model as wireframe
-void Rasteriser::DrawWireframe(const Bitmap& bitmap, Polygon3D poly)
-{
-	// Creates white pen then selects it to be used
-	HPEN pen = CreatePen(PS_SOLID, 1, RGB(255, 255, 255));
-	SelectObject(bitmap.GetDC(), pen);
-	// Gets vertices that make up the polygon
-	Vertex point0 = _model.GetTransformedVertices()[poly.GetIndex(0)];
-	Vertex point1 = _model.GetTransformedVertices()[poly.GetIndex(1)];
-	Vertex point2 = _model.GetTransformedVertices()[poly.GetIndex(2)];
-	// Draws lines between each vertex, creating a triangle shape
-	MoveToEx(bitmap.GetDC(), int(point0.GetX()), int(point0.GetY()), NULL);
-	LineTo(bitmap.GetDC(), int(point1.GetX()), int(point1.GetY()));
-	LineTo(bitmap.GetDC(), int(point2.GetX()), int(point2.GetY()));
-	LineTo(bitmap.GetDC(), int(point0.GetX()), int(point0.GetY()));
-	// Deletes the pen after use
-	DeleteObject(pen);
+	_previousPose = _pose;
+	_pose = { { _demo.GetPosition(0), _demo.GetPosition(1), _demo.GetPosition(2) },
+			  { _demo.GetRotation(0), _demo.GetRotation(1), _demo.GetRotation(2) },
+			  _demo.GetScale(), _demo.GetAnimationTime() };
+	// The model jumps rather than moves when a stage starts or the demo goes back to the start,
+	// so frames are not drawn part of the way between
+	if (_demo.GetStage() != _poseStage || _pose.animationTime < _previousPose.animationTime)
+	{
+		_previousPose = _pose;
+		_poseStage = _demo.GetStage();
+	}
+	_drawPose = _pose;
 }
 
-// Draws model using windows polygons
-void Rasteriser::DrawSolidFlat(const Bitmap& bitmap, Polygon3D poly)
+void Rasteriser::Interpolate(const Bitmap& /*bitmap*/, float amount)
 {
-	// Creates brush and pen of the polygon's colour then selects them to be used
-	HBRUSH brush = CreateSolidBrush(poly.GetColour());
-	HPEN pen = CreatePen(PS_SOLID, 1, poly.GetColour());
-	SelectObject(bitmap.GetDC(), brush);
-	SelectObject(bitmap.GetDC(), pen);
-
-	// Gets vertices that make up the polygon
-	Vertex vertex0 = _model.GetTransformedVertices()[poly.GetIndex(0)];
-	Vertex vertex1 = _model.GetTransformedVertices()[poly.GetIndex(1)];
-	Vertex vertex2 = _model.GetTransformedVertices()[poly.GetIndex(2)];
-
-	// Creates an array of type POINT which is needed to use the Polygon function
-	POINT points[3] = { POINT({long(vertex0.GetX()), long(vertex0.GetY())}), POINT({long(vertex1.GetX()), long(vertex1.GetY())}), POINT({long(vertex2.GetX()), long(vertex2.GetY())}) };
-	// Draws the polygon to the screen
-	Polygon(bitmap.GetDC(), points, 3);
-
-	// Deletes the brush and pen after use
-	DeleteObject(brush);
-	DeleteObject(pen);
+	for (int i = 0; i < 3; i++)
+	{
+		_drawPose.position[i] = _previousPose.position[i] + (_pose.position[i] - _previousPose.position[i]) * amount;
+		_drawPose.rotation[i] = _previousPose.rotation[i] + (_pose.rotation[i] - _previousPose.rotation[i]) * amount;
+	}
+	_drawPose.scale = _previousPose.scale + (_pose.scale - _previousPose.scale) * amount;
+	_drawPose.animationTime = _previousPose.animationTime + (_pose.animationTime - _previousPose.animationTime) * amount;
 }
 
-// Draws model using my own polygon function
-void Rasteriser::MyDrawSolidFlat(const Bitmap& bitmap, Polygon3D poly)
+bool Rasteriser::PoseModel(const Bitmap& bitmap, const ModelPose& pose, Model& model)
 {
-	// Gets vertices that make up the polygon
-	std::vector<Vertex> vertices;
-	vertices.push_back(_model.GetTransformedVertices()[poly.GetIndex(0)]);
-	vertices.push_back(_model.GetTransformedVertices()[poly.GetIndex(1)]);
-	vertices.push_back(_model.GetTransformedVertices()[poly.GetIndex(2)]);
-
-	// Sorts list of vertices in ascending order of Y values using lambda function
-	std::sort(vertices.begin(), vertices.end(), [](const Vertex& a, const Vertex& b) -> bool
+	// Nothing is drawn until a model has been loaded. The window can be resized, and so asked
+	// for a frame, before Initialise has loaded one
+	if (!_asset)
 	{
-		return a.GetY() < b.GetY();
-	});
+		return false;
+	}
 
-	// Check for bottom flat triangle
-	if (vertices[1].GetY() == vertices[2].GetY())
+	// Each prepared frame has its own copy of the model, which switches to a new model when it
+	// is next posed
+	if (model.GetAsset() != _asset)
 	{
-		FillPolygonFlat(bitmap, vertices[0], vertices[1], vertices[2], poly.GetColour());
+		model.SetAsset(_asset);
 	}
-	// Check for top flat triangle
-	else if (vertices[0].GetY() == vertices[1].GetY())
+
+	// Concatenates the model transformation, which translates, then rotates, then scales the
+	// model. It is left on the transform stack for PrepareModel
+	_transforms.LoadIdentity();
+	_transforms.Multiply(GenerateScalingMatrix(pose.scale));
+	_transforms.Multiply(GenerateRotationMatrix(pose.rotation[0], pose.rotation[1], pose.rotation[2]));
+	_transforms.Multiply(GenerateTranslationMatrix(pose.position[0], pose.position[1], pose.position[2]));
+
+	// Tests the model against the view frustum before any work is done on its vertices. Its
+	// bounds cover every frame of its animation, so it does not need to be posed first
+	int windowWidth = bitmap.GetWidth();
+	int windowHeight = bitmap.GetHeight();
 	{
-		FillPolygonFlat(bitmap, vertices[2], vertices[0], vertices[1], poly.GetColour());
+		PROFILE_SCOPE(ProfileStage::Cull);
+		_frustum.Set(GenerateScreenMatrix(1, windowWidth, windowHeight) * GeneratePerspectiveMatrix(1, float(windowWidth) / float(windowHeight)) * GenerateViewMatrix(_camera), windowWidth, windowHeight);
+		if (!model.IsVisible(_frustum, _transforms.GetTop()))
+		{
+			return false;
+		}
 	}
-	// If not flat then split into two managable triangles
-	else
+
+	// Plays the animation of the model, if it has one, and applies the model transformation
+	// in a single pass
 	{
-		// Gets intermediate vertex
-		Vertex temp = Vertex(float(vertices[0].GetX() + (vertices[1].GetY() - vertices[0].GetY()) / (vertices[2].GetY() - vertices[0].GetY()) * (vertices[2].GetX() - vertices[0].GetX())), float(vertices[1].GetY()));
-		FillPolygonFlat(bitmap, vertices[0], vertices[1], temp, poly.GetColour());
-		FillPolygonFlat(bitmap, vertices[2], vertices[1], temp, poly.GetColour());
+		PROFILE_SCOPE(ProfileStage::Animation);
+		model.SetAnimation(_demo.GetAnimation());
+		model.SetAnimationTime(pose.animationTime);
 	}
+	PROFILE_SCOPE(ProfileStage::Transform);
+	model.ApplyTransformToLocalVertices(_transforms.GetTop());
+	return true;
 }
 
-// Returns -1 if input below 0, 0 if it is 0 and 1 if above 0
-int Rasteriser::Signum(float x)
-{
-	return (x > 0) ? 1 : ((x < 0) ? -1 : 0);
-}
-
-// Clamps value between 2 desired values
-float Rasteriser::Clamp(float value, float lower, float upper)
-{
-	return value <= lower ? lower : value <= upper ? value : upper;
-}
-
-// Fills polygons using bresenham lines (flat shading)
-void Rasteriser::FillPolygonFlat(const Bitmap& bitmap, Vertex v1, Vertex v2, Vertex v3, COLORREF colour)
+// Draws a line between two points using the Bresenham algorithm. Like the GDI LineTo
+// function, the final point is not drawn
+void Rasteriser::DrawLine(const Bitmap& bitmap, int x0, int y0, int x1, int y1, COLORREF colour)
 {
-	// Drawing the polygon using the Bresenham algorithm
-	Vertex temp1 = Vertex(v1.GetX(), v1.GetY());
-	Vertex temp2 = Vertex(v1.GetX(), v1.GetY());
+	uint32_t pixel = Bitmap::ToPixel(colour);
+	int width = int(bitmap.GetWidth());
+	int height = int(bitmap.GetHeight());
 
-	bool changed1 = false;
-	bool changed2 = false;
+	int dx = abs(x1 - x0);
+	int dy = -abs(y1 - y0);
+	int signx = x0 < x1 ? 1 : -1;
+	int signy = y0 < y1 ? 1 : -1;
+	int e = dx + dy;
 
-	float dx1 = abs(v2.GetX() - v1.GetX());
-	float dy1 = abs(v2.GetY() - v1.GetY());
-
-	float dx2 = abs(v3.GetX() - v1.GetX());
-	float dy2 = abs(v3.GetY() - v1.GetY());
-
-	int signx1 = Signum(v2.GetX() - v1.GetX());
-	int signx2 = Signum(v3.GetX() - v1.GetX());
-
-	int signy1 = Signum(v2.GetY() - v1.GetY());
-	int signy2 = Signum(v3.GetY() - v1.GetY());
-
-	if (dy1 > dx1)
-	{ 
-		// Swap values
-		float tmp = dx1;
-		dx1 = dy1;
-		dy1 = tmp;
-		changed1 = true;
-	}
-
-	if (dy2 > dx2)
-	{
-		// Swap values
-		float tmp = dx2;
-		dx2 = dy2;
-		dy2 = tmp;
-		changed2 = true;
-	}
-
-	float e1 = 2 * dy1 - dx1;
-	float e2 = 2 * dy2 - dx2;
-
-	for (int i = 0; i <= dx1; i++)
+	while (x0 != x1 || y0 != y1)
 	{
-		float leftEndPoint;
-		float rightEndPoint;
-
-		if (temp1.GetX() < temp2.GetX())
+		// Only pixels inside the bitmap are drawn
+		if (x0 >= 0 && x0 < width && y0 >= 0 && y0 < height)
 		{
-			leftEndPoint = temp1.GetX();
-			rightEndPoint = temp2.GetX();
+			bitmap.GetRow(y0)[x0] = pixel;
 		}
-		else
+		int e2 = 2 * e;
+		if (e2 >= dy)
 		{
-			leftEndPoint = temp2.GetX();
-			rightEndPoint = temp1.GetX();
+			e += dy;
+			x0 += signx;
 		}
-
-		for (int xPos = int(ceil(leftEndPoint)) - 1; xPos <= int(rightEndPoint) + 1; xPos++)
+		if (e2 <= dx)
 		{
-			// Draws pixel
-			SetPixel(bitmap.GetDC(), xPos, int(temp1.GetY()), colour);
+			e += dx;
+			y0 += signy;
 		}
+	}
+}
 
-		while (e1 >= 0)
-		{
-			if (changed1)
-			{
-				temp1.SetX(temp1.GetX() + signx1);
-			}
-			else
+// Draws model as wireframe. Edges are clipped against the planes their vertices are outside of,
+// then scissored to the bitmap so that no time is spent on pixels off the screen
+void Rasteriser::DrawWireframe(const Bitmap& bitmap, const Model& model, const Polygon3D& poly)
+{
+	const VertexBuffer& vertices = model.GetTransformedVertices();
+	const uint32_t* clipFlags = vertices.GetClipFlags();
+	COLORREF white = RGB(255, 255, 255);
+	for (int i = 0; i < 3; i++)
+	{
+		int from = poly.GetIndex(i);
+		int to = poly.GetIndex((i + 1) % 3);
+		float start[3] = { vertices.GetX()[from], vertices.GetY()[from], 1 };
+		float end[3] = { vertices.GetX()[to], vertices.GetY()[to], 1 };
+		if ((clipFlags[from] | clipFlags[to]) != 0)
+		{
+			vertices.GetHomogeneous(from, start[0], start[1], start[2]);
+			vertices.GetHomogeneous(to, end[0], end[1], end[2]);
+			if (!Clipper::ClipLine(start, end, clipFlags[from] | clipFlags[to]))
 			{
-				temp1.SetY(temp1.GetY() + signy1);
+				continue;
 			}
-
-			e1 = e1 - 2 * dx1;
-		}
-
-		if (changed1)
-		{
-			temp1.SetY(temp1.GetY() + signy1);
 		}
-		else
+		if (Clipper::ScissorLine(start[0], start[1], end[0], end[1], 0, 0, float(bitmap.GetWidth()), float(bitmap.GetHeight())))
 		{
-			temp1.SetX(temp1.GetX() + signx1);
-		}
-
-		e1 = e1 + 2 * dy1;
-
-		while (temp2.GetY() != temp1.GetY())
-		{
-			while (e2 >= 0)
-			{
-				if (changed2)
-				{
-					temp2.SetX(temp2.GetX() + signx2);
-				}
-				else
-				{
-					temp2.SetY(temp2.GetY() + signy2);
-				}
-
-				e2 = e2 - 2 * dx2;
-			}
-
-			if (changed2)
-			{
-				temp2.SetY(temp2.GetY() + signy2);
-			}
-			else
-			{
-				temp2.SetX(temp2.GetX() + signx2);
-			}
-
-			e2 = e2 + 2 * dy2;
+			DrawLine(bitmap, int(start[0]), int(start[1]), int(end[0]), int(end[1]), white);
 		}
 	}
 }
 
-// Draws model using bresenham (smooth shading)
-void Rasteriser::DrawGouraudBresenham(const Bitmap& bitmap, Polygon3D poly)
+// Draws model using windows polygons. GDI is not available when running headless,
+// so my own polygon function is used instead
+void Rasteriser::DrawSolidFlat(const Bitmap& bitmap, const Model& model, const Polygon3D& poly)
 {
-	// Gets vertices that make up the polygon
-	std::vector<Vertex> vertices;
-	vertices.push_back(_model.GetTransformedVertices()[poly.GetIndex(0)]);
-	vertices.push_back(_model.GetTransformedVertices()[poly.GetIndex(1)]);
-	vertices.push_back(_model.GetTransformedVertices()[poly.GetIndex(2)]);
-
-	// Sorts list of vertices in ascending order of Y values using lambda function
-	std::sort(vertices.begin(), vertices.end(), [](const Vertex& a, const Vertex& b) -> bool
-	{
-		return a.GetY() < b.GetY();
-	});
+#ifdef RASTERISER_HEADLESS
+	Tile tile = { 0, 0, int(bitmap.GetWidth()) - 1, int(bitmap.GetHeight()) - 1 };
+	DrawPolygon(bitmap, tile, model, poly, ShadeMode::Flat);
+#else
+	// Make sure any direct writes to the pixels have been seen by GDI
+	GdiFlush();
+	// Creates brush and pen of the polygon's colour then selects them to be used
+	HBRUSH brush = CreateSolidBrush(poly.GetColour());
+	HPEN pen = CreatePen(PS_SOLID, 1, poly.GetColour());
+	SelectObject(bitmap.GetDC(), brush);
+	SelectObject(bitmap.GetDC(), pen);
 
-	Vertex v1 = vertices[0];
-	Vertex v2 = vertices[1];
-	Vertex v3 = vertices[2];
+	// Gets vertices that make up the polygon, clipped if any of them are outside the clip planes
+	RasterVertex clippedVertices[Clipper::MAXIMUM_VERTICES];
+	int count = ClipPolygon(model, poly, ShadeMode::Flat, clippedVertices);
 
-	// Check for bottom flat triangle
-	if (v2.GetY() == v3.GetY())
-	{
-		FillPolygonGouraud(bitmap, v1, v2, v3, v1.GetColour(), v2.GetColour(), v3.GetColour());
-	}
-	// Check for top flat triangle
-	else if (v1.GetY() == v2.GetY())
+	// Creates an array of type POINT which is needed to use the Polygon function
+	POINT points[Clipper::MAXIMUM_VERTICES];
+	for (int i = 0; i < count; i++)
 	{
-		FillPolygonGouraud(bitmap, v3, v1, v2, v1.GetColour(), v2.GetColour(), v3.GetColour());
+		points[i] = POINT({ long(clippedVertices[i].x), long(clippedVertices[i].y) });
 	}
-	// If not flat then split into two managable triangles
-	else
+	// Draws the polygon to the screen
+	if (count > 0)
 	{
-		// Gets intermediate vertex
-		Vertex vTemp = Vertex(v1.GetX() + (v2.GetY() - v1.GetY()) / (v3.GetY() - v1.GetY()) * (v3.GetX() - v1.GetX()), v2.GetY());
-		// Get intermediate colour values
-		float cRed = GetRValue(v1.GetColour()) + ((v2.GetY() - v1.GetY()) / (v3.GetY() - v1.GetY())) * (GetRValue(v3.GetColour()) - GetRValue(v1.GetColour()));
-		float cGreen = GetGValue(v1.GetColour()) + ((v2.GetY() - v1.GetY()) / (v3.GetY() - v1.GetY())) * (GetGValue(v3.GetColour()) - GetGValue(v1.GetColour()));
-		float cBlue = GetBValue(v1.GetColour()) + ((v2.GetY() - v1.GetY()) / (v3.GetY() - v1.GetY())) * (GetBValue(v3.GetColour()) - GetBValue(v1.GetColour()));
-		COLORREF cTemp = RGB(cRed, cGreen, cBlue);
-
-		// As we have to draw each line from left to right, we have to check which point of the horizontal line has a lower x-coordinate and swap them if necessary
-		if (v2.GetX() < vTemp.GetX())
-		{
-			FillPolygonGouraud(bitmap, v1, v2, vTemp, v1.GetColour(), v2.GetColour(), cTemp);
-			FillPolygonGouraud(bitmap, v3, v2, vTemp, v3.GetColour(), v2.GetColour(), cTemp);
-		}
-		else
-		{
-			FillPolygonGouraud(bitmap, v1, vTemp, v2, v1.GetColour(), cTemp, v2.GetColour());
-			FillPolygonGouraud(bitmap, v3, vTemp, v2, v3.GetColour(), cTemp, v2.GetColour());
-		}
+		Polygon(bitmap.GetDC(), points, count);
 	}
+
+	// Deletes the brush and pen after use
+	DeleteObject(brush);
+	DeleteObject(pen);
+#endif
 }
 
-// Fills polygon (smooth, bresenham)
-void Rasteriser::FillPolygonGouraud(const Bitmap& bitmap, Vertex v1, Vertex v2, Vertex v3, COLORREF c1, COLORREF c2, COLORREF c3)
+// Gets the vertices of a polygon ready for the triangle rasteriser. If any of them are outside
+// the clip planes, the polygon is clipped and may gain vertices. Returns the number of vertices,
+// which is zero if none of the polygon is left
+int Rasteriser::ClipPolygon(const Model& model, const Polygon3D& poly, ShadeMode mode, RasterVertex output[Clipper::MAXIMUM_VERTICES])
 {
-	// Drawing the polygon using the Bresenham algorithm
-	Vertex temp1 = Vertex(v1.GetX(), v1.GetY());
-	Vertex temp2 = Vertex(v1.GetX(), v1.GetY());
-
-	bool changed1 = false;
-	bool changed2 = false;
-
-	float dx1 = abs(v2.GetX() - v1.GetX());
-	float dy1 = abs(v2.GetY() - v1.GetY());
-
-	// Get total color change on edge1
-	int dRed1 = GetRValue(c2) - GetRValue(c1);
-	int dGreen1 = GetGValue(c2) - GetGValue(c1);
-	int dBlue1 = GetBValue(c2) - GetBValue(c1);
-
-	float dx2 = abs(v3.GetX() - v1.GetX());
-	float dy2 = abs(v3.GetY() - v1.GetY());
-
-	// Get total color change on edge2
-	int dRed2 = GetRValue(c3) - GetRValue(c1);
-	int dGreen2 = GetGValue(c3) - GetGValue(c1);
-	int dBlue2 = GetBValue(c3) - GetBValue(c1);
-
-	int signx1 = Signum(v2.GetX() - v1.GetX());
-	int signx2 = Signum(v3.GetX() - v1.GetX());
-
-	int signy1 = Signum(v2.GetY() - v1.GetY());
-	int signy2 = Signum(v3.GetY() - v1.GetY());
+	const VertexBuffer& vertices = model.GetTransformedVertices();
+	const uint32_t* clipFlags = vertices.GetClipFlags();
+	const std::vector<UVPair>& uvPairs = model.GetUVPairs();
 
-	// Get 'direction' of color change on edge2
-	int signRed2 = Signum(float(GetRValue(c3) - GetRValue(c1)));
-	int signGreen2 = Signum(float(GetGValue(c3) - GetGValue(c1)));
-	int signBlue2 = Signum(float(GetBValue(c3) - GetBValue(c1)));
-
-	if (dy1 > dx1)
-	{
-		// Swap values
-		float tmp = dx1;
-		dx1 = dy1;
-		dy1 = tmp;
-		changed1 = true;
-	}
-
-	if (dy2 > dx2)
+	// Polygons with every vertex outside the same plane are not drawn at all
+	uint32_t flags0 = clipFlags[poly.GetIndex(0)];
+	uint32_t flags1 = clipFlags[poly.GetIndex(1)];
+	uint32_t flags2 = clipFlags[poly.GetIndex(2)];
+	if ((flags0 & flags1 & flags2) != 0)
 	{
-		// Swap values
-		float tmp = dx2;
-		dx2 = dy2;
-		dy2 = tmp;
-		changed2 = true;
+		return 0;
 	}
+	uint32_t clip = flags0 | flags1 | flags2;
 
-	float e1 = 2 * dy1 - dx1;
-	float e2 = 2 * dy2 - dx2;
-
-	// Get scaled starting color of edge1
-	float red1 = GetRValue(c1) * dx1;
-	float green1 = GetGValue(c1) * dx1;
-	float blue1 = GetBValue(c1) * dx1;
-
-	// Get scaled starting color of edge2
-	float red2 = GetRValue(c1) * dx1;
-	float green2 = GetGValue(c1) * dx1;
-	float blue2 = GetBValue(c1) * dx1;
-
-	// Get color change of each step for edge1
-	int deltaRed1 = dRed1;
-	int deltaGreen1 = dGreen1;
-	int deltaBlue1 = dBlue1;
-
-	// Get color change of each step for edge2
-	int deltaRed2 = dRed2;
-	int deltaGreen2 = dGreen2;
-	int deltaBlue2 = dBlue2;
-
-	for (int i = 0; i <= dx1; i++)
+	RasterVertex rasterVertices[3];
+	float w[3];
+	for (int i = 0; i < 3; i++)
 	{
-		// Loop over each pixel of horizontal line 
-		// Check if paint goes from left endpoint of horizontal line to right or other way round
-
-		float leftEndPoint;
-		float rightEndPoint;
-
-		if (temp1.GetX() < temp2.GetX())
+		int index = poly.GetIndex(i);
+		RasterVertex& rasterVertex = clip == 0 ? output[i] : rasterVertices[i];
+		rasterVertex.x = vertices.GetX()[index];
+		rasterVertex.y = vertices.GetY()[index];
+		rasterVertex.zRecip = 1 / vertices.GetPreTransformZ()[index];
+		if (clip != 0)
 		{
-			leftEndPoint = temp1.GetX();
-			rightEndPoint = temp2.GetX();
+			vertices.GetHomogeneous(index, rasterVertex.x, rasterVertex.y, w[i]);
 		}
-		else
+		// Flat shaded polygons use the colour of the polygon rather than its vertices
+		rasterVertex.colour = mode == ShadeMode::Flat ? poly.GetColour() : COLORREF(vertices.GetColour()[index]);
+		rasterVertex.u = 0;
+		rasterVertex.v = 0;
+		if (mode == ShadeMode::Textured || mode == ShadeMode::TexturedCorrected)
 		{
-			leftEndPoint = temp2.GetX();
-			rightEndPoint = temp1.GetX();
+			const UVPair& uv = uvPairs[poly.GetUVIndex(i)];
+			rasterVertex.u = uv.GetU();
+			rasterVertex.v = uv.GetV();
 		}
-
-		for (int xPos = int(ceil(leftEndPoint))-1; xPos <= int(rightEndPoint)+1; xPos++)
+		rasterVertex.worldX = 0;
+		rasterVertex.worldY = 0;
+		rasterVertex.worldZ = 0;
+		rasterVertex.normalX = 0;
+		rasterVertex.normalY = 0;
+		rasterVertex.normalZ = 0;
+		if (mode == ShadeMode::Phong)
 		{
-			float scale = xPos - leftEndPoint;
-			float diff = rightEndPoint - leftEndPoint + 1;
-
-			float redTmp = (diff - scale) * red1 + scale * red2;
-			float greenTmp = (diff - scale) * green1 + scale * green2;
-			float blueTmp = (diff - scale) * blue1 + scale * blue2;
-
-			COLORREF colour = RGB(redTmp / (diff * dx1), greenTmp / (diff * dx1), blueTmp / (diff * dx1));
-
-			// Draws pixel
-			SetPixel(bitmap.GetDC(), xPos, int(temp1.GetY()), colour);
+			const VertexBuffer& worldVertices = model.GetWorldVertices();
+			rasterVertex.worldX = worldVertices.GetX()[index];
+			rasterVertex.worldY = worldVertices.GetY()[index];
+			rasterVertex.worldZ = worldVertices.GetZ()[index];
+			rasterVertex.normalX = worldVertices.GetNormalX()[index];
+			rasterVertex.normalY = worldVertices.GetNormalY()[index];
+			rasterVertex.normalZ = worldVertices.GetNormalZ()[index];
 		}
-
-		while (e1 >= 0)
-		{
-			if (changed1)
-			{
-				temp1.SetX(temp1.GetX() + signx1);
-			}
-			else
-			{
-				temp1.SetY(temp1.GetY() + signy1);
-			}
-
-			e1 = e1 - 2 * dx1;
-		}
-
-		if (changed1)
-		{
-			temp1.SetY(temp1.GetY() + signy1);
-		}
-		else
-		{
-			temp1.SetX(temp1.GetX() + signx1);
-		}
-
-		e1 = e1 + 2 * dy1;
-
-		// Here we rendered the next point on line 1 so follow now line 2
-		// Until we are on the same y-value as line 1.
-		while (temp2.GetY() != temp1.GetY())
-		{
-			while (e2 >= 0)
-			{
-				if (changed2)
-				{
-					temp2.SetX(temp2.GetX() + signx2);
-				}
-				else
-				{
-					temp2.SetY(temp2.GetY() + signy2);
-				}
-
-				e2 = e2 - 2 * dx2;
-
-				red2 += signRed2;
-				blue2 += signBlue2;
-				green2 += signGreen2;
-			}
-
-			if (changed2)
-			{
-				temp2.SetY(temp2.GetY() + signy2);
-			}
-			else
-			{
-				temp2.SetX(temp2.GetX() + signx2);
-			}
-
-			e2 = e2 + 2 * dy2;
-		}
-
-		// Increase the color values at each edge
-		red1 += deltaRed1;
-		green1 += deltaGreen1;
-		blue1 += deltaBlue1;
-
-		red2 += deltaRed2;
-		green2 += deltaGreen2;
-		blue2 += deltaBlue2;
-	}
-}
-
-// Draws model using standard algorithm (smooth shading) - used Bresenham in demo as it seems to produce a better result
-void Rasteriser::DrawGouraudStandard(const Bitmap& bitmap, Polygon3D poly)
-{
-	// Gets vertices that make up the polygon
-	std::vector<Vertex> vertices;
-	vertices.push_back(_model.GetTransformedVertices()[poly.GetIndex(0)]);
-	vertices.push_back(_model.GetTransformedVertices()[poly.GetIndex(1)]);
-	vertices.push_back(_model.GetTransformedVertices()[poly.GetIndex(2)]);
-
-	// Sorts list of vertices in ascending order of Y values using lambda function
-	std::sort(vertices.begin(), vertices.end(), [](const Vertex& a, const Vertex& b) -> bool
-	{
-		return a.GetY() < b.GetY();
-	});
-
-	Vertex v1 = vertices[0];
-	Vertex v2 = vertices[1];
-	Vertex v3 = vertices[2];
-
-	// Check for bottom flat triangle
-	if (v2.GetY() == v3.GetY())
-	{
-		FillBottomGouraud(bitmap, v1, v2, v3, v1.GetColour(), v2.GetColour(), v3.GetColour());
 	}
-	// Check for top flat triangle
-	else if (v1.GetY() == v2.GetY())
+	if (clip == 0)
 	{
-		FillTopGouraud(bitmap, v1, v2, v3, v1.GetColour(), v2.GetColour(), v3.GetColour());
-	}
-	// If not flat then split into two managable triangles
-	else
-	{
-		Vertex vTemp = Vertex(v1.GetX() + (v2.GetY() - v1.GetY()) / (v3.GetY() - v1.GetY()) * (v3.GetX() - v1.GetX()), v2.GetY());
-
-		// Get intermediate colour values
-		float cRed = GetRValue(v1.GetColour()) + ((float)(v2.GetY() - v1.GetY()) / (float)(v3.GetY() - v1.GetY())) * (GetRValue(v3.GetColour()) - GetRValue(v1.GetColour()));
-		float cGreen = GetGValue(v1.GetColour()) + ((float)(v2.GetY() - v1.GetY()) / (float)(v3.GetY() - v1.GetY())) * (GetGValue(v3.GetColour()) - GetGValue(v1.GetColour()));
-		float cBlue = GetBValue(v1.GetColour()) + ((float)(v2.GetY() - v1.GetY()) / (float)(v3.GetY() - v1.GetY())) * (GetBValue(v3.GetColour()) - GetBValue(v1.GetColour()));
-
-		COLORREF cTemp = RGB(cRed, cGreen, cBlue);
-
-		FillBottomGouraud(bitmap, v1, v2, vTemp, v1.GetColour(), v2.GetColour(), cTemp);
-		FillTopGouraud(bitmap, v2, vTemp, v3, v2.GetColour(), cTemp, v3.GetColour());
+		return 3;
 	}
+	return Clipper::ClipTriangle(rasterVertices, w, clip, output);
 }
 
-// Fills bottom flat polygon (smooth, standard) - used Bresenham in demo as it seems to produce a better result
-void Rasteriser::FillBottomGouraud(const Bitmap& bitmap, Vertex v1, Vertex v2, Vertex v3, COLORREF c1, COLORREF c2, COLORREF c3)
+// Draws a polygon into the part of the bitmap covered by a tile. Clipped polygons are drawn as a
+// fan of triangles
+void Rasteriser::DrawPolygon(const Bitmap& bitmap, const Tile& tile, const Model& model, const Polygon3D& poly, ShadeMode mode)
 {
-	float slope1 = (v2.GetX() - v1.GetX()) / (v2.GetY() - v1.GetY());
-	float slope2 = (v3.GetX() - v1.GetX()) / (v3.GetY() - v1.GetY());
-
-	float x1 = v1.GetX();
-	float x2 = v1.GetX() + 0.5f;
-
-	float v2v1Diff = v2.GetY() - v1.GetY();
-	float colourSlopeRed1 = (GetRValue(c2) - GetRValue(c1)) / v2v1Diff;
-	float colourSlopeGreen1 = (GetGValue(c2) - GetGValue(c1)) / v2v1Diff;
-	float colourSlopeBlue1 = (GetBValue(c2) - GetBValue(c1)) / v2v1Diff;
-
-	float v3v1Diff = v3.GetY() - v1.GetY();
-	float colourSlopeRed2 = (GetRValue(c3) - GetRValue(c1)) / v3v1Diff;
-	float colourSlopeGreen2 = (GetGValue(c3) - GetGValue(c1)) / v3v1Diff;
-	float colourSlopeBlue2 = (GetBValue(c3) - GetBValue(c1)) / v3v1Diff;
-
-	float cRed1 = GetRValue(c1);
-	float cGreen1 = GetGValue(c1);
-	float cBlue1 = GetBValue(c1);
-	float cRed2 = GetRValue(c1);
-	float cGreen2 = GetGValue(c1);
-	float cBlue2 = GetBValue(c1);
-
-	if (slope2 < slope1)
-	{
-		float slopeTemp = slope1;
-		slope1 = slope2;
-		slope2 = slopeTemp;
-
-		slopeTemp = colourSlopeRed1;
-		colourSlopeRed1 = colourSlopeRed2;
-		colourSlopeRed2 = slopeTemp;
-
-		slopeTemp = colourSlopeGreen1;
-		colourSlopeGreen1 = colourSlopeGreen2;
-		colourSlopeGreen2 = slopeTemp;
-
-		slopeTemp = colourSlopeBlue1;
-		colourSlopeBlue1 = colourSlopeBlue2;
-		colourSlopeBlue2 = slopeTemp;
-	}
-
-	for (int scanlineY = int(v1.GetY()); scanlineY <= v2.GetY(); scanlineY++)
+	RasterVertex rasterVertices[Clipper::MAXIMUM_VERTICES];
+	int count = ClipPolygon(model, poly, mode, rasterVertices);
+	for (int i = 1; i + 1 < count; i++)
 	{
-		for (int xPos = int(ceil(x1)); xPos <= int(x2); xPos++)
-		{
-			float t = (xPos - x1) / (x2 - x1);
-
-			int red = int((1 - t) * cRed1 + t * cRed2);
-			int green = int((1 - t) * cGreen1 + t * cGreen2);
-			int blue = int((1 - t) * cBlue1 + t * cBlue2);
-
-			// Draws pixel
-			SetPixel(bitmap.GetDC(), xPos, scanlineY, RGB(red, green, blue));
-		}
-
-		x1 += slope1;
-		x2 += slope2;
-
-		cRed1 += colourSlopeRed1;
-		cGreen1 += colourSlopeGreen1;
-		cBlue1 += colourSlopeBlue1;
-
-		cRed2 += colourSlopeRed2;
-		cGreen2 += colourSlopeGreen2;
-		cBlue2 += colourSlopeBlue2;
+		TriangleRasteriser::DrawTriangle(bitmap, tile, mode, rasterVertices[0], rasterVertices[i], rasterVertices[i + 1], &model.GetTexture(), &model.GetLighting());
 	}
 }
 
-// Fills top flat polygon (smooth, standard) - used Bresenham in demo as it seems to produce a better result
-void Rasteriser::FillTopGouraud(const Bitmap& bitmap, Vertex v1, Vertex v2, Vertex v3, COLORREF c1, COLORREF c2, COLORREF c3)
+// Gets how polygons are shaded for draw modes that are drawn by our own triangle rasteriser, which
+// clips to a tile and depth tests each pixel. Returns false for wireframes, which do not need depth
+// testing, and GDI polygons, which cannot be drawn from several threads
+bool Rasteriser::GetShadeMode(const std::string& drawMode, ShadeMode& mode)
 {
-	float slope1 = (v3.GetX() - v1.GetX()) / (v3.GetY() - v1.GetY());
-	float slope2 = (v3.GetX() - v2.GetX()) / (v3.GetY() - v2.GetY());
-
-	float x1 = v3.GetX();
-	float x2 = v3.GetX() + 0.5f;
-
-	float v3v1Diff = v3.GetY() - v1.GetY();
-	float colourSlopeRed1 = (GetRValue(c3) - GetRValue(c1)) / v3v1Diff;
-	float colourSlopeGreen1 = (GetGValue(c3) - GetGValue(c1)) / v3v1Diff;
-	float colourSlopeBlue1 = (GetBValue(c3) - GetBValue(c1)) / v3v1Diff;
-
-	float v3v2Diff = v3.GetY() - v2.GetY();
-	float colourSlopeRed2 = (GetRValue(c3) - GetRValue(c2)) / v3v2Diff;
-	float colourSlopeGreen2 = (GetGValue(c3) - GetGValue(c2)) / v3v2Diff;
-	float colourSlopeBlue2 = (GetBValue(c3) - GetBValue(c2)) / v3v2Diff;
-
-	float cRed1 = GetRValue(c3);
-	float cGreen1 = GetGValue(c3);
-	float cBlue1 = GetBValue(c3);
-	float cRed2 = GetRValue(c3);
-	float cGreen2 = GetGValue(c3);
-	float cBlue2 = GetBValue(c3);
-
-	if (slope1 < slope2)
+#ifdef RASTERISER_HEADLESS
+	if (drawMode == "Solid")
 	{
-		float slopeTemp = slope1;
-		slope1 = slope2;
-		slope2 = slopeTemp;
-
-		slopeTemp = colourSlopeRed1;
-		colourSlopeRed1 = colourSlopeRed2;
-		colourSlopeRed2 = slopeTemp;
-
-		slopeTemp = colourSlopeGreen1;
-		colourSlopeGreen1 = colourSlopeGreen2;
-		colourSlopeGreen2 = slopeTemp;
-
-		slopeTemp = colourSlopeBlue1;
-		colourSlopeBlue1 = colourSlopeBlue2;
-		colourSlopeBlue2 = slopeTemp;
+		mode = ShadeMode::Flat;
+		return true;
 	}
-
-	for (int scanlineY = int(v3.GetY()); scanlineY >= v1.GetY(); scanlineY--)
+#endif
+	if (drawMode == "MySolid")
 	{
-		for (int xPos = int(ceil(x1)); xPos <= int(x2); xPos++)
-		{
-			float t = (xPos - x1) / (x2 - x1);
-
-			int red = int((1 - t) * cRed1 + t * cRed2);
-			int green = int((1 - t) * cGreen1 + t * cGreen2);
-			int blue = int((1 - t) * cBlue1 + t * cBlue2);
-
-			// Draws pixel
-			SetPixel(bitmap.GetDC(), xPos, scanlineY, RGB(red, green, blue));
-		}
-
-		x1 -= slope1;
-		x2 -= slope2;
-
-		cRed1 -= colourSlopeRed1;
-		cGreen1 -= colourSlopeGreen1;
-		cBlue1 -= colourSlopeBlue1;
-
-		cRed2 -= colourSlopeRed2;
-		cGreen2 -= colourSlopeGreen2;
-		cBlue2 -= colourSlopeBlue2;
+		mode = ShadeMode::Flat;
+		return true;
 	}
-}
-
-// Draws model using bresenham (smooth shading & textures)
-void Rasteriser::DrawGouraudTextured(const Bitmap& bitmap, Polygon3D poly)
-{
-	Vertex v1 = _model.GetTransformedVertices()[poly.GetIndex(0)];
-	Vertex v2 = _model.GetTransformedVertices()[poly.GetIndex(1)];
-	Vertex v3 = _model.GetTransformedVertices()[poly.GetIndex(2)];
-	// Sets UV indices for vertices
-	v1.SetUVIndex(poly.GetUVIndex(0));
-	v2.SetUVIndex(poly.GetUVIndex(1));
-	v3.SetUVIndex(poly.GetUVIndex(2));
-	// Sorts list of vertices in ascending order of Y values using lambda function polygon
-	std::vector<Vertex> vertices;
-	vertices.push_back(v1);
-	vertices.push_back(v2);
-	vertices.push_back(v3);
-	std::sort(vertices.begin(), vertices.end(), [](const Vertex& a, const Vertex& b) -> bool
+	if (drawMode == "Gouraud")
 	{
-		return a.GetY() < b.GetY();
-	});
-
-	v1 = vertices[0];
-	v2 = vertices[1];
-	v3 = vertices[2];
-
-	// Get UV pairs for vertices
-	UVPair v1UV = _model.GetUVPairs()[v1.GetUVIndex()];
-	UVPair v2UV = _model.GetUVPairs()[v2.GetUVIndex()];
-	UVPair v3UV = _model.GetUVPairs()[v3.GetUVIndex()];
-
-	// Check for bottom flat triangle
-	if (v2.GetY() == v3.GetY())
+		mode = ShadeMode::Gouraud;
+		return true;
+	}
+	if (drawMode == "Textured")
 	{
-		FillGouraudTextured(bitmap, v1, v2, v3, v1.GetColour(), v2.GetColour(), v3.GetColour(), v1UV, v2UV, v3UV);
+		mode = ShadeMode::Textured;
+		return true;
 	}
-	// Check for top flat triangle
-	else if (v1.GetY() == v2.GetY())
+	if (drawMode == "TexturedCorrected")
 	{
-		FillGouraudTextured(bitmap, v3, v1, v2, v1.GetColour(), v2.GetColour(), v3.GetColour(), v1UV, v2UV, v3UV);
+		mode = ShadeMode::TexturedCorrected;
+		return true;
 	}
-	// If not flat then split into two managable triangles
-	else
+	if (drawMode == "Phong")
 	{
-		Vertex vTemp = Vertex(v1.GetX() + (v2.GetY() - v1.GetY()) / (v3.GetY() - v1.GetY()) * (v3.GetX() - v1.GetX()), v2.GetY());
-
-		// Get intermediate colour values
-		float cRed = GetRValue(v1.GetColour()) + ((v2.GetY() - v1.GetY()) / (v3.GetY() - v1.GetY())) * (GetRValue(v3.GetColour()) - GetRValue(v1.GetColour()));
-		float cGreen = GetGValue(v1.GetColour()) + ((v2.GetY() - v1.GetY()) / (v3.GetY() - v1.GetY())) * (GetGValue(v3.GetColour()) - GetGValue(v1.GetColour()));
-		float cBlue = GetBValue(v1.GetColour()) + ((v2.GetY() - v1.GetY()) / (v3.GetY() - v1.GetY())) * (GetBValue(v3.GetColour()) - GetBValue(v1.GetColour()));
-
-		COLORREF cTemp = RGB(cRed, cGreen, cBlue);
-
-		// Get intermediate UV values
-		float uvTempU = v1UV.GetU() + ((v2.GetY() - v1.GetY()) / (v3.GetY() - v1.GetY())) * v3UV.GetU() - v1UV.GetU();
-		float uvTempV = v1UV.GetV() + ((v2.GetY() - v1.GetY()) / (v3.GetY() - v1.GetY())) * v3UV.GetV() - v1UV.GetV();
-		
-		UVPair uvTemp = UVPair(uvTempU, uvTempV);
-
-		// As we have to draw each line from left to right, we have to check which point of the horizontal line has a lower x-coordinate and swap them if necessary
-		if (v2.GetX() < vTemp.GetX())
-		{
-			FillGouraudTextured(bitmap, v1, v2, vTemp, v1.GetColour(), v2.GetColour(), cTemp, v1UV, v2UV, uvTemp);
-			FillGouraudTextured(bitmap, v3, v2, vTemp, v3.GetColour(), v2.GetColour(), cTemp, v3UV, v2UV, uvTemp);
-		}
-		else
-		{
-			FillGouraudTextured(bitmap, v1, vTemp, v2, v1.GetColour(), cTemp, v2.GetColour(), v1UV, uvTemp, v2UV);
-			FillGouraudTextured(bitmap, v3, vTemp, v2, v3.GetColour(), cTemp, v2.GetColour(), v3UV, uvTemp, v2UV);
-		}
+		mode = ShadeMode::Phong;
+		return true;
 	}
+	return false;
 }
 
-// Fills polygon (smooth, bresenham & textures)
-void Rasteriser::FillGouraudTextured(const Bitmap& bitmap, Vertex v1, Vertex v2, Vertex v3, COLORREF c1, COLORREF c2, COLORREF c3, UVPair uv1, UVPair uv2, UVPair uv3)
+// Draws the model a tile at a time, spreading the tiles over the worker threads. Each tile is only
+// drawn by one thread at a time and nothing is drawn outside of it, so no locking is needed
+void Rasteriser::DrawTiled(const Bitmap& bitmap, const Model& model, ShadeMode mode)
 {
-	// Drawing the polygon using the Bresenham algorithm
-	Vertex temp1 = Vertex(v1.GetX(), v1.GetY());
-	Vertex temp2 = Vertex(v1.GetX(), v1.GetY());
-
-	bool changed1 = false;
-	bool changed2 = false;
-
-	float dx1 = abs(v2.GetX() - v1.GetX());
-	float dy1 = abs(v2.GetY() - v1.GetY());
-
-	int dRed1 = GetRValue(c2) - GetRValue(c1);
-	int dGreen1 = GetGValue(c2) - GetGValue(c1);
-	int dBlue1 = GetBValue(c2) - GetBValue(c1);
-
-	float dU1 = uv2.GetU() - uv1.GetU();
-	float dV1 = uv2.GetV() - uv1.GetV();
-
-	float dx2 = abs(v3.GetX() - v1.GetX());
-	float dy2 = abs(v3.GetY() - v1.GetY());
-
-	int dRed2 = GetRValue(c3) - GetRValue(c1);
-	int dGreen2 = GetGValue(c3) - GetGValue(c1);
-	int dBlue2 = GetBValue(c3) - GetBValue(c1);
-
-	float dU2 = uv3.GetU() - uv1.GetU();
-	float dV2 = uv3.GetV() - uv1.GetV();
-
-	int signx1 = Signum(v2.GetX() - v1.GetX());
-	int signx2 = Signum(v3.GetX() - v1.GetX());
-
-	int signy1 = Signum(v2.GetY() - v1.GetY());
-	int signy2 = Signum(v3.GetY() - v1.GetY());
-
-	int signRed2 = Signum(float(GetRValue(c3) - GetRValue(c1)));
-	int signGreen2 = Signum(float(GetGValue(c3) - GetGValue(c1)));
-	int signBlue2 = Signum(float(GetBValue(c3) - GetBValue(c1)));
-
-	int signU2 = Signum(uv3.GetU() - uv1.GetU());
-	int signV2 = Signum(uv3.GetV() - uv1.GetV());
-
-	if (dy1 > dx1)
-	{
-		float tmp = dx1;
-		dx1 = dy1;
-		dy1 = tmp;
-		changed1 = true;
-	}
-
-	if (dy2 > dx2)
-	{
-		float tmp = dx2;
-		dx2 = dy2;
-		dy2 = tmp;
-		changed2 = true;
-	}
-
-	float e1 = 2 * dy1 - dx1;
-	float e2 = 2 * dy2 - dx2;
-
-	float red1 = GetRValue(c1) * dx1;
-	float green1 = GetGValue(c1) * dx1;
-	float blue1 = GetBValue(c1) * dx1;
-
-	float U1 = uv1.GetU() * dx1;
-	float V1 = uv1.GetV() * dx1;
-
-	float red2 = GetRValue(c1) * dx1;
-	float green2 = GetGValue(c1) * dx1;
-	float blue2 = GetBValue(c1) * dx1;
-
-	float U2 = uv1.GetU() * dx1;
-	float V2 = uv1.GetV() * dx1;
-
-	int deltaRed1 = dRed1;
-	int deltaGreen1 = dGreen1;
-	int deltaBlue1 = dBlue1;
-
-	float deltaU1 = dU1;
-	float deltaV1 = dV1;
+	const std::vector<Polygon3D>& polygons = model.GetPolygons();
+	const std::vector<int>& visiblePolygons = model.GetVisiblePolygons();
+	const float* x = model.GetTransformedVertices().GetX();
+	const float* y = model.GetTransformedVertices().GetY();
+	const uint32_t* clipFlags = model.GetTransformedVertices().GetClipFlags();
 
-	int deltaRed2 = dRed2;
-	int deltaGreen2 = dGreen2;
-	int deltaBlue2 = dBlue2;
-
-	float deltaU2 = dU2;
-	float deltaV2 = dV2;
-
-	for (int i = 0; i < dx1; i++)
+	unsigned int binSetCount = _workers.GetThreadCount();
+	// With only one thread there is nothing to gain from tiles, so everything is drawn as one tile
+	if (binSetCount == 1)
 	{
-		float leftEndPoint;
-		float rightEndPoint;
-
-		if (temp1.GetX() <= temp2.GetX())
-		{
-			leftEndPoint = temp1.GetX();
-			rightEndPoint = temp2.GetX();
-		}
-		else
+		Tile tile = { 0, 0, int(bitmap.GetWidth()) - 1, int(bitmap.GetHeight()) - 1 };
+		for (int polygonIndex : visiblePolygons)
 		{
-			leftEndPoint = temp2.GetX();
-			rightEndPoint = temp1.GetX();
+			DrawPolygon(bitmap, tile, model, polygons[polygonIndex], mode);
 		}
+		return;
+	}
 
-		for (int xPos = int(ceil(leftEndPoint)) - 1; xPos <= int(rightEndPoint) + 1; xPos++)
-		{
-			float scale = xPos - leftEndPoint;
-			float diff = rightEndPoint - leftEndPoint + 1;
-
-			float redTmp = (diff - scale) * red1 + scale * red2;
-			float greenTmp = (diff - scale) * green1 + scale * green2;
-			float blueTmp = (diff - scale) * blue1 + scale * blue2;
-
-			float uTmp = (diff - scale) * U1 + scale * U2;
-			float vTmp = (diff - scale) * V1 + scale * V2;
-
-			float lightRed = redTmp / (diff * dx1);
-			float lightGreen = greenTmp / (diff * dx1);
-			float lightBlue = blueTmp / (diff * dx1);
-
-			float textureU = uTmp / (diff * dx1);
-			float textureV = vTmp / (diff * dx1);
-
-			// Getting RGB value of texture using interpolated U and V values
-			COLORREF textureColour = _model.GetTexture().GetTextureValue(int(textureU), int(textureV));
-
-			// Multiplies texture colours by light multipliers
-			float finalRed = GetRValue(textureColour) * (lightRed / 255);
-			float finalGreen = GetGValue(textureColour) * (lightGreen / 255);
-			float finalBlue = GetBValue(textureColour) * (lightBlue / 255);
-
-			// Clamps colour between 0 and 255
-			COLORREF colour = RGB(Clamp(finalRed, 0, 255), Clamp(finalGreen, 0, 255), Clamp(finalBlue, 0, 255));
-
-			// Draws pixel
-			SetPixel(bitmap.GetDC(), xPos, int(temp1.GetY()), colour);
-		}
+	_binner.Resize(int(bitmap.GetWidth()), int(bitmap.GetHeight()), binSetCount);
+	_binner.Clear();
 
-		while (e1 >= 0)
+	// Each bin set gets a consecutive range of the visible polygons so that the order the
+	// polygons are drawn in does not change
+	size_t polygonCount = visiblePolygons.size();
+	_workers.ParallelFor(binSetCount, [&](size_t binSet)
+	{
+		size_t first = polygonCount * binSet / binSetCount;
+		size_t last = polygonCount * (binSet + 1) / binSetCount;
+		for (size_t i = first; i < last; i++)
 		{
-			if (changed1)
+			int polygonIndex = visiblePolygons[i];
+			const Polygon3D& poly = polygons[polygonIndex];
+			int i0 = poly.GetIndex(0);
+			int i1 = poly.GetIndex(1);
+			int i2 = poly.GetIndex(2);
+			if ((clipFlags[i0] & clipFlags[i1] & clipFlags[i2]) != 0)
 			{
-				temp1.SetX(temp1.GetX() + signx1);
+				continue;
 			}
-			else
+			// Vertices in front of the near plane have no screen position, so polygons using them
+			// are binned to every tile and clipped when they are drawn
+			if (((clipFlags[i0] | clipFlags[i1] | clipFlags[i2]) & CLIP_NEAR) != 0)
 			{
-				temp1.SetY(temp1.GetY() + signy1);
+				_binner.Bin(static_cast<unsigned int>(binSet), polygonIndex, 0, 0, float(bitmap.GetWidth()), float(bitmap.GetHeight()));
+				continue;
 			}
-
-			e1 = e1 - 2 * dx1;
-		}
-
-		if (changed1)
-		{
-			temp1.SetY(temp1.GetY() + signy1);
-		}
-		else
-		{
-			temp1.SetX(temp1.GetX() + signx1);
+			float minX = std::min(x[i0], std::min(x[i1], x[i2]));
+			float minY = std::min(y[i0], std::min(y[i1], y[i2]));
+			float maxX = std::max(x[i0], std::max(x[i1], x[i2]));
+			float maxY = std::max(y[i0], std::max(y[i1], y[i2]));
+			_binner.Bin(static_cast<unsigned int>(binSet), polygonIndex, minX, minY, maxX, maxY);
 		}
+	});
 
-		e1 = e1 + 2 * dy1;
-
-		while (temp2.GetY() != temp1.GetY())
+	_workers.ParallelFor(_binner.GetTileCount(), [&](size_t tileIndex)
+	{
+		const Tile& tile = _binner.GetTile(tileIndex);
+		for (unsigned int binSet = 0; binSet < binSetCount; binSet++)
 		{
-			while (e2 >= 0)
-			{
-				if (changed2)
-				{
-					temp2.SetX(temp2.GetX() + signx2);
-				}
-				else
-				{
-					temp2.SetY(temp2.GetY() + signy2);
-				}
-
-				e2 = e2 - 2 * dx2;
-
-				red2 += signRed2;
-				blue2 += signBlue2;
-				green2 += signGreen2;
-				U2 += signU2;
-				V2 += signV2;
-			}
-
-			if (changed2)
-			{
-				temp2.SetY(temp2.GetY() + signy2);
-			}
-			else
+			for (int polygonIndex : _binner.GetBin(binSet, tileIndex))
 			{
-				temp2.SetX(temp2.GetX() + signx2);
+				DrawPolygon(bitmap, tile, model, polygons[polygonIndex], mode);
 			}
-
-			e2 = e2 + 2 * dy2;
 		}
-
-		red1 += deltaRed1;
-		green1 += deltaGreen1;
-		blue1 += deltaBlue1;
-		U1 += deltaU1;
-		V1 += deltaV1;
-
-		red2 += deltaRed2;
-		green2 += deltaGreen2;
-		blue2 += deltaBlue2;
-		U2 += deltaU2;
-		V2 += deltaV2;
-	}
+	});
 }
 
-// The following 5 functions draw corrected textures, attempted with standard and bresenham algorithm but can't get either to work
-// Bresenham version is shown at the end of the demo. Code left to show what I have attempted as it looks correct to me and Wayne said he could't see an obvious issue
-void Rasteriser::DrawTexturedCorrectedBresenham(const Bitmap& bitmap, Polygon3D poly)
+// First half of the rendering pipeline, which poses the model and applies the required
+// transformations into the next prepared frame. Nothing here draws on the bitmap, so the next
+// frame can be prepared while Render draws the last one
+void Rasteriser::Prepare(const Bitmap& bitmap)
 {
-	Vertex v1 = _model.GetTransformedVertices()[poly.GetIndex(0)];
-	Vertex v2 = _model.GetTransformedVertices()[poly.GetIndex(1)];
-	Vertex v3 = _model.GetTransformedVertices()[poly.GetIndex(2)];
-	// Sets UV indices for vertices
-	v1.SetUVIndex(poly.GetUVIndex(0));
-	v2.SetUVIndex(poly.GetUVIndex(1));
-	v3.SetUVIndex(poly.GetUVIndex(2));
-	// Sorts list of vertices in ascending order of Y values using lambda function polygon
-	std::vector<Vertex> vertices;
-	vertices.push_back(v1);
-	vertices.push_back(v2);
-	vertices.push_back(v3);
-	std::sort(vertices.begin(), vertices.end(), [](const Vertex& a, const Vertex& b) -> bool
-	{
-		return a.GetY() < b.GetY();
-	});
-
-	v1 = vertices[0];
-	v2 = vertices[1];
-	v3 = vertices[2];
-
-	// Get UV pairs for vertices
-	UVPair v1UV = _model.GetUVPairs()[v1.GetUVIndex()];
-	UVPair v2UV = _model.GetUVPairs()[v2.GetUVIndex()];
-	UVPair v3UV = _model.GetUVPairs()[v3.GetUVIndex()];
-
-	// Set UOverZ, VoverZ and ZRecip for UV pairs
-	v1UV.SetUOverZ(v1UV.GetU() / v1.GetPreTransformZ());
-	v1UV.SetVOverZ(v1UV.GetV() / v1.GetPreTransformZ());
-	v1UV.SetZRecip(1 / v1.GetPreTransformZ());
-
-	v2UV.SetUOverZ(v2UV.GetU() / v2.GetPreTransformZ());
-	v2UV.SetVOverZ(v2UV.GetV() / v2.GetPreTransformZ());
-	v2UV.SetZRecip(1 / v2.GetPreTransformZ());
-
-	v3UV.SetUOverZ(v3UV.GetU() / v3.GetPreTransformZ());
-	v3UV.SetVOverZ(v3UV.GetV() / v3.GetPreTransformZ());
-	v3UV.SetZRecip(1 / v3.GetPreTransformZ());
-
-	// Check for bottom flat triangle
-	if (v2.GetY() == v3.GetY())
-	{
-		FillTexturedCorrected(bitmap, v1, v2, v3, v1.GetColour(), v2.GetColour(), v3.GetColour(), v1UV, v2UV, v3UV);
-	}
-	// Check for top flat triangle
-	else if (v1.GetY() == v2.GetY())
-	{
-		FillTexturedCorrected(bitmap, v3, v1, v2, v1.GetColour(), v2.GetColour(), v3.GetColour(), v1UV, v2UV, v3UV);
-	}
-	// If not flat then split into two managable triangles
-	else
-	{
-		Vertex vTemp = Vertex(v1.GetX() + (v2.GetY() - v1.GetY()) / (v3.GetY() - v1.GetY()) * (v3.GetX() - v1.GetX()), v2.GetY());
-
-		// Get intermediate colour values
-		float cRed = GetRValue(v1.GetColour()) + ((v2.GetY() - v1.GetY()) / (v3.GetY() - v1.GetY())) * (GetRValue(v3.GetColour()) - GetRValue(v1.GetColour()));
-		float cGreen = GetGValue(v1.GetColour()) + ((v2.GetY() - v1.GetY()) / (v3.GetY() - v1.GetY())) * (GetGValue(v3.GetColour()) - GetGValue(v1.GetColour()));
-		float cBlue = GetBValue(v1.GetColour()) + ((v2.GetY() - v1.GetY()) / (v3.GetY() - v1.GetY())) * (GetBValue(v3.GetColour()) - GetBValue(v1.GetColour()));
-
-		COLORREF cTemp = RGB(cRed, cGreen, cBlue);
-
-		// Get intermediate UV values
-		float uvTempU = v1UV.GetU() + ((v2.GetY() - v1.GetY()) / (v3.GetY() - v1.GetY())) * v3UV.GetU() - v1UV.GetU();
-		float uvTempV = v1UV.GetV() + ((v2.GetY() - v1.GetY()) / (v3.GetY() - v1.GetY())) * v3UV.GetV() - v1UV.GetV();
-
-		UVPair uvTemp = UVPair(uvTempU, uvTempV);
-
-		// Get intermediate z value
-		float zTemp = v1.GetPreTransformZ() + ((v2.GetPreTransformZ() - v1.GetPreTransformZ()) / (v3.GetPreTransformZ() - v1.GetPreTransformZ())) * v3.GetPreTransformZ() - v1.GetPreTransformZ();
-		// Set UOverZ, VOverZ and ZRecip for the temp UV pair
-		uvTemp.SetUOverZ(uvTempU / zTemp);
-		uvTemp.SetVOverZ(uvTempV / zTemp);
-		uvTemp.SetZRecip(1 / zTemp);
-
-		// As we have to draw each line from left to right, we have to check which point of the horizontal line has a lower x-coordinate and swap them if necessary
-		if (v2.GetX() < vTemp.GetX())
-		{
-			FillTexturedCorrected(bitmap, v1, v2, vTemp, v1.GetColour(), v2.GetColour(), cTemp, v1UV, v2UV, uvTemp);
-			FillTexturedCorrected(bitmap, v3, v2, vTemp, v3.GetColour(), v2.GetColour(), cTemp, v3UV, v2UV, uvTemp);
-		}
-		else
-		{
-			FillTexturedCorrected(bitmap, v1, vTemp, v2, v1.GetColour(), cTemp, v2.GetColour(), v1UV, uvTemp, v2UV);
-			FillTexturedCorrected(bitmap, v3, vTemp, v2, v3.GetColour(), cTemp, v2.GetColour(), v3UV, uvTemp, v2UV);
-		}
-	}
+	PreparedFrame& frame = _frames[_preparedFrames % FRAME_SLOTS];
+	frame.width = bitmap.GetWidth();
+	frame.height = bitmap.GetHeight();
+
+	// Gets stage and draw mode from demo class
+	frame.stage = _demo.GetStage();
+	frame.drawMode = _demo.GetDrawMode();
+	frame.tiled = GetShadeMode(frame.drawMode, frame.shadeMode);
+	// Polygons drawn by our own triangle rasteriser are depth tested per pixel, so only polygons
+	// drawn in another way need to be sorted so that those further from the camera are drawn first
+	frame.depthTest = bitmap.HasDepthBuffer() && frame.tiled;
+
+	// Nothing more is done if the whole model is outside the view
+	frame.modelVisible = PoseModel(bitmap, _drawPose, frame.model);
+	if (frame.modelVisible)
+	{
+		PrepareModel(bitmap, frame);
+	}
+	// Hands the frame over to Render, which may be running on another thread
+	_preparedFrames++;
 }
 
-void Rasteriser::FillTexturedCorrected(const Bitmap& bitmap, Vertex v1, Vertex v2, Vertex v3, COLORREF c1, COLORREF c2, COLORREF c3, UVPair uv1, UVPair uv2, UVPair uv3)
+void Rasteriser::PrepareModel(const Bitmap& bitmap, PreparedFrame& frame)
 {
-	// Drawing the polygon using the Bresenham algorithm
-	Vertex temp1 = Vertex(v1.GetX(), v1.GetY());
-	Vertex temp2 = Vertex(v1.GetX(), v1.GetY());
-
-	bool changed1 = false;
-	bool changed2 = false;
-
-	float dx1 = abs(v2.GetX() - v1.GetX());
-	float dy1 = abs(v2.GetY() - v1.GetY());
-
-	int dRed1 = GetRValue(c2) - GetRValue(c1);
-	int dGreen1 = GetGValue(c2) - GetGValue(c1);
-	int dBlue1 = GetBValue(c2) - GetBValue(c1);
-
-	float dUoverZ1 = uv2.GetUOverZ() - uv1.GetUOverZ();
-	float dVoverZ1 = uv2.GetVOverZ() - uv1.GetVOverZ();
-	float dZRecip1 = uv2.GetZRecip() - uv1.GetZRecip();
-
-	float dx2 = abs(v3.GetX() - v1.GetX());
-	float dy2 = abs(v3.GetY() - v1.GetY());
-
-	int dRed2 = GetRValue(c3) - GetRValue(c1);
-	int dGreen2 = GetGValue(c3) - GetGValue(c1);
-	int dBlue2 = GetBValue(c3) - GetBValue(c1);
-
-	float dUoverZ2 = uv3.GetUOverZ() - uv1.GetUOverZ();
-	float dVoverZ2 = uv3.GetVOverZ() - uv1.GetVOverZ();
-	float dZRecip2 = uv3.GetZRecip() - uv1.GetZRecip();
-
-	int signx1 = Signum(v2.GetX() - v1.GetX());
-	int signx2 = Signum(v3.GetX() - v1.GetX());
-
-	int signy1 = Signum(v2.GetY() - v1.GetY());
-	int signy2 = Signum(v3.GetY() - v1.GetY());
-
-	int signRed2 = Signum(float(GetRValue(c3) - GetRValue(c1)));
-	int signGreen2 = Signum(float(GetGValue(c3) - GetGValue(c1)));
-	int signBlue2 = Signum(float(GetBValue(c3) - GetBValue(c1)));
-
-	int signUoverZ2 = Signum(uv3.GetUOverZ() - uv1.GetUOverZ());
-	int signVoverZ2 = Signum(uv3.GetVOverZ() - uv1.GetVOverZ());
-	int signZRecip2 = Signum(uv3.GetZRecip() - uv1.GetZRecip());
+	Model& model = frame.model;
+	int windowWidth = bitmap.GetWidth();
+	int windowHeight = bitmap.GetHeight();
 
-	if (dy1 > dx1)
+	// Culls the parts of the model outside the view, which also clears the culling of every
+	// other polygon
 	{
-		float tmp = dx1;
-		dx1 = dy1;
-		dy1 = tmp;
-		changed1 = true;
+		PROFILE_SCOPE(ProfileStage::Cull);
+		model.CullClusters(_frustum, _transforms.GetTop());
 	}
 
-	if (dy2 > dx2)
+	// Calculates backfaces and marks polygons for culling (if at that stage in demo)
+	if (_demo.GetBackface())
+	{	
+		PROFILE_SCOPE(ProfileStage::Backface);
+		model.CalculateBackfaces(_camera);
+	}
+	// Everything after this only works on the polygons that are left, and the vertices they use
 	{
-		float tmp = dx2;
-		dx2 = dy2;
-		dy2 = tmp;
-		changed2 = true;
+		PROFILE_SCOPE(ProfileStage::Cull);
+		model.CollectVisiblePolygons();
 	}
 
-	float e1 = 2 * dy1 - dx1;
-	float e2 = 2 * dy2 - dx2;
-
-	float red1 = GetRValue(c1) * dx1;
-	float green1 = GetGValue(c1) * dx1;
-	float blue1 = GetBValue(c1) * dx1;
-
-	float uOverZ1 = uv1.GetUOverZ() * dx1;
-	float vOverZ1 = uv1.GetVOverZ() * dx1;
-	float zRecip1 = uv1.GetZRecip() * dx1;
-
-	float red2 = GetRValue(c1) * dx1;
-	float green2 = GetGValue(c1) * dx1;
-	float blue2 = GetBValue(c1) * dx1;
-
-	float uOverZ2 = uv1.GetUOverZ() * dx1;
-	float vOverZ2 = uv1.GetVOverZ() * dx1;
-	float zRecip2 = uv1.GetZRecip() * dx1;
-
-	int deltaRed1 = dRed1;
-	int deltaGreen1 = dGreen1;
-	int deltaBlue1 = dBlue1;
-
-	float deltaUOverZ1 = dUoverZ1;
-	float deltaVOverZ1 = dVoverZ1;
-	float deltaZRecip1 = dZRecip1;
-
-	int deltaRed2 = dRed2;
-	int deltaGreen2 = dGreen2;
-	int deltaBlue2 = dBlue2;
-
-	float deltaUOverZ2 = dUoverZ2;
-	float deltaVOverZ2 = dVoverZ2;
-	float deltaZRecip2 = dZRecip2;
-
-	for (int i = 0; i <= dx1; i++)
+	// Calculates flat lighting
+	if (!_demo.GetSmoothShading())
 	{
-		float leftEndPoint;
-		float rightEndPoint;
-
-		if (temp1.GetX() < temp2.GetX())
-		{
-			leftEndPoint = temp1.GetX();
-			rightEndPoint = temp2.GetX();
-		}
-		else
-		{
-			leftEndPoint = temp2.GetX();
-			rightEndPoint = temp1.GetX();
-		}
-
-		for (int xPos = int(ceil(leftEndPoint)) - 1; xPos <= int(rightEndPoint) + 1; xPos++)
-		{
-			float scale = xPos - leftEndPoint;
-			float diff = rightEndPoint - leftEndPoint + 1;
-
-			float redTmp = (diff - scale) * red1 + scale * red2;
-			float greenTmp = (diff - scale) * green1 + scale * green2;
-			float blueTmp = (diff - scale) * blue1 + scale * blue2;
-
-			float uOverZTmp = (diff - scale) * uOverZ1 + scale * uOverZ2;
-			float vOverZTmp = (diff - scale) * vOverZ1 + scale * vOverZ2;
-			float zRecipTmp = (diff - scale) * zRecip1 + scale * zRecip2;
-
-			float lightRed = redTmp / (diff * dx1);
-			float lightGreen = greenTmp / (diff * dx1);
-			float lightBlue = blueTmp / (diff * dx1);
-
-			float textureUOverZ = uOverZTmp / (diff * dx1);
-			float textureVOverZ = vOverZTmp / (diff * dx1);
-			float textureZRecip = zRecipTmp / (diff * dx1);
-
-			// Gets texture colour using interpolated UOverZ, VOverZ and ZRecip values
-			COLORREF textureColour = _model.GetTexture().GetTextureValue(int(textureUOverZ / textureZRecip), int(textureVOverZ / textureZRecip));
-
-			// Applies lighting to the texture colour
-			float finalRed = GetRValue(textureColour) * (lightRed / 255);
-			float finalGreen = GetGValue(textureColour) * (lightGreen / 255);
-			float finalBlue = GetBValue(textureColour) * (lightBlue / 255);
-
-			// Clamps the final colour between 0 and 255
-			COLORREF colour = RGB(Clamp(finalRed, 0, 255), Clamp(finalGreen, 0, 255), Clamp(finalBlue, 0, 255));
-
-			// Draws pixel
-			SetPixel(bitmap.GetDC(), xPos, int(temp1.GetY()), colour);
-		}
-
-		while (e1 >= 0)
-		{
-			if (changed1)
-			{
-				temp1.SetX(temp1.GetX() + signx1);
-			}
-			else
-			{
-				temp1.SetY(temp1.GetY() + signy1);
-			}
-
-			e1 = e1 - 2 * dx1;
-		}
-
-		if (changed1)
-		{
-			temp1.SetY(temp1.GetY() + signy1);
-		}
-		else
+		// Applies ambient lighting to the model
 		{
-			temp1.SetX(temp1.GetX() + signx1);
+			PROFILE_SCOPE(ProfileStage::LightingAmbient);
+			model.CalculateFlatLightingAmbient(_demo.GetAmbientLight());
 		}
 
-		e1 = e1 + 2 * dy1;
-
-		while (temp2.GetY() != temp1.GetY())
+		// Applies directional lighting to the model
 		{
-			while (e2 >= 0)
-			{
-				if (changed2)
-				{
-					temp2.SetX(temp2.GetX() + signx2);
-				}
-				else
-				{
-					temp2.SetY(temp2.GetY() + signy2);
-				}
-
-				e2 = e2 - 2 * dx2;
-
-				red2 += signRed2;
-				blue2 += signBlue2;
-				green2 += signGreen2;
-				uOverZ2 += signUoverZ2;
-				vOverZ2 += signVoverZ2;
-				zRecip2 += signZRecip2;
-			}
-
-			if (changed2)
-			{
-				temp2.SetY(temp2.GetY() + signy2);
-			}
-			else
-			{
-				temp2.SetX(temp2.GetX() + signx2);
-			}
-
-			e2 = e2 + 2 * dy2;
+			PROFILE_SCOPE(ProfileStage::LightingDirectional);
+			model.CalculateFlatLightingDirectional(_demo.GetDirectionalLights());
 		}
 
-		red1 += deltaRed1;
-		green1 += deltaGreen1;
-		blue1 += deltaBlue1;
-		uOverZ1 += deltaUOverZ1;
-		vOverZ1 += deltaVOverZ1;
-		zRecip1 += deltaZRecip1;
-
-		red2 += deltaRed2;
-		green2 += deltaGreen2;
-		blue2 += deltaBlue2;
-		uOverZ2 += deltaUOverZ2;
-		vOverZ2 += deltaVOverZ2;
-		zRecip2 += deltaZRecip2;
-	}
-}
-
-void Rasteriser::DrawTexturedCorrectedStandard(const Bitmap& bitmap, Polygon3D poly)
-{
-	Vertex v1 = _model.GetTransformedVertices()[poly.GetIndex(0)];
-	Vertex v2 = _model.GetTransformedVertices()[poly.GetIndex(1)];
-	Vertex v3 = _model.GetTransformedVertices()[poly.GetIndex(2)];
-	// Sets UV indices for vertices
-	v1.SetUVIndex(poly.GetUVIndex(0));
-	v2.SetUVIndex(poly.GetUVIndex(1));
-	v3.SetUVIndex(poly.GetUVIndex(2));
-	// Sorts list of vertices in ascending order of Y values using lambda function polygon
-	std::vector<Vertex> vertices;
-	vertices.push_back(v1);
-	vertices.push_back(v2);
-	vertices.push_back(v3);
-	std::sort(vertices.begin(), vertices.end(), [](const Vertex& a, const Vertex& b) -> bool
-	{
-		return a.GetY() < b.GetY();
-	});
-
-	v1 = vertices[0];
-	v2 = vertices[1];
-	v3 = vertices[2];
-
-	v1 = vertices[0];
-	v2 = vertices[1];
-	v3 = vertices[2];
-
-	// Get UV pairs for vertices
-	UVPair v1UV = _model.GetUVPairs()[v1.GetUVIndex()];
-	UVPair v2UV = _model.GetUVPairs()[v2.GetUVIndex()];
-	UVPair v3UV = _model.GetUVPairs()[v3.GetUVIndex()];
-
-	// Set UOverZ, VoverZ and ZRecip for UV pairs
-	v1UV.SetUOverZ(v1UV.GetU() / v1.GetPreTransformZ());
-	v1UV.SetVOverZ(v1UV.GetV() / v1.GetPreTransformZ());
-	v1UV.SetZRecip(1 / v1.GetPreTransformZ());
-
-	v2UV.SetUOverZ(v2UV.GetU() / v2.GetPreTransformZ());
-	v2UV.SetVOverZ(v2UV.GetV() / v2.GetPreTransformZ());
-	v2UV.SetZRecip(1 / v2.GetPreTransformZ());
-
-	v3UV.SetUOverZ(v3UV.GetU() / v3.GetPreTransformZ());
-	v3UV.SetVOverZ(v3UV.GetV() / v3.GetPreTransformZ());
-	v3UV.SetZRecip(1 / v3.GetPreTransformZ());
-
-	// Check for bottom flat triangle
-	if (v2.GetY() == v3.GetY())
-	{
-		FillBottomTextured(bitmap, v1, v2, v3, v1.GetColour(), v2.GetColour(), v3.GetColour(), v1UV, v2UV, v3UV);
+		// Applies point lighting to the model
+		PROFILE_SCOPE(ProfileStage::LightingPoint);
+		model.CalculateFlatLightingPoint(_demo.GetPointLights());
 	}
-	// Check for top flat triangle
-	else if (v1.GetY() == v2.GetY())
+	else if (frame.tiled && frame.shadeMode == ShadeMode::Phong)
 	{
-		FillTopTextured(bitmap, v1, v2, v3, v1.GetColour(), v2.GetColour(), v3.GetColour(), v1UV, v2UV, v3UV);
+		// Lighting is worked out for each pixel as the polygons are drawn, from the normals and
+		// positions before projection
+		{
+			PROFILE_SCOPE(ProfileStage::Normals);
+			model.TransformNormals(_transforms.GetTop());
+		}
+		PROFILE_SCOPE(ProfileStage::LightingPixel);
+		model.CalculatePixelLighting(_demo.GetAmbientLight(), _demo.GetDirectionalLights(), _demo.GetPointLights(), _demo.GetSpotLights(), _camera, _demo.GetSpecular());
 	}
-	// If not flat then split into two managable triangles
 	else
 	{
-		Vertex vTemp = Vertex(v1.GetX() + (v2.GetY() - v1.GetY()) / (v3.GetY() - v1.GetY()) * (v3.GetX() - v1.GetX()), v2.GetY());
-
-		// Get intermediate colour values
-		float cRed = GetRValue(v1.GetColour()) + ((float)(v2.GetY() - v1.GetY()) / (float)(v3.GetY() - v1.GetY())) * (GetRValue(v3.GetColour()) - GetRValue(v1.GetColour()));
-		float cGreen = GetGValue(v1.GetColour()) + ((float)(v2.GetY() - v1.GetY()) / (float)(v3.GetY() - v1.GetY())) * (GetGValue(v3.GetColour()) - GetGValue(v1.GetColour()));
-		float cBlue = GetBValue(v1.GetColour()) + ((float)(v2.GetY() - v1.GetY()) / (float)(v3.GetY() - v1.GetY())) * (GetBValue(v3.GetColour()) - GetBValue(v1.GetColour()));
-
-		COLORREF cTemp = RGB(cRed, cGreen, cBlue);
-
-		// Get intermediate UV values
-		float uvTempU = v1UV.GetU() + ((v2.GetY() - v1.GetY()) / (v3.GetY() - v1.GetY())) * v3UV.GetU() - v1UV.GetU();
-		float uvTempV = v1UV.GetV() + ((v2.GetY() - v1.GetY()) / (v3.GetY() - v1.GetY())) * v3UV.GetV() - v1UV.GetV();
-
-		UVPair uvTemp = UVPair(uvTempU, uvTempV);
-
-		// Get intermediate z value
-		float zTemp = v1.GetPreTransformZ() + ((v2.GetPreTransformZ() - v1.GetPreTransformZ()) / (v3.GetPreTransformZ() - v1.GetPreTransformZ())) * v3.GetPreTransformZ() - v1.GetPreTransformZ();
-		// Set UOverZ, VOverZ and ZRecip for the temp UV pair
-		uvTemp.SetUOverZ(uvTempU / zTemp);
-		uvTemp.SetVOverZ(uvTempV / zTemp);
-		uvTemp.SetZRecip(1 / zTemp);
-
-		FillBottomTextured(bitmap, v1, v2, vTemp, v1.GetColour(), v2.GetColour(), cTemp, v1UV, v2UV, uvTemp);
-		FillTopTextured(bitmap, v2, vTemp, v3, v2.GetColour(), cTemp, v3.GetColour(), v2UV, uvTemp, v3UV);
-	}
-}
-
-void Rasteriser::FillBottomTextured(const Bitmap& bitmap, Vertex v1, Vertex v2, Vertex v3, COLORREF c1, COLORREF c2, COLORREF c3, UVPair uv1, UVPair uv2, UVPair uv3)
-{
-	float slope1 = (v2.GetX() - v1.GetX()) / (v2.GetY() - v1.GetY());
-	float slope2 = (v3.GetX() - v1.GetX()) / (v3.GetY() - v1.GetY());
-
-	float x1 = v1.GetX();
-	float x2 = v1.GetX() + 0.5f;
-
-	float v2v1Diff = v2.GetY() - v1.GetY();
-	float colourSlopeRed1 = (GetRValue(c2) - GetRValue(c1)) / v2v1Diff;
-	float colourSlopeGreen1 = (GetGValue(c2) - GetGValue(c1)) / v2v1Diff;
-	float colourSlopeBlue1 = (GetBValue(c2) - GetBValue(c1)) / v2v1Diff;
-	float uOverZSlope1 = (uv2.GetU() - uv1.GetU()) / v2v1Diff;
-	float vOverZSlope1 = (uv2.GetV() - uv1.GetV()) / v2v1Diff;
-	float zRecipSlope1 = (uv2.GetZRecip() - uv1.GetZRecip()) / v2v1Diff;
-
-	float v3v1Diff = v3.GetY() - v1.GetY();
-	float colourSlopeRed2 = (GetRValue(c3) - GetRValue(c1)) / v3v1Diff;
-	float colourSlopeGreen2 = (GetGValue(c3) - GetGValue(c1)) / v3v1Diff;
-	float colourSlopeBlue2 = (GetBValue(c3) - GetBValue(c1)) / v3v1Diff;
-	float uOverZSlope2 = (uv3.GetU() - uv1.GetU()) / v3v1Diff;
-	float vOverZSlope2 = (uv3.GetV() - uv1.GetV()) / v3v1Diff;
-	float zRecipSlope2 = (uv3.GetZRecip() - uv1.GetZRecip()) / v3v1Diff;
-
-	float cRed1 = GetRValue(c1);
-	float cGreen1 = GetGValue(c1);
-	float cBlue1 = GetBValue(c1);
-	float cUOverZ1 = uv1.GetU();
-	float cVOverZ1 = uv1.GetV();
-	float cZRecip1 = uv1.GetZRecip();
-
-	float cRed2 = GetRValue(c1);
-	float cGreen2 = GetGValue(c1);
-	float cBlue2 = GetBValue(c1);
-	float cUOverZ2 = uv1.GetU();
-	float cVOverZ2 = uv1.GetV();
-	float cZRecip2 = uv1.GetZRecip();
-
-	if (slope2 < slope1)
-	{
-		float slopeTemp = slope1;
-		slope1 = slope2;
-		slope2 = slopeTemp;
-
-		slopeTemp = colourSlopeRed1;
-		colourSlopeRed1 = colourSlopeRed2;
-		colourSlopeRed2 = slopeTemp;
-
-		slopeTemp = colourSlopeGreen1;
-		colourSlopeGreen1 = colourSlopeGreen2;
-		colourSlopeGreen2 = slopeTemp;
-
-		slopeTemp = colourSlopeBlue1;
-		colourSlopeBlue1 = colourSlopeBlue2;
-		colourSlopeBlue2 = slopeTemp;
-
-		slopeTemp = uOverZSlope1;
-		uOverZSlope1 = uOverZSlope2;
-		uOverZSlope2 = slopeTemp;
-
-		slopeTemp = vOverZSlope1;
-		vOverZSlope1 = vOverZSlope2;
-		vOverZSlope2 = slopeTemp;
-
-		slopeTemp = zRecipSlope1;
-		zRecipSlope1 = zRecipSlope2;
-		zRecipSlope2 = slopeTemp;
-	}
-
-	for (int scanlineY = int(v1.GetY()); scanlineY <= v2.GetY(); scanlineY++)
-	{
-		for (int xPos = int(ceil(x1)); xPos <= int(x2); xPos++)
+		// Transforms the vertex normals by the model transformation left on the stack by PoseModel
 		{
-			float t = (xPos - x1) / (x2 - x1);
-
-			int red = int((1 - t) * cRed1 + t * cRed2);
-			int green = int((1 - t) * cGreen1 + t * cGreen2);
-			int blue = int((1 - t) * cBlue1 + t * cBlue2);
-			float uOverZ = (1 - t) * cUOverZ1 + t * cUOverZ2;
-			float vOverZ = (1 - t) * cVOverZ1 + t * cVOverZ2;
-			float zRecip = (1 - t) * cZRecip1 + t * cZRecip2;
-
-			COLORREF textureColour = _model.GetTexture().GetTextureValue(int(uOverZ / zRecip), int(vOverZ / zRecip));
-
-			float finalRed = float(GetRValue(textureColour) * (red / 255));
-			float finalGreen = float(GetGValue(textureColour) * (green / 255));
-			float finalBlue = float(GetBValue(textureColour) * (blue / 255));
-
-			COLORREF colour = RGB(Clamp(finalRed, 0, 255), Clamp(finalGreen, 0, 255), Clamp(finalBlue, 0, 255));
-
-			// Draws pixel
-			SetPixel(bitmap.GetDC(), xPos, scanlineY, colour);
+			PROFILE_SCOPE(ProfileStage::Normals);
+			model.TransformNormals(_transforms.GetTop());
 		}
-
-		x1 += slope1;
-		x2 += slope2;
-
-		cRed1 += colourSlopeRed1;
-		cGreen1 += colourSlopeGreen1;
-		cBlue1 += colourSlopeBlue1;
-		cUOverZ1 += uOverZSlope1;
-		cVOverZ1 += vOverZSlope1;
-		cZRecip1 += zRecipSlope1;
-
-		cRed2 += colourSlopeRed2;
-		cGreen2 += colourSlopeGreen2;
-		cBlue2 += colourSlopeBlue2;
-		cUOverZ2 += uOverZSlope2;
-		cVOverZ2 += vOverZSlope2;
-		cZRecip2 += zRecipSlope2;
+		// Applies ambient, directional and point lighting to the model, along with specular
+		// highlights and spot lights if the demo is at that stage
+		PROFILE_SCOPE(ProfileStage::LightingSmooth);
+		model.CalculateSmoothLighting(_demo.GetAmbientLight(), _demo.GetDirectionalLights(), _demo.GetPointLights(), _demo.GetSpotLights(), _camera, _demo.GetSpecular());
 	}
-}
 
-void Rasteriser::FillTopTextured(const Bitmap& bitmap, Vertex v1, Vertex v2, Vertex v3, COLORREF c1, COLORREF c2, COLORREF c3, UVPair uv1, UVPair uv2, UVPair uv3)
-{
-	float slope1 = (v3.GetX() - v1.GetX()) / (v3.GetY() - v1.GetY());
-	float slope2 = (v3.GetX() - v2.GetX()) / (v3.GetY() - v2.GetY());
-
-	float x1 = v3.GetX();
-	float x2 = v3.GetX() + 0.5f;
-
-	float v3v1Diff = v3.GetY() - v1.GetY();
-	float colourSlopeRed1 = (GetRValue(c3) - GetRValue(c1)) / v3v1Diff;
-	float colourSlopeGreen1 = (GetGValue(c3) - GetGValue(c1)) / v3v1Diff;
-	float colourSlopeBlue1 = (GetBValue(c3) - GetBValue(c1)) / v3v1Diff;
-	float uOverZSlope1 = (uv3.GetU() - uv1.GetU()) / v3v1Diff;
-	float vOverZSlope1 = (uv3.GetV() - uv1.GetV()) / v3v1Diff;
-	float zRecipSlope1 = (uv3.GetZRecip() - uv1.GetZRecip()) / v3v1Diff;
-
-	float v3v2Diff = v3.GetY() - v2.GetY();
-	float colourSlopeRed2 = (GetRValue(c3) - GetRValue(c2)) / v3v2Diff;
-	float colourSlopeGreen2 = (GetGValue(c3) - GetGValue(c2)) / v3v2Diff;
-	float colourSlopeBlue2 = (GetBValue(c3) - GetBValue(c2)) / v3v2Diff;
-	float uOverZSlope2 = (uv3.GetU() - uv2.GetU()) / v3v2Diff;
-	float vOverZSlope2 = (uv3.GetV() - uv2.GetV()) / v3v2Diff;
-	float zRecipSlope2 = (uv3.GetZRecip() - uv1.GetZRecip()) / v3v2Diff;
-
-	float cRed1 = GetRValue(c3);
-	float cGreen1 = GetGValue(c3);
-	float cBlue1 = GetBValue(c3);
-	float cUOverZ1 = uv3.GetU();
-	float cVOverZ1 = uv3.GetV();
-	float cZRecip1 = uv3.GetZRecip();
-
-	float cRed2 = GetRValue(c3);
-	float cGreen2 = GetGValue(c3);
-	float cBlue2 = GetBValue(c3);
-	float cUOverZ2 = uv3.GetU();
-	float cVOverZ2 = uv3.GetV();
-	float cZRecip2 = uv3.GetZRecip();
-
-	if (slope1 < slope2)
+	// Concatenates the viewing, perspective and screen transformations and applies them to the
+	// lit vertices, dehomogenising them in the same pass. The screen transformation is affine, so
+	// it can be applied before the divide
 	{
-		float slopeTemp = slope1;
-		slope1 = slope2;
-		slope2 = slopeTemp;
-
-		slopeTemp = colourSlopeRed1;
-		colourSlopeRed1 = colourSlopeRed2;
-		colourSlopeRed2 = slopeTemp;
-
-		slopeTemp = colourSlopeGreen1;
-		colourSlopeGreen1 = colourSlopeGreen2;
-		colourSlopeGreen2 = slopeTemp;
-
-		slopeTemp = colourSlopeBlue1;
-		colourSlopeBlue1 = colourSlopeBlue2;
-		colourSlopeBlue2 = slopeTemp;
-
-		slopeTemp = uOverZSlope1;
-		uOverZSlope1 = uOverZSlope2;
-		uOverZSlope2 = slopeTemp;
-
-		slopeTemp = vOverZSlope1;
-		vOverZSlope1 = vOverZSlope2;
-		vOverZSlope2 = slopeTemp;
-
-		slopeTemp = zRecipSlope1;
-		zRecipSlope1 = zRecipSlope2;
-		zRecipSlope2 = slopeTemp;
+		PROFILE_SCOPE(ProfileStage::Project);
+		_transforms.Push();
+		_transforms.LoadIdentity();
+		_transforms.Multiply(GenerateScreenMatrix(1, windowWidth, windowHeight));
+		_transforms.Multiply(GeneratePerspectiveMatrix(1, float(windowWidth) / float(windowHeight)));
+		_transforms.Multiply(GenerateViewMatrix(_camera));
+		model.Project(_transforms.GetTop());
+		_transforms.Pop();
 	}
 
-	for (int scanlineY = int(v3.GetY()); scanlineY >= v1.GetY(); scanlineY--)
+	// Sorts the polygons that are not depth tested
+	if (!frame.depthTest)
 	{
-		for (int xPos = int(ceil(x1)); xPos <= int(x2); xPos++)
-		{
-			float t = (xPos - x1) / (x2 - x1);
-
-			int red = int((1 - t) * cRed1 + t * cRed2);
-			int green = int((1 - t) * cGreen1 + t * cGreen2);
-			int blue = int((1 - t) * cBlue1 + t * cBlue2);
-			float uOverZ = (1 - t) * cUOverZ1 + t * cUOverZ2;
-			float vOverZ = (1 - t) * cVOverZ1 + t * cVOverZ2;
-			float zRecip = (1 - t) * cZRecip1 + t * cZRecip2;
-
-			COLORREF textureColour = _model.GetTexture().GetTextureValue(int(uOverZ / zRecip), int(vOverZ / zRecip));
-
-			float finalRed = float(GetRValue(textureColour) * (red / 255));
-			float finalGreen = float(GetGValue(textureColour) * (green / 255));
-			float finalBlue = float(GetBValue(textureColour) * (blue / 255));
-
-			COLORREF colour = RGB(Clamp(finalRed, 0, 255), Clamp(finalGreen, 0, 255), Clamp(finalBlue, 0, 255));
-
-			// Draws pixel
-			SetPixel(bitmap.GetDC(), xPos, scanlineY, colour);
-		}
-
-		x1 -= slope1;
-		x2 -= slope2;
-
-		cRed1 -= colourSlopeRed1;
-		cGreen1 -= colourSlopeGreen1;
-		cBlue1 -= colourSlopeBlue1;
-		cUOverZ1 -= uOverZSlope1;
-		cVOverZ1 -= vOverZSlope1;
-		cZRecip1 -= zRecipSlope1;
-
-		cRed2 -= colourSlopeRed2;
-		cGreen2 -= colourSlopeGreen2;
-		cBlue2 -= colourSlopeBlue2;
-		cUOverZ2 -= uOverZSlope2;
-		cVOverZ2 -= vOverZSlope2;
-		cZRecip2 -= zRecipSlope2;
+		PROFILE_SCOPE(ProfileStage::Sort);
+		model.Sort();
 	}
 }
 
-// Rendering pipeline, applies required tranformations and draws model to the screen
+// Second half of the rendering pipeline, which draws the oldest prepared frame to the screen.
+// If no frame has been prepared since the last one was drawn, one is prepared first, unless
+// frames are being prepared on another thread
 void Rasteriser::Render(const Bitmap& bitmap)
 {
-	// Gets size of bitmap
-	int windowWidth = bitmap.GetWidth();
-	int windowHeight = bitmap.GetHeight();
-
-	// Calculates backfaces and marks polygons for culling (if at that stage in demo)
-	if (_demo.GetBackface())
-	{	
-		_model.CalculateBackfaces(_camera);
-	}
-
-	// Calculates flat lighting
-	if (!_demo.GetSmoothShading())
+	// Frames prepared for a bitmap of another size are out of date, so they are skipped
+	while (_renderedFrames != _preparedFrames)
 	{
-		// Applies ambient lighting to the model
-		_model.CalculateFlatLightingAmbient(_demo.GetAmbientLight());
-
-		// Applies directional lighting to the model
-		_model.CalculateFlatLightingDirectional(_demo.GetDirectionalLights());
-
-		// Applies point lighting to the model
-		_model.CalculateFlatLightingPoint(_demo.GetPointLights());
+		const PreparedFrame& frame = _frames[_renderedFrames % FRAME_SLOTS];
+		if (frame.width == bitmap.GetWidth() && frame.height == bitmap.GetHeight())
+		{
+			break;
+		}
+		_renderedFrames++;
 	}
-	else
+	if (_renderedFrames == _preparedFrames)
 	{
-		// Calculates normals for each vertex
-		_model.CalculateNormals();
-		// Calculates smooth lighting
-		if (!_demo.GetSpecular())
+		// Only the pipeline's own thread prepares frames while pipelined, so there is nothing to draw
+		if (_pipelined)
 		{
-			// Applies ambient lighting to the model
-			_model.CalculateSmoothLightingAmbient(_demo.GetAmbientLight());
-
-			// Applies directional lighting to the model
-			_model.CalculateSmoothLightingDirectional(_demo.GetDirectionalLights());
-
-			// Applies point lighting to the model
-			_model.CalculateSmoothLightingPoint(_demo.GetPointLights());
-		}
-		// Calculates smooth, specular lighting
-		else
-		{
-			// Applies ambient lighting to the model
-			_model.CalculateSmoothLightingAmbient(_demo.GetAmbientLight());
-
-			// Applies directional lighting to the model
-			_model.CalculateSmoothLightingDirectionalSpecular(_demo.GetDirectionalLights(), _camera);
-
-			// Applies point lighting to the model
-			_model.CalculateSmoothLightingPointSpecular(_demo.GetPointLights(), _camera);
-
-			// Applies spot lighting to the model
-			_model.CalculateSpotLighting(_demo.GetSpotLights(), _camera);
+			return;
 		}
+		Prepare(bitmap);
 	}
-
-	// Applies Viewing transformation
-	_model.ApplyTransformToTransformedVertices(GenerateViewMatrix(_camera));
-
-	// Applies Perspective/Projection transformation
-	_model.ApplyTransformToTransformedVertices(GeneratePerspectiveMatrix(1, float(windowWidth) / float(windowHeight)));
-
-	// Sorts polygons in the model so that polygons further from the camera are drawn first
-	_model.Sort();
-
-	// Dehomogenises the vertices
-	_model.Dehomogenise();
-
-	// Applies Screen tranformation
-	_model.ApplyTransformToTransformedVertices(GenerateScreenMatrix(1, windowWidth, windowHeight));
+	const PreparedFrame& frame = _frames[_renderedFrames % FRAME_SLOTS];
 
 	// Clear the bitmap to black
-	bitmap.Clear(RGB(0, 0, 0));
-
-	//Gets draw mode from demo class
-	std::string drawMode = _demo.GetDrawMode();
+	{
+		PROFILE_SCOPE(ProfileStage::Clear);
+		bitmap.Clear(RGB(0, 0, 0));
+		if (frame.modelVisible && frame.depthTest)
+		{
+			bitmap.ClearDepth();
+		}
+	}
 
-	// Loops through all polygons in the model
-	for (Polygon3D poly : _model.GetPolygons()) 
+	// Nothing is drawn if the whole model is outside the view. Otherwise our own triangles are
+	// drawn a tile at a time on all of the worker threads
+	if (frame.modelVisible && frame.tiled)
+	{
+		PROFILE_SCOPE(ProfileStage::Raster);
+		DrawTiled(bitmap, frame.model, frame.shadeMode);
+	}
+	else if (frame.modelVisible)
 	{
-		// Polygon is only drawn if it is not marked for culling
-		if (!poly.GetCulling())
+		PROFILE_SCOPE(ProfileStage::Raster);
+		// Loops through the polygons that are not culled
+		const std::vector<Polygon3D>& polygons = frame.model.GetPolygons();
+		for (int polygonIndex : frame.model.GetVisiblePolygons())
 		{
+			const Polygon3D& poly = polygons[polygonIndex];
 			// Uses drawing function that is specified by the demo class
-			if (drawMode == "Wireframe")
-			{
-				DrawWireframe(bitmap, poly);
-			}
-			else if (drawMode == "Solid")
-			{
-				DrawSolidFlat(bitmap, poly);
-			}
-			else if (drawMode == "MySolid")
-			{
-				MyDrawSolidFlat(bitmap, poly);
-			}
-			else if (drawMode == "Bresenham")
-			{
-				DrawGouraudBresenham(bitmap, poly);
-			}
-			else if (drawMode == "Textured")
+			if (frame.drawMode == "Wireframe")
 			{
-				DrawGouraudTextured(bitmap, poly);
+				DrawWireframe(bitmap, frame.model, poly);
 			}
-			else if (drawMode == "TexturedCorrected")
+			else if (frame.drawMode == "Solid")
 			{
-				DrawTexturedCorrectedBresenham(bitmap, poly);
+				DrawSolidFlat(bitmap, frame.model, poly);
 			}
 		}
 	}
-	// Gets stage from demo class and displays it on screen
-	std::string stage = _demo.GetStage();
-	// wstring(stage.begin(), stage.end()).c_str() converts string to a widestring which is required for the DrawString function
-	DrawString(bitmap, wstring(stage.begin(), stage.end()).c_str());
+	// Displays the stage the demo was at when the frame was prepared
+	DrawString(bitmap, frame.stage);
+
+	// Lets the next frame be prepared into this frame's slot
+	_renderedFrames++;
+}
+
+// Frames are prepared and drawn from different copies of the model, so the next frame can be
+// prepared on one thread while the last one is drawn on another
+bool Rasteriser::CanPipeline()
+{
+	return true;
+}
+
+unsigned int Rasteriser::GetPreparedFrameSlots()
+{
+	return FRAME_SLOTS;
+}
+
+void Rasteriser::DropPreparedFrames()
+{
+	_renderedFrames = _preparedFrames.load();
+}
+
+void Rasteriser::SetPipelined(bool pipelined)
+{
+	_pipelined = pipelined;
 }
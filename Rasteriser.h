@@ -13,14 +13,25 @@
 #include <vector>
 #include <algorithm>
 #include "Demo.h"
+#include "TileBinner.h"
+#include "WorkerPool.h"
+#include "TriangleRasteriser.h"
+#include "Clipper.h"
+#include "Frustum.h"
+#include "TransformStack.h"
+#include "AssetCache.h"
+#include "Profiler.h"
+#include <atomic>
+#include <memory>
 #include <string>
 
 class Rasteriser : public Framework
 {
 public:
 	bool Initialise();
-	// Loads model and textures from md2 & pcx files
+	// Loads model and textures from md2 & pcx files, unless they are already cached
 	bool LoadModel(const char* modelPath, const char* texturePath);
+	void LoadModelAsync(const char* modelPath, const char* texturePath);
 	// Matrix generators
 	Matrix GenerateViewMatrix(Camera camera);
 	Matrix GeneratePerspectiveMatrix(float d, float aspectRatio);
@@ -29,33 +40,91 @@ public:
 	Matrix GenerateScalingMatrix(float scale);
 	Matrix GenerateRotationMatrix(float x, float y, float z);
 	// Draws text to the screen
-	void DrawString(const Bitmap& bitmap, LPCTSTR text);
+	void DrawString(const Bitmap& bitmap, const std::string& text);
 	// Updates model, called every frame
 	void Update(const Bitmap& bitmap);
+	// Poses the model between where the demo placed it in the last two updates
+	void Interpolate(const Bitmap& bitmap, float amount);
 	// Drawing functions
-	void DrawWireframe(const Bitmap& bitmap, Polygon3D poly);
-	void DrawSolidFlat(const Bitmap& bitmap, Polygon3D poly);
-	void MyDrawSolidFlat(const Bitmap& bitmap, Polygon3D poly);
-	static int Signum(float x);
-	static float Clamp(float value, float lower, float upper);
-	void FillPolygonFlat(const Bitmap& bitmap, Vertex v1, Vertex v2, Vertex v3, COLORREF colour);
-	void DrawGouraudBresenham(const Bitmap& bitmap, Polygon3D poly);
-	void FillPolygonGouraud(const Bitmap& bitmap, Vertex v1, Vertex v2, Vertex v3, COLORREF c1, COLORREF c2, COLORREF c3);
-	void DrawGouraudStandard(const Bitmap& bitmap, Polygon3D poly);
-	void FillBottomGouraud(const Bitmap& bitmap, Vertex v1, Vertex v2, Vertex v3, COLORREF c1, COLORREF c2, COLORREF c3);
-	void FillTopGouraud(const Bitmap& bitmap, Vertex v1, Vertex v2, Vertex v3, COLORREF c1, COLORREF c2, COLORREF c3);
-	void DrawGouraudTextured(const Bitmap& bitmap, Polygon3D poly);
-	void FillGouraudTextured(const Bitmap& bitmap, Vertex v1, Vertex v2, Vertex v3, COLORREF c1, COLORREF c2, COLORREF c3, UVPair uv1, UVPair uv2, UVPair uv3);
-	void DrawTexturedCorrectedBresenham(const Bitmap& bitmap, Polygon3D poly);
-	void FillTexturedCorrected(const Bitmap& bitmap, Vertex v1, Vertex v2, Vertex v3, COLORREF c1, COLORREF c2, COLORREF c3, UVPair uv1, UVPair uv2, UVPair uv3);
-	void DrawTexturedCorrectedStandard(const Bitmap& bitmap, Polygon3D poly);
-	void FillBottomTextured(const Bitmap& bitmap, Vertex v1, Vertex v2, Vertex v3, COLORREF c1, COLORREF c2, COLORREF c3, UVPair uv1, UVPair uv2, UVPair uv3);
-	void FillTopTextured(const Bitmap& bitmap, Vertex v1, Vertex v2, Vertex v3, COLORREF c1, COLORREF c2, COLORREF c3, UVPair uv1, UVPair uv2, UVPair uv3);
+	static void DrawLine(const Bitmap& bitmap, int x0, int y0, int x1, int y1, COLORREF colour);
+	void DrawWireframe(const Bitmap& bitmap, const Model& model, const Polygon3D& poly);
+	void DrawSolidFlat(const Bitmap& bitmap, const Model& model, const Polygon3D& poly);
+	int ClipPolygon(const Model& model, const Polygon3D& poly, ShadeMode mode, RasterVertex output[Clipper::MAXIMUM_VERTICES]);
+	void DrawPolygon(const Bitmap& bitmap, const Tile& tile, const Model& model, const Polygon3D& poly, ShadeMode mode);
+	static bool GetShadeMode(const std::string& drawMode, ShadeMode& mode);
+	void DrawTiled(const Bitmap& bitmap, const Model& model, ShadeMode mode);
+	// Transforms, lights and projects the model ready to be drawn, called every frame
+	void Prepare(const Bitmap& bitmap);
 	// Draws model using specified draw mode, called every frame
 	void Render(const Bitmap& bitmap);
+	bool CanPipeline();
+	unsigned int GetPreparedFrameSlots();
+	void DropPreparedFrames();
+	void SetPipelined(bool pipelined);
+	// Runs the demo from the start with another model, for benchmarking
+	bool Restart(const std::string& modelPath, const std::string& texturePath);
+	FrameDescription DescribeFrame();
 private:
+	// Where the demo has placed the model
+	struct ModelPose
+	{
+		float position[3];
+		float rotation[3];
+		float scale;
+		float animationTime;
+	};
+
+	// Everything Render needs to draw a frame. Frames are prepared into each of these in turn, so
+	// that the next frame can be prepared while Render draws the last one
+	struct PreparedFrame
+	{
+		Model model;
+		std::string stage;
+		std::string drawMode;
+		ShadeMode shadeMode;
+		// Whether the polygons are drawn by our own triangle rasteriser, and are depth tested
+		bool tiled;
+		bool depthTest;
+		// Whether any of the model is inside the view
+		bool modelVisible;
+		// Size of the bitmap the frame was prepared for
+		unsigned int width;
+		unsigned int height;
+	};
+	static const int FRAME_SLOTS = 2;
+
+	// Transforms and animates the model into a pose. Returns false if none of it can be seen, or
+	// no model has been loaded yet
+	bool PoseModel(const Bitmap& bitmap, const ModelPose& pose, Model& model);
+	// Culls, lights, projects and sorts the posed model of a frame
+	void PrepareModel(const Bitmap& bitmap, PreparedFrame& frame);
+
 	Demo _demo;
 	Camera _camera;
-	Model _model;
+	// Model currently shown by the demo. This is given to the model of each prepared frame
+	std::shared_ptr<const ModelAsset> _asset;
+	PreparedFrame _frames[FRAME_SLOTS];
+	// Number of frames prepared and rendered so far. The next frame is prepared in slot
+	// _preparedFrames % FRAME_SLOTS and the next one drawn from slot _renderedFrames % FRAME_SLOTS.
+	// Preparing and rendering may be done on different threads
+	std::atomic<unsigned int> _preparedFrames{ 0 };
+	std::atomic<unsigned int> _renderedFrames{ 0 };
+	// Set while a pipeline prepares frames on another thread, when Render must not prepare them
+	bool _pipelined{ false };
+	// Models that have been loaded, so switching between them does not reload them
+	AssetCache _assets;
+	// Model transformation is at the bottom of the stack
+	TransformStack _transforms;
+	// Part of the world that can be seen
+	Frustum _frustum;
+	// Poses of the model after the last two updates, and the pose the next frame is drawn with.
+	// The stage is used to tell when the demo jumps rather than moves the model
+	ModelPose _pose{};
+	ModelPose _previousPose{};
+	ModelPose _drawPose{};
+	std::string _poseStage;
+	// Threads and tiles used to draw the model in parallel
+	WorkerPool _workers;
+	TileBinner _binner;
 };
 
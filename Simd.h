@@ -0,0 +1,124 @@
+#pragma once
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+// Small wrappers for working on four values at once. SSE2 is used wherever it is available
+// (it is always there on x64 and is the default for 32-bit builds), otherwise the same
+// operations are done with plain loops so that the rasteriser still builds everywhere else.
+
+#if defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2) || defined(__SSE2__)
+#define RASTERISER_SSE2
+#include <emmintrin.h>
+#endif
+
+struct Int4;
+
+// Four floats
+struct Float4
+{
+#ifdef RASTERISER_SSE2
+	__m128 v;
+
+	static inline Float4 Set1(float a) { return { _mm_set1_ps(a) }; }
+	static inline Float4 Set(float a, float b, float c, float d) { return { _mm_setr_ps(a, b, c, d) }; }
+	static inline Float4 Load(const float* p) { return { _mm_loadu_ps(p) }; }
+	inline void Store(float* p) const { _mm_storeu_ps(p, v); }
+	inline Float4 operator+(const Float4& o) const { return { _mm_add_ps(v, o.v) }; }
+	inline Float4 operator-(const Float4& o) const { return { _mm_sub_ps(v, o.v) }; }
+	inline Float4 operator*(const Float4& o) const { return { _mm_mul_ps(v, o.v) }; }
+	inline Float4 operator/(const Float4& o) const { return { _mm_div_ps(v, o.v) }; }
+	static inline Float4 Min(const Float4& a, const Float4& b) { return { _mm_min_ps(a.v, b.v) }; }
+	static inline Float4 Max(const Float4& a, const Float4& b) { return { _mm_max_ps(a.v, b.v) }; }
+	static inline Float4 Sqrt(const Float4& a) { return { _mm_sqrt_ps(a.v) }; }
+	// 1 / sqrt(a), from the 12-bit estimate refined by a Newton-Raphson step to about 22 bits.
+	// This is much quicker than a square root followed by a divide
+	static inline Float4 ReciprocalSqrt(const Float4& a)
+	{
+		__m128 estimate = _mm_rsqrt_ps(a.v);
+		__m128 halfA = _mm_mul_ps(_mm_set1_ps(0.5f), a.v);
+		return { _mm_mul_ps(estimate, _mm_sub_ps(_mm_set1_ps(1.5f), _mm_mul_ps(halfA, _mm_mul_ps(estimate, estimate)))) };
+	}
+#else
+	float v[4];
+
+	static inline Float4 Set1(float a) { return { { a, a, a, a } }; }
+	static inline Float4 Set(float a, float b, float c, float d) { return { { a, b, c, d } }; }
+	static inline Float4 Load(const float* p) { return { { p[0], p[1], p[2], p[3] } }; }
+	inline void Store(float* p) const { for (int i = 0; i < 4; i++) { p[i] = v[i]; } }
+	inline Float4 operator+(const Float4& o) const { return { { v[0] + o.v[0], v[1] + o.v[1], v[2] + o.v[2], v[3] + o.v[3] } }; }
+	inline Float4 operator-(const Float4& o) const { return { { v[0] - o.v[0], v[1] - o.v[1], v[2] - o.v[2], v[3] - o.v[3] } }; }
+	inline Float4 operator*(const Float4& o) const { return { { v[0] * o.v[0], v[1] * o.v[1], v[2] * o.v[2], v[3] * o.v[3] } }; }
+	inline Float4 operator/(const Float4& o) const { return { { v[0] / o.v[0], v[1] / o.v[1], v[2] / o.v[2], v[3] / o.v[3] } }; }
+	static inline Float4 Min(const Float4& a, const Float4& b) { return { { a.v[0] < b.v[0] ? a.v[0] : b.v[0], a.v[1] < b.v[1] ? a.v[1] : b.v[1], a.v[2] < b.v[2] ? a.v[2] : b.v[2], a.v[3] < b.v[3] ? a.v[3] : b.v[3] } }; }
+	static inline Float4 Max(const Float4& a, const Float4& b) { return { { a.v[0] > b.v[0] ? a.v[0] : b.v[0], a.v[1] > b.v[1] ? a.v[1] : b.v[1], a.v[2] > b.v[2] ? a.v[2] : b.v[2], a.v[3] > b.v[3] ? a.v[3] : b.v[3] } }; }
+	static inline Float4 Sqrt(const Float4& a) { return { { sqrtf(a.v[0]), sqrtf(a.v[1]), sqrtf(a.v[2]), sqrtf(a.v[3]) } }; }
+	static inline Float4 ReciprocalSqrt(const Float4& a) { return { { 1 / sqrtf(a.v[0]), 1 / sqrtf(a.v[1]), 1 / sqrtf(a.v[2]), 1 / sqrtf(a.v[3]) } }; }
+#endif
+
+	inline Float4& operator+=(const Float4& o) { *this = *this + o; return *this; }
+	// Returns a mask with all bits set in each lane where this is greater than o
+	inline Int4 GreaterThan(const Float4& o) const;
+	// Converts to integers, rounding towards zero
+	inline Int4 ToInt() const;
+	// Returns the values as a mask, for selecting floats using an Int4 mask
+	inline Int4 AsInt() const;
+};
+
+// Four 32-bit integers. Also used as a mask with all bits set or clear in each lane
+struct Int4
+{
+#ifdef RASTERISER_SSE2
+	__m128i v;
+
+	static inline Int4 Set1(int32_t a) { return { _mm_set1_epi32(a) }; }
+	static inline Int4 Set(int32_t a, int32_t b, int32_t c, int32_t d) { return { _mm_setr_epi32(a, b, c, d) }; }
+	static inline Int4 Load(const uint32_t* p) { return { _mm_loadu_si128(reinterpret_cast<const __m128i*>(p)) }; }
+	// Loads four bytes, each zero extended to 32 bits
+	static inline Int4 LoadBytes(const uint8_t* p) { int32_t bytes; memcpy(&bytes, p, sizeof(bytes)); __m128i zero = _mm_setzero_si128(); return { _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(bytes), zero), zero) }; }
+	inline void Store(uint32_t* p) const { _mm_storeu_si128(reinterpret_cast<__m128i*>(p), v); }
+	inline Int4 operator+(const Int4& o) const { return { _mm_add_epi32(v, o.v) }; }
+	inline Int4 operator|(const Int4& o) const { return { _mm_or_si128(v, o.v) }; }
+	inline Int4 operator&(const Int4& o) const { return { _mm_and_si128(v, o.v) }; }
+	inline Int4 operator<<(int bits) const { return { _mm_slli_epi32(v, bits) }; }
+	inline Int4 operator>>(int bits) const { return { _mm_srli_epi32(v, bits) }; }
+	// Returns a mask with all bits set in each lane that is not negative
+	inline Int4 NotNegative() const { return { _mm_cmpgt_epi32(v, _mm_set1_epi32(-1)) }; }
+	// Returns a bit for each lane of a mask, lane 0 in bit 0
+	inline int MoveMask() const { return _mm_movemask_ps(_mm_castsi128_ps(v)); }
+	inline Float4 ToFloat() const { return { _mm_cvtepi32_ps(v) }; }
+	inline Float4 AsFloat() const { return { _mm_castsi128_ps(v) }; }
+	// Takes lanes from a where the mask is set and b where it is clear
+	static inline Int4 Select(const Int4& mask, const Int4& a, const Int4& b) { return { _mm_or_si128(_mm_and_si128(mask.v, a.v), _mm_andnot_si128(mask.v, b.v)) }; }
+#else
+	int32_t v[4];
+
+	static inline Int4 Set1(int32_t a) { return { { a, a, a, a } }; }
+	static inline Int4 Set(int32_t a, int32_t b, int32_t c, int32_t d) { return { { a, b, c, d } }; }
+	static inline Int4 Load(const uint32_t* p) { return { { int32_t(p[0]), int32_t(p[1]), int32_t(p[2]), int32_t(p[3]) } }; }
+	static inline Int4 LoadBytes(const uint8_t* p) { return { { int32_t(p[0]), int32_t(p[1]), int32_t(p[2]), int32_t(p[3]) } }; }
+	inline void Store(uint32_t* p) const { for (int i = 0; i < 4; i++) { p[i] = uint32_t(v[i]); } }
+	inline Int4 operator+(const Int4& o) const { return { { v[0] + o.v[0], v[1] + o.v[1], v[2] + o.v[2], v[3] + o.v[3] } }; }
+	inline Int4 operator|(const Int4& o) const { return { { v[0] | o.v[0], v[1] | o.v[1], v[2] | o.v[2], v[3] | o.v[3] } }; }
+	inline Int4 operator&(const Int4& o) const { return { { v[0] & o.v[0], v[1] & o.v[1], v[2] & o.v[2], v[3] & o.v[3] } }; }
+	inline Int4 operator<<(int bits) const { return { { int32_t(uint32_t(v[0]) << bits), int32_t(uint32_t(v[1]) << bits), int32_t(uint32_t(v[2]) << bits), int32_t(uint32_t(v[3]) << bits) } }; }
+	inline Int4 operator>>(int bits) const { return { { int32_t(uint32_t(v[0]) >> bits), int32_t(uint32_t(v[1]) >> bits), int32_t(uint32_t(v[2]) >> bits), int32_t(uint32_t(v[3]) >> bits) } }; }
+	inline Int4 NotNegative() const { return { { v[0] >= 0 ? -1 : 0, v[1] >= 0 ? -1 : 0, v[2] >= 0 ? -1 : 0, v[3] >= 0 ? -1 : 0 } }; }
+	inline int MoveMask() const { return (v[0] < 0 ? 1 : 0) | (v[1] < 0 ? 2 : 0) | (v[2] < 0 ? 4 : 0) | (v[3] < 0 ? 8 : 0); }
+	inline Float4 ToFloat() const { return { { float(v[0]), float(v[1]), float(v[2]), float(v[3]) } }; }
+	inline Float4 AsFloat() const { Float4 f; for (int i = 0; i < 4; i++) { union { int32_t i; float f; } bits; bits.i = v[i]; f.v[i] = bits.f; } return f; }
+	static inline Int4 Select(const Int4& mask, const Int4& a, const Int4& b) { return { { (mask.v[0] & a.v[0]) | (~mask.v[0] & b.v[0]), (mask.v[1] & a.v[1]) | (~mask.v[1] & b.v[1]), (mask.v[2] & a.v[2]) | (~mask.v[2] & b.v[2]), (mask.v[3] & a.v[3]) | (~mask.v[3] & b.v[3]) } }; }
+#endif
+
+	inline Int4& operator+=(const Int4& o) { *this = *this + o; return *this; }
+};
+
+#ifdef RASTERISER_SSE2
+inline Int4 Float4::GreaterThan(const Float4& o) const { return { _mm_castps_si128(_mm_cmpgt_ps(v, o.v)) }; }
+inline Int4 Float4::ToInt() const { return { _mm_cvttps_epi32(v) }; }
+inline Int4 Float4::AsInt() const { return { _mm_castps_si128(v) }; }
+#else
+inline Int4 Float4::GreaterThan(const Float4& o) const { return { { v[0] > o.v[0] ? -1 : 0, v[1] > o.v[1] ? -1 : 0, v[2] > o.v[2] ? -1 : 0, v[3] > o.v[3] ? -1 : 0 } }; }
+inline Int4 Float4::ToInt() const { return { { int32_t(v[0]), int32_t(v[1]), int32_t(v[2]), int32_t(v[3]) } }; }
+inline Int4 Float4::AsInt() const { Int4 r; for (int i = 0; i < 4; i++) { union { float f; int32_t i; } bits; bits.f = v[i]; r.v[i] = bits.i; } return r; }
+#endif
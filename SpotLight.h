@@ -1,6 +1,6 @@
 #pragma once
 #include "Vertex.h"
-#include <windows.h>
+#include "Platform.h"
 #include "PointLight.h"
 
 // Spot light inherits from point light as they share many attributes
@@ -78,3 +78,17 @@ int Texture::GetHeight() const
 {
 	return _height;
 }
+
+size_t Texture::GetMemorySize() const
+{
+	size_t size = 0;
+	if (_paletteIndices != nullptr)
+	{
+		size += static_cast<size_t>(_width) * static_cast<size_t>(_height);
+	}
+	if (_palette != nullptr)
+	{
+		size += 256 * sizeof(COLORREF);
+	}
+	return size;
+}
@@ -1,5 +1,6 @@
 #pragma once
-#include "windows.h"
+#include "Platform.h"
+#include <cstddef>
 
 class Texture
 {
@@ -13,6 +14,8 @@ public:
 	COLORREF* GetPalette();
 	int			GetWidth() const;
 	int			GetHeight() const;
+	// Number of bytes allocated for the palette indices and palette
+	size_t		GetMemorySize() const;
 
 private:
 	BYTE* _paletteIndices;
@@ -0,0 +1,90 @@
+#include "TileBinner.h"
+#include <algorithm>
+
+TileBinner::TileBinner()
+{
+}
+
+TileBinner::~TileBinner()
+{
+}
+
+void TileBinner::Resize(int width, int height, unsigned int binSetCount)
+{
+	if (width == _width && height == _height && binSetCount == _binSetCount)
+	{
+		return;
+	}
+	_width = width;
+	_height = height;
+	_binSetCount = binSetCount;
+	_tilesX = (width + TILE_SIZE - 1) / TILE_SIZE;
+	_tilesY = (height + TILE_SIZE - 1) / TILE_SIZE;
+
+	_tiles.clear();
+	for (int tileY = 0; tileY < _tilesY; tileY++)
+	{
+		for (int tileX = 0; tileX < _tilesX; tileX++)
+		{
+			Tile tile;
+			tile.left = tileX * TILE_SIZE;
+			tile.top = tileY * TILE_SIZE;
+			tile.right = std::min(tile.left + TILE_SIZE, width) - 1;
+			tile.bottom = std::min(tile.top + TILE_SIZE, height) - 1;
+			_tiles.push_back(tile);
+		}
+	}
+	_bins.clear();
+	_bins.resize(_tiles.size() * binSetCount);
+}
+
+void TileBinner::Clear()
+{
+	for (std::vector<int>& bin : _bins)
+	{
+		bin.clear();
+	}
+}
+
+void TileBinner::Bin(unsigned int binSet, int polygonIndex, float minX, float minY, float maxX, float maxY)
+{
+	// Rejects polygons that are completely off screen. Written so that NaN bounds are rejected too
+	if (!(maxX >= 0 && maxY >= 0 && minX < _width && minY < _height))
+	{
+		return;
+	}
+	// Clamps the bounds to the screen before converting them to tile coordinates
+	int firstX = int(std::max(minX, 0.0f)) / TILE_SIZE;
+	int firstY = int(std::max(minY, 0.0f)) / TILE_SIZE;
+	int lastX = int(std::min(maxX, float(_width - 1))) / TILE_SIZE;
+	int lastY = int(std::min(maxY, float(_height - 1))) / TILE_SIZE;
+
+	std::vector<int>* bins = &_bins[binSet * _tiles.size()];
+	for (int tileY = firstY; tileY <= lastY; tileY++)
+	{
+		for (int tileX = firstX; tileX <= lastX; tileX++)
+		{
+			bins[tileY * _tilesX + tileX].push_back(polygonIndex);
+		}
+	}
+}
+
+size_t TileBinner::GetTileCount() const
+{
+	return _tiles.size();
+}
+
+const Tile& TileBinner::GetTile(size_t tile) const
+{
+	return _tiles[tile];
+}
+
+unsigned int TileBinner::GetBinSetCount() const
+{
+	return _binSetCount;
+}
+
+const std::vector<int>& TileBinner::GetBin(unsigned int binSet, size_t tile) const
+{
+	return _bins[binSet * _tiles.size() + tile];
+}
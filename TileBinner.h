@@ -0,0 +1,48 @@
+#pragma once
+#include <cstddef>
+#include <vector>
+
+// Screen space rectangle that a tile covers. All of the bounds are inclusive
+struct Tile
+{
+	int left;
+	int top;
+	int right;
+	int bottom;
+};
+
+// Splits the screen into tiles and keeps a list of the polygons that overlap each of them.
+// There is a separate set of bins for each thread doing the binning, so polygons can be
+// binned in parallel without locking. Reading the bin sets back in order gives the polygons
+// in the same order that they were binned
+class TileBinner
+{
+public:
+	static const int TILE_SIZE = 64;
+
+	TileBinner();
+	~TileBinner();
+
+	// Creates the tiles for a screen of the specified size. Does nothing if the size and
+	// number of bin sets have not changed, so the bins keep their memory between frames
+	void				Resize(int width, int height, unsigned int binSetCount);
+	// Empties all of the bins
+	void				Clear();
+	// Adds a polygon to every tile its screen space bounds overlap in the specified bin set
+	void				Bin(unsigned int binSet, int polygonIndex, float minX, float minY, float maxX, float maxY);
+
+	size_t				GetTileCount() const;
+	const Tile&			GetTile(size_t tile) const;
+	unsigned int		GetBinSetCount() const;
+	const std::vector<int>& GetBin(unsigned int binSet, size_t tile) const;
+
+private:
+	int					_width{ 0 };
+	int					_height{ 0 };
+	int					_tilesX{ 0 };
+	int					_tilesY{ 0 };
+	unsigned int		_binSetCount{ 0 };
+	std::vector<Tile>	_tiles;
+	// Polygon indices for each tile, stored bin set by bin set
+	std::vector<std::vector<int>> _bins;
+};
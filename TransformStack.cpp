@@ -0,0 +1,44 @@
+#include "TransformStack.h"
+
+TransformStack::TransformStack()
+{
+	_matrices.push_back(Matrix::IdentityMatrix());
+}
+
+TransformStack::~TransformStack()
+{
+}
+
+void TransformStack::Push()
+{
+	_matrices.push_back(_matrices.back());
+}
+
+// The bottom matrix is never removed, so there is always a top matrix
+void TransformStack::Pop()
+{
+	if (_matrices.size() > 1)
+	{
+		_matrices.pop_back();
+	}
+}
+
+void TransformStack::LoadIdentity()
+{
+	_matrices.back() = Matrix::IdentityMatrix();
+}
+
+void TransformStack::Load(const Matrix& transform)
+{
+	_matrices.back() = transform;
+}
+
+void TransformStack::Multiply(const Matrix& transform)
+{
+	_matrices.back() = _matrices.back() * transform;
+}
+
+const Matrix& TransformStack::GetTop() const
+{
+	return _matrices.back();
+}
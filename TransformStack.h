@@ -0,0 +1,27 @@
+#pragma once
+#include "Matrix.h"
+#include <vector>
+
+// Stack of transformation matrices. Transformations are concatenated into the matrix at the top
+// of the stack as they are added, so the vertices only need to be transformed once by the result
+// however many transformations there are
+class TransformStack
+{
+public:
+	TransformStack();
+	~TransformStack();
+
+	// Saves a copy of the top matrix, which is restored by Pop
+	void			Push();
+	void			Pop();
+	// Replaces the top matrix
+	void			LoadIdentity();
+	void			Load(const Matrix& transform);
+	// Multiplies the top matrix by the transform on the right, so the transform is applied to
+	// vertices before any that were added earlier
+	void			Multiply(const Matrix& transform);
+	const Matrix&	GetTop() const;
+
+private:
+	std::vector<Matrix> _matrices;
+};
@@ -0,0 +1,451 @@
+#include "TriangleRasteriser.h"
+#include "Clipper.h"
+#include "Simd.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+// Largest distance from the origin, in pixels, of a vertex that can be drawn. This keeps the edge
+// function values used inside a block within 32 bits. The clipper keeps vertices within half of
+// this, so it is only a backstop against NaNs and overflow in vertices that were not clipped
+const float GUARD_BAND = 2.0f * CLIP_GUARD_BAND;
+const int SUBPIXEL_SCALE = 1 << TriangleRasteriser::SUBPIXEL_BITS;
+
+// Edge function value = a * x + b * y + c, where x and y are whole pixels and the value is the
+// one at the centre of the pixel. The value is not negative for pixels inside the edge
+struct EdgeFunction
+{
+	int64_t		a;
+	int64_t		b;
+	int64_t		c;
+};
+
+// Attribute that varies linearly in screen space, value = dx * x + dy * y + c at pixel centres
+struct AttributePlane
+{
+	float		dx;
+	float		dy;
+	float		c;
+};
+
+// Everything needed to draw a triangle that only has to be worked out once
+struct TriangleSetup
+{
+	EdgeFunction	edges[3];
+	// Pixels that need testing, clipped to the tile
+	int				minX;
+	int				minY;
+	int				maxX;
+	int				maxY;
+	AttributePlane	depth;
+	AttributePlane	red;
+	AttributePlane	green;
+	AttributePlane	blue;
+	// Texture coordinates. These are divided by the pre-transform z when corrected for perspective
+	AttributePlane	u;
+	AttributePlane	v;
+	// World position and normal, divided by the pre-transform z
+	AttributePlane	worldX;
+	AttributePlane	worldY;
+	AttributePlane	worldZ;
+	AttributePlane	normalX;
+	AttributePlane	normalY;
+	AttributePlane	normalZ;
+	uint32_t		flatColour;
+	const Texture*	texture;
+	const Lighting*	lighting;
+	float			maxU;
+	float			maxV;
+};
+
+// Works out the plane of an attribute from its value at the three vertices
+static AttributePlane CalculatePlane(const float x[3], const float y[3], float a0, float a1, float a2, float areaRecip)
+{
+	float dx1 = x[1] - x[0];
+	float dy1 = y[1] - y[0];
+	float dx2 = x[2] - x[0];
+	float dy2 = y[2] - y[0];
+	float da1 = a1 - a0;
+	float da2 = a2 - a0;
+
+	AttributePlane plane;
+	plane.dx = (da1 * dy2 - da2 * dy1) * areaRecip;
+	plane.dy = (da2 * dx1 - da1 * dx2) * areaRecip;
+	plane.c = a0 - plane.dx * (x[0] - 0.5f) - plane.dy * (y[0] - 0.5f);
+	return plane;
+}
+
+// Returns the value of a plane for the four pixels starting at x, y
+static inline Float4 PlaneQuad(const AttributePlane& plane, float x, float y)
+{
+	return Float4::Set1(plane.dx * x + plane.dy * y + plane.c) + Float4::Set1(plane.dx) * Float4::Set(0, 1, 2, 3);
+}
+
+// Returns a mask with the lanes from first to last set
+static inline Int4 LaneMask(int first, int last)
+{
+	return Int4::Set(first <= 0 && last >= 0 ? -1 : 0, first <= 1 && last >= 1 ? -1 : 0, first <= 2 && last >= 2 ? -1 : 0, first <= 3 && last >= 3 ? -1 : 0);
+}
+
+// Clamps colour channels to 0 - 255 and packs them into the 0x00RRGGBB layout of the bitmap
+static inline Int4 PackColour(const Float4& red, const Float4& green, const Float4& blue)
+{
+	Float4 lowest = Float4::Set1(0);
+	Float4 highest = Float4::Set1(255);
+	Int4 r = Float4::Min(Float4::Max(red, lowest), highest).ToInt();
+	Int4 g = Float4::Min(Float4::Max(green, lowest), highest).ToInt();
+	Int4 b = Float4::Min(Float4::Max(blue, lowest), highest).ToInt();
+	return (r << 16) | (g << 8) | b;
+}
+
+// Works out the colour of four pixels starting at x, y. depth is the interpolated reciprocal of z
+template <ShadeMode mode>
+static inline Int4 ShadeQuad(const TriangleSetup& setup, float x, float y, const Float4& depth)
+{
+	if (mode == ShadeMode::Flat)
+	{
+		return Int4::Set1(static_cast<int32_t>(setup.flatColour));
+	}
+	if (mode == ShadeMode::Phong)
+	{
+		Float4 zRecip = Float4::Set1(1.0f) / depth;
+		Float4 worldX = PlaneQuad(setup.worldX, x, y) * zRecip;
+		Float4 worldY = PlaneQuad(setup.worldY, x, y) * zRecip;
+		Float4 worldZ = PlaneQuad(setup.worldZ, x, y) * zRecip;
+		Float4 normalX = PlaneQuad(setup.normalX, x, y) * zRecip;
+		Float4 normalY = PlaneQuad(setup.normalY, x, y) * zRecip;
+		Float4 normalZ = PlaneQuad(setup.normalZ, x, y) * zRecip;
+		// Interpolated normals are shorter than unit length. Zero normals stay zero
+		Float4 lengthSquared = normalX * normalX + normalY * normalY + normalZ * normalZ;
+		Float4 scale = Float4::ReciprocalSqrt(Float4::Max(lengthSquared, Float4::Set1(1e-30f)));
+		Float4 litRed;
+		Float4 litGreen;
+		Float4 litBlue;
+		setup.lighting->Shade(worldX, worldY, worldZ, normalX * scale, normalY * scale, normalZ * scale, setup.lighting->GetAllPointLights(), litRed, litGreen, litBlue);
+		return PackColour(litRed, litGreen, litBlue);
+	}
+	Float4 red = PlaneQuad(setup.red, x, y);
+	Float4 green = PlaneQuad(setup.green, x, y);
+	Float4 blue = PlaneQuad(setup.blue, x, y);
+	if (mode == ShadeMode::Gouraud)
+	{
+		return PackColour(red, green, blue);
+	}
+
+	Float4 u = PlaneQuad(setup.u, x, y);
+	Float4 v = PlaneQuad(setup.v, x, y);
+	if (mode == ShadeMode::TexturedCorrected)
+	{
+		u = u / depth;
+		v = v / depth;
+	}
+	// Clamping before converting also gets rid of any NaNs from pixels outside the triangle
+	Float4 lowest = Float4::Set1(0);
+	uint32_t texelU[4];
+	uint32_t texelV[4];
+	Float4::Min(Float4::Max(u, lowest), Float4::Set1(setup.maxU)).ToInt().Store(texelU);
+	Float4::Min(Float4::Max(v, lowest), Float4::Set1(setup.maxV)).ToInt().Store(texelV);
+	Int4 texels = Int4::Set(
+		static_cast<int32_t>(setup.texture->GetTextureValue(int(texelU[0]), int(texelV[0]))),
+		static_cast<int32_t>(setup.texture->GetTextureValue(int(texelU[1]), int(texelV[1]))),
+		static_cast<int32_t>(setup.texture->GetTextureValue(int(texelU[2]), int(texelV[2]))),
+		static_cast<int32_t>(setup.texture->GetTextureValue(int(texelU[3]), int(texelV[3]))));
+
+	// Texture colours are COLORREFs (0x00BBGGRR) and are multiplied by the light
+	Int4 channelMask = Int4::Set1(0xFF);
+	Float4 lightScale = Float4::Set1(1.0f / 255);
+	Float4 texelRed = (texels & channelMask).ToFloat();
+	Float4 texelGreen = ((texels >> 8) & channelMask).ToFloat();
+	Float4 texelBlue = ((texels >> 16) & channelMask).ToFloat();
+	return PackColour(texelRed * red * lightScale, texelGreen * green * lightScale, texelBlue * blue * lightScale);
+}
+
+// Depth tests, shades and writes the pixels of a quad that are set in the mask. Only the lanes
+// from first to last are inside the tile
+template <ShadeMode mode, bool depthTest>
+static inline void DrawQuad(const TriangleSetup& setup, uint32_t* pixelRow, float* depthRow, int x, int y, int first, int last, Int4 mask)
+{
+	uint32_t* pixels = pixelRow + x;
+	float* depth = depthTest ? depthRow + x : nullptr;
+
+	// Quads that go past the edge of the tile are copied so that nothing outside the tile is read or written,
+	// as it may belong to another thread
+	bool partial = first > 0 || last < 3;
+	uint32_t pixelCopy[4] = { 0, 0, 0, 0 };
+	float depthCopy[4] = { 0, 0, 0, 0 };
+	if (partial)
+	{
+		for (int i = first; i <= last; i++)
+		{
+			pixelCopy[i] = pixels[i];
+			if (depthTest)
+			{
+				depthCopy[i] = depth[i];
+			}
+		}
+		pixels = pixelCopy;
+		depth = depthCopy;
+	}
+
+	float quadX = float(x);
+	float quadY = float(y);
+	Float4 z = PlaneQuad(setup.depth, quadX, quadY);
+	if (depthTest)
+	{
+		// Larger values are nearer the camera
+		Float4 stored = Float4::Load(depth);
+		mask = mask & z.GreaterThan(stored);
+		if (mask.MoveMask() == 0)
+		{
+			return;
+		}
+		Int4::Select(mask, z.AsInt(), stored.AsInt()).AsFloat().Store(depth);
+	}
+	Int4 colour = ShadeQuad<mode>(setup, quadX, quadY, z);
+	Int4::Select(mask, colour, Int4::Load(pixels)).Store(pixels);
+
+	if (partial)
+	{
+		for (int i = first; i <= last; i++)
+		{
+			pixelRow[x + i] = pixelCopy[i];
+			if (depthTest)
+			{
+				depthRow[x + i] = depthCopy[i];
+			}
+		}
+	}
+}
+
+// Walks the bounding box of the triangle a block at a time. Blocks are lined up with the screen rather
+// than the bounding box, so every pixel is worked out the same way whichever tile it is drawn in
+template <ShadeMode mode, bool depthTest>
+static void RasteriseTriangle(const Bitmap& bitmap, const TriangleSetup& setup)
+{
+	const int blockSize = TriangleRasteriser::BLOCK_SIZE;
+	int startX = setup.minX - setup.minX % blockSize;
+	int startY = setup.minY - setup.minY % blockSize;
+	for (int blockY = startY; blockY <= setup.maxY; blockY += blockSize)
+	{
+		int firstRow = std::max(blockY, setup.minY);
+		int lastRow = std::min(blockY + blockSize - 1, setup.maxY);
+		for (int blockX = startX; blockX <= setup.maxX; blockX += blockSize)
+		{
+			// Classifies the block against each edge using its corners. Blocks outside any edge are
+			// skipped, and edges that the whole block is inside do not need to be tested
+			Int4 edgeRow[3];
+			Int4 edgeStepX[3];
+			Int4 edgeStepY[3];
+			bool outside = false;
+			for (int i = 0; i < 3 && !outside; i++)
+			{
+				const EdgeFunction& edge = setup.edges[i];
+				int64_t corner = edge.a * blockX + edge.b * blockY + edge.c;
+				int64_t acrossX = edge.a * (blockSize - 1);
+				int64_t acrossY = edge.b * (blockSize - 1);
+				int64_t lowest = corner + std::min<int64_t>(acrossX, 0) + std::min<int64_t>(acrossY, 0);
+				int64_t highest = corner + std::max<int64_t>(acrossX, 0) + std::max<int64_t>(acrossY, 0);
+				if (highest < 0)
+				{
+					outside = true;
+				}
+				else if (lowest >= 0)
+				{
+					edgeRow[i] = Int4::Set1(0);
+					edgeStepX[i] = Int4::Set1(0);
+					edgeStepY[i] = Int4::Set1(0);
+				}
+				else
+				{
+					// The edge crosses the block, so every value inside it fits in 32 bits
+					int32_t value = static_cast<int32_t>(corner + edge.b * (firstRow - blockY));
+					int32_t stepX = static_cast<int32_t>(edge.a);
+					edgeRow[i] = Int4::Set(value, value + stepX, value + 2 * stepX, value + 3 * stepX);
+					edgeStepX[i] = Int4::Set1(4 * stepX);
+					edgeStepY[i] = Int4::Set1(static_cast<int32_t>(edge.b));
+				}
+			}
+			if (outside)
+			{
+				continue;
+			}
+
+			int lastX = std::min(blockX + blockSize - 1, setup.maxX);
+			for (int y = firstRow; y <= lastRow; y++)
+			{
+				uint32_t* pixelRow = bitmap.GetRow(y);
+				float* depthRow = depthTest ? bitmap.GetDepthRow(y) : nullptr;
+				Int4 edge0 = edgeRow[0];
+				Int4 edge1 = edgeRow[1];
+				Int4 edge2 = edgeRow[2];
+				for (int x = blockX; x <= lastX; x += 4)
+				{
+					// A pixel is inside if none of its edge function values are negative
+					Int4 mask = (edge0 | edge1 | edge2).NotNegative();
+					int first = std::max(setup.minX - x, 0);
+					int last = std::min(lastX - x, 3);
+					if (first > 0 || last < 3)
+					{
+						mask = mask & LaneMask(first, last);
+					}
+					if (mask.MoveMask() != 0)
+					{
+						DrawQuad<mode, depthTest>(setup, pixelRow, depthRow, x, y, first, last, mask);
+					}
+					edge0 += edgeStepX[0];
+					edge1 += edgeStepX[1];
+					edge2 += edgeStepX[2];
+				}
+				edgeRow[0] += edgeStepY[0];
+				edgeRow[1] += edgeStepY[1];
+				edgeRow[2] += edgeStepY[2];
+			}
+		}
+	}
+}
+
+template <ShadeMode mode>
+static void RasteriseTriangle(const Bitmap& bitmap, const TriangleSetup& setup)
+{
+	if (bitmap.HasDepthBuffer())
+	{
+		RasteriseTriangle<mode, true>(bitmap, setup);
+	}
+	else
+	{
+		RasteriseTriangle<mode, false>(bitmap, setup);
+	}
+}
+
+void TriangleRasteriser::DrawTriangle(const Bitmap& bitmap, const Tile& tile, ShadeMode mode, const RasterVertex& v0, const RasterVertex& v1, const RasterVertex& v2, const Texture* texture, const Lighting* lighting)
+{
+	const RasterVertex* vertices[3] = { &v0, &v1, &v2 };
+
+	// Snaps the vertices to the fixed point grid
+	int64_t fixedX[3];
+	int64_t fixedY[3];
+	for (int i = 0; i < 3; i++)
+	{
+		// Written so that NaNs are rejected as well
+		if (!(fabs(vertices[i]->x) < GUARD_BAND && fabs(vertices[i]->y) < GUARD_BAND))
+		{
+			return;
+		}
+		fixedX[i] = int64_t(floor(vertices[i]->x * SUBPIXEL_SCALE + 0.5f));
+		fixedY[i] = int64_t(floor(vertices[i]->y * SUBPIXEL_SCALE + 0.5f));
+	}
+
+	// Twice the area of the triangle. The edge functions are not negative inside triangles with a
+	// positive area, so triangles wound the other way are flipped
+	int64_t area = (fixedX[1] - fixedX[0]) * (fixedY[2] - fixedY[0]) - (fixedY[1] - fixedY[0]) * (fixedX[2] - fixedX[0]);
+	if (area == 0)
+	{
+		return;
+	}
+	if (area < 0)
+	{
+		std::swap(vertices[1], vertices[2]);
+		std::swap(fixedX[1], fixedX[2]);
+		std::swap(fixedY[1], fixedY[2]);
+		area = -area;
+	}
+
+	TriangleSetup setup;
+	for (int i = 0; i < 3; i++)
+	{
+		// Edge i goes between the two vertices that are not vertex i
+		int from = (i + 1) % 3;
+		int to = (i + 2) % 3;
+		int64_t a = fixedY[from] - fixedY[to];
+		int64_t b = fixedX[to] - fixedX[from];
+		// Pixel centres exactly on an edge are only drawn if it is a top edge (horizontal, with the
+		// triangle below it) or a left edge (going up the screen)
+		bool topLeft = (a == 0 && b > 0) || a > 0;
+		setup.edges[i].a = a * SUBPIXEL_SCALE;
+		setup.edges[i].b = b * SUBPIXEL_SCALE;
+		setup.edges[i].c = a * (SUBPIXEL_SCALE / 2 - fixedX[from]) + b * (SUBPIXEL_SCALE / 2 - fixedY[from]) - (topLeft ? 0 : 1);
+	}
+
+	// Bounding box of the triangle clipped to the tile
+	float x[3];
+	float y[3];
+	for (int i = 0; i < 3; i++)
+	{
+		x[i] = float(fixedX[i]) / SUBPIXEL_SCALE;
+		y[i] = float(fixedY[i]) / SUBPIXEL_SCALE;
+	}
+	setup.minX = std::max(tile.left, int(floor(std::min(x[0], std::min(x[1], x[2])))));
+	setup.minY = std::max(tile.top, int(floor(std::min(y[0], std::min(y[1], y[2])))));
+	setup.maxX = std::min(tile.right, int(ceil(std::max(x[0], std::max(x[1], x[2])))));
+	setup.maxY = std::min(tile.bottom, int(ceil(std::max(y[0], std::max(y[1], y[2])))));
+	if (setup.minX > setup.maxX || setup.minY > setup.maxY)
+	{
+		return;
+	}
+
+	float areaRecip = float(SUBPIXEL_SCALE * SUBPIXEL_SCALE) / float(area);
+	setup.depth = CalculatePlane(x, y, vertices[0]->zRecip, vertices[1]->zRecip, vertices[2]->zRecip, areaRecip);
+	setup.flatColour = Bitmap::ToPixel(vertices[0]->colour);
+	setup.texture = texture;
+	setup.lighting = lighting;
+	if (mode == ShadeMode::Phong)
+	{
+		if (lighting == nullptr)
+		{
+			return;
+		}
+		// Positions and normals divided by z are linear in screen space, as with perspective corrected textures
+		float zRecip[3] = { vertices[0]->zRecip, vertices[1]->zRecip, vertices[2]->zRecip };
+		setup.worldX = CalculatePlane(x, y, vertices[0]->worldX * zRecip[0], vertices[1]->worldX * zRecip[1], vertices[2]->worldX * zRecip[2], areaRecip);
+		setup.worldY = CalculatePlane(x, y, vertices[0]->worldY * zRecip[0], vertices[1]->worldY * zRecip[1], vertices[2]->worldY * zRecip[2], areaRecip);
+		setup.worldZ = CalculatePlane(x, y, vertices[0]->worldZ * zRecip[0], vertices[1]->worldZ * zRecip[1], vertices[2]->worldZ * zRecip[2], areaRecip);
+		setup.normalX = CalculatePlane(x, y, vertices[0]->normalX * zRecip[0], vertices[1]->normalX * zRecip[1], vertices[2]->normalX * zRecip[2], areaRecip);
+		setup.normalY = CalculatePlane(x, y, vertices[0]->normalY * zRecip[0], vertices[1]->normalY * zRecip[1], vertices[2]->normalY * zRecip[2], areaRecip);
+		setup.normalZ = CalculatePlane(x, y, vertices[0]->normalZ * zRecip[0], vertices[1]->normalZ * zRecip[1], vertices[2]->normalZ * zRecip[2], areaRecip);
+	}
+	else if (mode != ShadeMode::Flat)
+	{
+		setup.red = CalculatePlane(x, y, GetRValue(vertices[0]->colour), GetRValue(vertices[1]->colour), GetRValue(vertices[2]->colour), areaRecip);
+		setup.green = CalculatePlane(x, y, GetGValue(vertices[0]->colour), GetGValue(vertices[1]->colour), GetGValue(vertices[2]->colour), areaRecip);
+		setup.blue = CalculatePlane(x, y, GetBValue(vertices[0]->colour), GetBValue(vertices[1]->colour), GetBValue(vertices[2]->colour), areaRecip);
+	}
+	if (mode == ShadeMode::Textured || mode == ShadeMode::TexturedCorrected)
+	{
+		if (texture == nullptr || texture->GetWidth() <= 0 || texture->GetHeight() <= 0)
+		{
+			return;
+		}
+		setup.maxU = float(texture->GetWidth() - 1);
+		setup.maxV = float(texture->GetHeight() - 1);
+		// Texture coordinates divided by z are linear in screen space, so are used for perspective correction
+		float scale[3] = { 1, 1, 1 };
+		if (mode == ShadeMode::TexturedCorrected)
+		{
+			for (int i = 0; i < 3; i++)
+			{
+				scale[i] = vertices[i]->zRecip;
+			}
+		}
+		setup.u = CalculatePlane(x, y, vertices[0]->u * scale[0], vertices[1]->u * scale[1], vertices[2]->u * scale[2], areaRecip);
+		setup.v = CalculatePlane(x, y, vertices[0]->v * scale[0], vertices[1]->v * scale[1], vertices[2]->v * scale[2], areaRecip);
+	}
+
+	switch (mode)
+	{
+	case ShadeMode::Flat:
+		RasteriseTriangle<ShadeMode::Flat>(bitmap, setup);
+		break;
+	case ShadeMode::Gouraud:
+		RasteriseTriangle<ShadeMode::Gouraud>(bitmap, setup);
+		break;
+	case ShadeMode::Textured:
+		RasteriseTriangle<ShadeMode::Textured>(bitmap, setup);
+		break;
+	case ShadeMode::TexturedCorrected:
+		RasteriseTriangle<ShadeMode::TexturedCorrected>(bitmap, setup);
+		break;
+	case ShadeMode::Phong:
+		RasteriseTriangle<ShadeMode::Phong>(bitmap, setup);
+		break;
+	}
+}
@@ -0,0 +1,60 @@
+#pragma once
+#include "Platform.h"
+#include "Bitmap.h"
+#include "Texture.h"
+#include "TileBinner.h"
+#include "Lighting.h"
+
+// How each pixel of a triangle is coloured
+enum class ShadeMode
+{
+	// Every pixel uses the colour of the first vertex
+	Flat,
+	// Vertex colours are interpolated across the triangle
+	Gouraud,
+	// Texture is interpolated in screen space and lit with the interpolated vertex colours
+	Textured,
+	// As Textured, but the texture coordinates are corrected for perspective
+	TexturedCorrected,
+	// World positions and normals are interpolated, corrected for perspective, and every pixel is lit
+	Phong
+};
+
+// Screen space vertex passed to the triangle rasteriser
+struct RasterVertex
+{
+	float		x;
+	float		y;
+	// Reciprocal of the pre-transform z. Used for depth testing and perspective correction
+	float		zRecip;
+	COLORREF	colour;
+	// Texture coordinates in texels
+	float		u;
+	float		v;
+	// Position and normal before projection, only used for per-pixel lighting
+	float		worldX;
+	float		worldY;
+	float		worldZ;
+	float		normalX;
+	float		normalY;
+	float		normalZ;
+};
+
+// Half-space triangle rasteriser. Vertices are snapped to a fixed point grid and the three edge
+// functions are evaluated with integers, so the triangles that share an edge cover every pixel
+// along it exactly once (using a top-left fill rule). The bounding box is walked in blocks of
+// pixels, which are skipped or filled without edge tests when they are fully outside or inside
+// the triangle, and pixels are tested, shaded and written four at a time.
+class TriangleRasteriser
+{
+public:
+	// Fractional bits of the fixed point screen coordinates
+	static const int SUBPIXEL_BITS = 4;
+	// Width and height of the blocks the bounding box is split into
+	static const int BLOCK_SIZE = 8;
+
+	// Draws a triangle into the part of the bitmap covered by the tile. Pixels are depth tested if
+	// the bitmap has a depth buffer. texture is only used by the textured shade modes, and
+	// lighting by per-pixel lighting
+	static void DrawTriangle(const Bitmap& bitmap, const Tile& tile, ShadeMode mode, const RasterVertex& v0, const RasterVertex& v1, const RasterVertex& v2, const Texture* texture, const Lighting* lighting);
+};
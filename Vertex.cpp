@@ -178,6 +178,11 @@ float Vertex::GetPreTransformZ() const
 	return _preTransformZ;
 }
 
+void Vertex::SetPreTransformZ(const float z)
+{
+	_preTransformZ = z;
+}
+
 // Saves z value for use in texture perspective correction
 void Vertex::SavePreTransformZ()
 {
@@ -204,7 +209,7 @@ Vertex Vertex::Normalise()
 // Returns the length
 float Vertex::Length()
 {
-	return float(sqrt(pow(_x, 2) + pow(_y, 2) + pow(_z, 2)));
+	return sqrtf(_x * _x + _y * _y + _z * _z);
 }
 
 // Operators
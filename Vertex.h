@@ -1,6 +1,6 @@
 #pragma once
 #include <math.h>
-#include <Windows.h>
+#include "Platform.h"
 
 class Vertex
 {
@@ -33,6 +33,7 @@ public:
 	int GetUVIndex() const;
 	void SetUVIndex(const int index);
 	float GetPreTransformZ() const;
+	void SetPreTransformZ(const float z);
 	void SavePreTransformZ();
 
 	// Other methods
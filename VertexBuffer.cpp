@@ -0,0 +1,168 @@
+#include "VertexBuffer.h"
+#include "Simd.h"
+#include "Clipper.h"
+
+VertexBuffer::VertexBuffer()
+{
+}
+
+VertexBuffer::~VertexBuffer()
+{
+}
+
+void VertexBuffer::Resize(size_t count)
+{
+	_count = count;
+	size_t padded = GetPaddedCount();
+	if (padded > _x.size())
+	{
+		// Padding vertices are kept at the origin with a w of 1 so that passes over them are harmless
+		_x.resize(padded, 0.0f);
+		_y.resize(padded, 0.0f);
+		_z.resize(padded, 0.0f);
+		_w.resize(padded, 1.0f);
+		_normalX.resize(padded, 0.0f);
+		_normalY.resize(padded, 0.0f);
+		_normalZ.resize(padded, 0.0f);
+		_colour.resize(padded, 0);
+		_preTransformZ.resize(padded, 1.0f);
+		_clipFlags.resize(padded, 0);
+	}
+}
+
+void VertexBuffer::Clear()
+{
+	_count = 0;
+	_x.clear();
+	_y.clear();
+	_z.clear();
+	_w.clear();
+	_normalX.clear();
+	_normalY.clear();
+	_normalZ.clear();
+	_colour.clear();
+	_preTransformZ.clear();
+	_clipFlags.clear();
+}
+
+size_t VertexBuffer::GetCount() const
+{
+	return _count;
+}
+
+size_t VertexBuffer::GetPaddedCount() const
+{
+	return (_count + 3) & ~size_t(3);
+}
+
+void VertexBuffer::Add(float x, float y, float z)
+{
+	size_t index = _count;
+	Resize(_count + 1);
+	_x[index] = x;
+	_y[index] = y;
+	_z[index] = z;
+	_w[index] = 1.0f;
+}
+
+size_t VertexBuffer::GetMemorySize() const
+{
+	size_t floatStreams = _x.capacity() + _y.capacity() + _z.capacity() + _w.capacity() + _normalX.capacity() + _normalY.capacity() + _normalZ.capacity() + _preTransformZ.capacity();
+	return floatStreams * sizeof(float) + (_colour.capacity() + _clipFlags.capacity()) * sizeof(uint32_t);
+}
+
+Vertex VertexBuffer::GetPosition(size_t index) const
+{
+	return Vertex(_x[index], _y[index], _z[index], _w[index]);
+}
+
+void VertexBuffer::Transform(const Matrix& transform, const VertexBuffer& source)
+{
+	Resize(source.GetCount());
+	transform.TransformPoints(source.GetX(), source.GetY(), source.GetZ(), source.GetW(), GetX(), GetY(), GetZ(), GetW(), GetPaddedCount());
+}
+
+void VertexBuffer::TransformNormals(const Matrix& normalTransform, const VertexBuffer& source, const std::vector<size_t>& blocks)
+{
+	Resize(source.GetCount());
+	Float4 m[3][3];
+	for (int row = 0; row < 3; row++)
+	{
+		for (int column = 0; column < 3; column++)
+		{
+			m[row][column] = Float4::Set1(normalTransform.GetM(row, column));
+		}
+	}
+
+	// The smallest squared length that is normalised, which keeps zero normals from becoming NaNs
+	Float4 minimumLength = Float4::Set1(1e-30f);
+	for (size_t i : blocks)
+	{
+		Float4 x = Float4::Load(source.GetNormalX() + i);
+		Float4 y = Float4::Load(source.GetNormalY() + i);
+		Float4 z = Float4::Load(source.GetNormalZ() + i);
+		Float4 normalX = m[0][0] * x + m[0][1] * y + m[0][2] * z;
+		Float4 normalY = m[1][0] * x + m[1][1] * y + m[1][2] * z;
+		Float4 normalZ = m[2][0] * x + m[2][1] * y + m[2][2] * z;
+		Float4 scale = Float4::ReciprocalSqrt(Float4::Max(normalX * normalX + normalY * normalY + normalZ * normalZ, minimumLength));
+		(normalX * scale).Store(GetNormalX() + i);
+		(normalY * scale).Store(GetNormalY() + i);
+		(normalZ * scale).Store(GetNormalZ() + i);
+	}
+}
+
+void VertexBuffer::Project(const Matrix& transform)
+{
+	Float4 m[ROWS][COLS];
+	for (int row = 0; row < ROWS; row++)
+	{
+		for (int column = 0; column < COLS; column++)
+		{
+			m[row][column] = Float4::Set1(transform.GetM(row, column));
+		}
+	}
+
+	size_t padded = GetPaddedCount();
+	Float4 one = Float4::Set1(1.0f);
+	Float4 zero = Float4::Set1(0.0f);
+	Float4 nearPlane = Float4::Set1(CLIP_NEAR_PLANE);
+	Float4 farPlane = Float4::Set1(CLIP_FAR_PLANE);
+	Float4 guardBand = Float4::Set1(CLIP_GUARD_BAND);
+	for (size_t i = 0; i < padded; i += 4)
+	{
+		Float4 x = Float4::Load(GetX() + i);
+		Float4 y = Float4::Load(GetY() + i);
+		Float4 z = Float4::Load(GetZ() + i);
+		Float4 w = Float4::Load(GetW() + i);
+		Float4 projectedX = m[0][0] * x + m[0][1] * y + m[0][2] * z + m[0][3] * w;
+		Float4 projectedY = m[1][0] * x + m[1][1] * y + m[1][2] * z + m[1][3] * w;
+		Float4 projectedZ = m[2][0] * x + m[2][1] * y + m[2][2] * z + m[2][3] * w;
+		Float4 projectedW = m[3][0] * x + m[3][1] * y + m[3][2] * z + m[3][3] * w;
+		projectedW.Store(GetPreTransformZ() + i);
+
+		// The guard band planes are at x = +-band * w and y = +-band * w
+		Float4 guardW = guardBand * projectedW;
+		Int4 nearMask = nearPlane.GreaterThan(projectedW);
+		Int4 flags = (nearMask & Int4::Set1(static_cast<int32_t>(CLIP_NEAR)))
+			| (projectedW.GreaterThan(farPlane) & Int4::Set1(static_cast<int32_t>(CLIP_FAR)))
+			| ((zero - guardW).GreaterThan(projectedX) & Int4::Set1(static_cast<int32_t>(CLIP_LEFT)))
+			| (projectedX.GreaterThan(guardW) & Int4::Set1(static_cast<int32_t>(CLIP_RIGHT)))
+			| ((zero - guardW).GreaterThan(projectedY) & Int4::Set1(static_cast<int32_t>(CLIP_TOP)))
+			| (projectedY.GreaterThan(guardW) & Int4::Set1(static_cast<int32_t>(CLIP_BOTTOM)));
+		flags.Store(_clipFlags.data() + i);
+
+		Int4::Select(nearMask, projectedX.AsInt(), (projectedX / projectedW).AsInt()).AsFloat().Store(GetX() + i);
+		Int4::Select(nearMask, projectedY.AsInt(), (projectedY / projectedW).AsInt()).AsFloat().Store(GetY() + i);
+		Int4::Select(nearMask, projectedZ.AsInt(), (projectedZ / projectedW).AsInt()).AsFloat().Store(GetZ() + i);
+		one.Store(GetW() + i);
+	}
+}
+
+// Vertices behind the near plane were left homogeneous, the rest are multiplied back by w
+void VertexBuffer::GetHomogeneous(size_t index, float& x, float& y, float& w) const
+{
+	w = _preTransformZ[index];
+	float scale = (_clipFlags[index] & CLIP_NEAR) != 0 ? 1.0f : w;
+	x = _x[index] * scale;
+	y = _y[index] * scale;
+}
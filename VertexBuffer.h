@@ -0,0 +1,84 @@
+#pragma once
+#include "Platform.h"
+#include "Vertex.h"
+#include "Matrix.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Vertices stored as a structure of arrays. Each attribute has its own contiguous stream so that
+// passes over the vertices can work on four of them at once. Streams are padded to a multiple of
+// four, and only grow, so resizing the buffer every frame does not allocate
+class VertexBuffer
+{
+public:
+	VertexBuffer();
+	~VertexBuffer();
+
+	// Changes the number of vertices. Existing vertices are kept
+	void			Resize(size_t count);
+	void			Clear();
+	size_t			GetCount() const;
+	// Number of vertices including the padding, always a multiple of four
+	size_t			GetPaddedCount() const;
+	// Adds a vertex at the end of the buffer
+	void			Add(float x, float y, float z);
+	// Number of bytes allocated for the streams
+	size_t			GetMemorySize() const;
+
+	// Position streams
+	float*			GetX() { return _x.data(); }
+	float*			GetY() { return _y.data(); }
+	float*			GetZ() { return _z.data(); }
+	float*			GetW() { return _w.data(); }
+	const float*	GetX() const { return _x.data(); }
+	const float*	GetY() const { return _y.data(); }
+	const float*	GetZ() const { return _z.data(); }
+	const float*	GetW() const { return _w.data(); }
+	// Normal streams
+	float*			GetNormalX() { return _normalX.data(); }
+	float*			GetNormalY() { return _normalY.data(); }
+	float*			GetNormalZ() { return _normalZ.data(); }
+	const float*	GetNormalX() const { return _normalX.data(); }
+	const float*	GetNormalY() const { return _normalY.data(); }
+	const float*	GetNormalZ() const { return _normalZ.data(); }
+	// Colours, packed the same way as a COLORREF (0x00BBGGRR)
+	uint32_t*		GetColour() { return _colour.data(); }
+	const uint32_t*	GetColour() const { return _colour.data(); }
+	// W saved before dehomogenisation, which is the z value in camera space
+	float*			GetPreTransformZ() { return _preTransformZ.data(); }
+	const float*	GetPreTransformZ() const { return _preTransformZ.data(); }
+	// Planes each vertex was outside of when it was projected, as CLIP_ flags (see Clipper)
+	const uint32_t*	GetClipFlags() const { return _clipFlags.data(); }
+
+	// Returns the position of a vertex
+	Vertex			GetPosition(size_t index) const;
+	// Transforms the positions of every vertex in source by the matrix and stores them in this buffer
+	void			Transform(const Matrix& transform, const VertexBuffer& source);
+	// Transforms the normals of vertices in source by a normal matrix (see
+	// Matrix::GetNormalMatrix), normalises them and stores them in this buffer. Only the groups
+	// of four vertices starting at the indices in blocks are transformed, and the rest are left
+	// as they were. Zero normals are left as zero
+	void			TransformNormals(const Matrix& normalTransform, const VertexBuffer& source, const std::vector<size_t>& blocks);
+	// Transforms the positions in place and divides them by the new w, which is saved first. The
+	// matrix can end with an affine transform such as the screen transform, which gives the same
+	// result whether it is applied before or after the divide. The clip flags of each vertex are
+	// worked out before the divide, and vertices in front of the near plane are not divided, so
+	// that triangles using them can still be clipped
+	void			Project(const Matrix& transform);
+	// Returns the homogeneous x, y and w of a projected vertex, for clipping
+	void			GetHomogeneous(size_t index, float& x, float& y, float& w) const;
+
+private:
+	size_t				_count{ 0 };
+	std::vector<float>	_x;
+	std::vector<float>	_y;
+	std::vector<float>	_z;
+	std::vector<float>	_w;
+	std::vector<float>	_normalX;
+	std::vector<float>	_normalY;
+	std::vector<float>	_normalZ;
+	std::vector<uint32_t> _colour;
+	std::vector<float>	_preTransformZ;
+	std::vector<uint32_t> _clipFlags;
+};
@@ -0,0 +1,399 @@
+#include "Win32Platform.h"
+
+#ifndef RASTERISER_HEADLESS
+#include "Profiler.h"
+#include <shellapi.h>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+
+// Seconds between changes to the frame times shown in the title bar
+const double FRAME_TIMES_PERIOD = 1.0;
+
+// Posted by the render thread when the pipeline has rendered a frame
+const UINT WM_FRAME_RENDERED = WM_APP + 1;
+
+#ifndef CREATE_WAITABLE_TIMER_HIGH_RESOLUTION
+#define CREATE_WAITABLE_TIMER_HIGH_RESOLUTION 0x00000002
+#endif
+
+// Reference to the platform - primarily used to access the message handler correctly
+// This is initialised in the constructor
+
+Win32Platform *	_thisPlatform = NULL;
+
+// Forward declaration of our window procedure
+LRESULT CALLBACK WndProc(HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam);
+
+int APIENTRY wWinMain(_In_	   HINSTANCE hInstance,
+				  	  _In_opt_ HINSTANCE hPrevInstance,
+					  _In_	   LPWSTR    lpCmdLine,
+					  _In_	   int       nCmdShow)
+{
+	UNREFERENCED_PARAMETER(hPrevInstance);
+	UNREFERENCED_PARAMETER(lpCmdLine);
+
+	// We can only run if an instance of a class that inherits from Framework
+	// has been created
+	Framework* framework = Framework::GetFramework();
+	if (framework)
+	{
+		Win32Platform platform(hInstance, nCmdShow);
+		return framework->Run(platform);
+	}
+	return -1;
+}
+
+Win32Platform::Win32Platform(HINSTANCE hInstance, int nCmdShow)
+	: _hInstance(hInstance), _hWnd(0), _nCmdShow(nCmdShow), _framework(NULL)
+{
+	_thisPlatform = this;
+	_validArguments = ParseArguments();
+}
+
+Win32Platform::~Win32Platform()
+{
+	_thisPlatform = NULL;
+}
+
+// Parses the command line options described in Win32Platform.h
+//
+// Returns false if any option is not recognised or has an invalid value
+
+bool Win32Platform::ParseArguments()
+{
+	int argc;
+	LPWSTR* argv = CommandLineToArgvW(GetCommandLineW(), &argc);
+	if (argv == NULL)
+	{
+		return false;
+	}
+	bool valid = true;
+	FrameLoop::Mode mode = _frameLoop.GetMode();
+	double rate = _frameLoop.GetRate();
+	for (int i = 1; i < argc && valid; i++)
+	{
+		std::wstring option = argv[i];
+		// Every option takes a value
+		if (i + 1 >= argc)
+		{
+			valid = false;
+			break;
+		}
+		std::wstring value = argv[++i];
+		if (option == L"--loop")
+		{
+			// Mode names are plain ASCII
+			std::string name;
+			for (wchar_t c : value)
+			{
+				name += static_cast<char>(c);
+			}
+			valid = FrameLoop::ParseMode(name, mode);
+		}
+		else if (option == L"--pipeline")
+		{
+			valid = value == L"on" || value == L"off";
+			_pipelined = value == L"on";
+		}
+		else if (option == L"--rate")
+		{
+			rate = _wtof(value.c_str());
+			valid = rate > 0;
+		}
+		else
+		{
+			valid = false;
+		}
+	}
+	LocalFree(argv);
+	_frameLoop.SetMode(mode, rate);
+	return valid;
+}
+
+// Create the main window and the bitmap that the framework draws on
+
+bool Win32Platform::Initialise(Framework& framework)
+{
+	_framework = &framework;
+	if (!_validArguments)
+	{
+		MessageBoxW(NULL, L"Usage: Rasteriser [--loop uncapped|fixed|timestep] [--rate N] [--pipeline on|off]", L"Rasteriser", MB_OK | MB_ICONERROR);
+		return false;
+	}
+	return InitialiseMainWindow(framework.GetWidth(), framework.GetHeight());
+}
+
+// Main program loop. Waiting messages are always handled before the next frame, and
+// between frames the thread sleeps rather than spinning
+
+int Win32Platform::MainLoop(Framework& framework)
+{
+	MSG msg;
+	HACCEL hAccelTable = LoadAccelerators(_hInstance, MAKEINTRESOURCE(IDC_RASTERISER));
+
+	// A high resolution timer wakes us within a fraction of a millisecond of when it is due.
+	// They are not available before Windows 10, where an ordinary timer is used instead
+	HANDLE timer = CreateWaitableTimerExW(NULL, NULL, CREATE_WAITABLE_TIMER_HIGH_RESOLUTION, TIMER_ALL_ACCESS);
+	if (timer == NULL)
+	{
+		timer = CreateWaitableTimerExW(NULL, NULL, 0, TIMER_ALL_ACCESS);
+	}
+	_frameLoop.Start();
+	_startPipeline = _pipelined;
+
+	// Main message loop:
+	msg.message = WM_NULL;
+	while (msg.message != WM_QUIT)
+	{
+		// Each time we go through this loop, we look to see if there is a Windows message
+		// that needs to be processed
+		if (PeekMessage(&msg, 0, 0, 0, PM_REMOVE))
+		{
+			if (!TranslateAccelerator(msg.hwnd, hAccelTable, &msg))
+			{
+				TranslateMessage(&msg);
+				DispatchMessage(&msg);
+			}
+			continue;
+		}
+		// If the pipeline cannot be started, as when the window is minimised, frames are updated
+		// and rendered on this thread instead
+		if (_startPipeline)
+		{
+			_startPipeline = false;
+			StartPipeline();
+		}
+		if (_pipeline.IsRunning())
+		{
+			// Frames are shown when the render thread says they are ready
+			MsgWaitForMultipleObjectsEx(0, NULL, INFINITE, QS_ALLINPUT, MWMO_INPUTAVAILABLE);
+		}
+		else if (_frameLoop.Step(framework, framework.GetBitmap()))
+		{
+			// Make sure that the window gets repainted
+			InvalidateRect(_hWnd, NULL, FALSE);
+			PROFILE_END_FRAME();
+			ShowFrameTimes(_frameLoop.GetFrameInterval(), _frameLoop.GetFrameTime());
+		}
+		else
+		{
+			WaitForFrame(timer);
+		}
+	}
+	_pipeline.Stop();
+	if (timer != NULL)
+	{
+		CloseHandle(timer);
+	}
+
+#ifdef RASTERISER_PROFILE
+	// Leaves the timings of the last frames next to the executable
+	std::ofstream statistics("profile.txt");
+	Profiler::Get().WriteStatistics(statistics);
+	Profiler::Get().WriteTrace("profile.json");
+#endif
+	return static_cast<int>(msg.wParam);
+}
+
+void Win32Platform::WaitForFrame(HANDLE timer) const
+{
+	double seconds = _frameLoop.GetTimeToNextFrame();
+	// Due times are relative when negative, in units of 100 nanoseconds
+	LARGE_INTEGER dueTime;
+	dueTime.QuadPart = -static_cast<LONGLONG>(seconds * 1e7);
+	if (timer != NULL && dueTime.QuadPart < 0 && SetWaitableTimer(timer, &dueTime, 0, NULL, NULL, FALSE))
+	{
+		MsgWaitForMultipleObjectsEx(1, &timer, INFINITE, QS_ALLINPUT, MWMO_INPUTAVAILABLE);
+	}
+	else
+	{
+		MsgWaitForMultipleObjectsEx(0, NULL, static_cast<DWORD>(seconds * 1000.0), QS_ALLINPUT, MWMO_INPUTAVAILABLE);
+	}
+}
+
+bool Win32Platform::StartPipeline()
+{
+	RECT clientArea;
+	GetClientRect(_hWnd, &clientArea);
+	HWND hWnd = _hWnd;
+	auto createBitmap = [&](Bitmap& bitmap)
+	{
+		return bitmap.Create(hWnd, clientArea.right - clientArea.left, clientArea.bottom - clientArea.top);
+	};
+	auto frameRendered = [hWnd]
+	{
+		PostMessage(hWnd, WM_FRAME_RENDERED, 0, 0);
+	};
+	_lastShownFrame = std::chrono::steady_clock::now();
+	return _pipeline.Start(*_framework, _frameLoop, createBitmap, frameRendered);
+}
+
+void Win32Platform::ShowPipelinedFrame()
+{
+	if (_pipeline.NextFrame(false) == nullptr)
+	{
+		return;
+	}
+	// Make sure that the window gets repainted
+	InvalidateRect(_hWnd, NULL, FALSE);
+	PROFILE_END_FRAME();
+	// The stages overlap, so the time spent drawing a frame may be longer than the time between frames
+	auto now = std::chrono::steady_clock::now();
+	double interval = std::chrono::duration<double>(now - _lastShownFrame).count();
+	_lastShownFrame = now;
+	ShowFrameTimes(interval, _pipeline.GetPrepareTime() + _pipeline.GetRenderTime());
+}
+
+// Shows the frame rate, the time between frames and the time spent updating and rendering
+// them, averaged over the last second, in the title bar
+
+void Win32Platform::ShowFrameTimes(double interval, double frameTime)
+{
+	_measuredFrames++;
+	_measuredInterval += interval;
+	_measuredFrameTime += frameTime;
+	if (_measuredInterval < FRAME_TIMES_PERIOD)
+	{
+		return;
+	}
+	std::wostringstream title;
+	title.setf(std::ios::fixed);
+	title.precision(1);
+	title << _windowTitle << L" - " << _measuredFrames / _measuredInterval << L" fps, "
+		  << _measuredInterval * 1000.0 / _measuredFrames << L" ms per frame, "
+		  << _measuredFrameTime * 1000.0 / _measuredFrames << L" ms drawing";
+	SetWindowTextW(_hWnd, title.str().c_str());
+	_measuredFrames = 0;
+	_measuredInterval = 0;
+	_measuredFrameTime = 0;
+}
+
+// Register the  window class, create the window and
+// create the bitmap that we will use for rendering
+
+bool Win32Platform::InitialiseMainWindow(unsigned int width, unsigned int height)
+{
+	#define MAX_LOADSTRING 100
+
+	WCHAR windowTitle[MAX_LOADSTRING];          
+	WCHAR windowClass[MAX_LOADSTRING];            
+	
+	LoadStringW(_hInstance, IDS_APP_TITLE, windowTitle, MAX_LOADSTRING);
+	LoadStringW(_hInstance, IDC_RASTERISER, windowClass, MAX_LOADSTRING);
+	_windowTitle = windowTitle;
+
+	WNDCLASSEXW wcex;
+	wcex.cbSize = sizeof(WNDCLASSEX);
+	wcex.style = CS_HREDRAW | CS_VREDRAW;
+	wcex.lpfnWndProc = WndProc;
+	wcex.cbClsExtra = 0;
+	wcex.cbWndExtra = 0;
+	wcex.hInstance = _hInstance;
+	wcex.hIcon = LoadIcon(_hInstance, MAKEINTRESOURCE(IDI_RASTERISER));
+	wcex.hCursor = LoadCursor(nullptr, IDC_ARROW);
+	wcex.hbrBackground = reinterpret_cast<HBRUSH>(COLOR_WINDOW + 1);
+	wcex.lpszMenuName = nullptr;
+	wcex.lpszClassName = windowClass;
+	wcex.hIconSm = LoadIcon(wcex.hInstance, MAKEINTRESOURCE(IDI_SMALL));
+	if (!RegisterClassExW(&wcex))
+	{
+		return false;
+	}
+
+	// Now work out how large the window needs to be for our required client window size
+	RECT windowRect = { 0, 0, static_cast<LONG>(width), static_cast<LONG>(height) };
+	AdjustWindowRect(&windowRect, WS_OVERLAPPEDWINDOW, FALSE);
+	width = windowRect.right - windowRect.left;
+	height = windowRect.bottom - windowRect.top;
+
+	_hWnd = CreateWindowW(windowClass, 
+						  windowTitle, 
+					      WS_OVERLAPPEDWINDOW,
+						  CW_USEDEFAULT, CW_USEDEFAULT, width, height,
+					      nullptr, nullptr, _hInstance, nullptr);
+	if (!_hWnd)
+	{
+		return false;
+	}
+	ShowWindow(_hWnd, _nCmdShow);
+	UpdateWindow(_hWnd);
+
+	// Create a bitmap of the same size as the client area of the window.  This is what we
+	// will be drawing on
+	RECT clientArea;
+	GetClientRect(_hWnd, &clientArea);
+	_framework->GetBitmap().Create(_hWnd, clientArea.right - clientArea.left, clientArea.bottom - clientArea.top);
+	return true;
+}
+
+// The WndProc for the current window.  This cannot be a method, but we can
+// redirect all messages to a method.
+
+LRESULT CALLBACK WndProc(HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam)
+{
+	if (_thisPlatform != NULL)
+	{
+		// If platform is started, then we can call our own message proc
+		return _thisPlatform->MsgProc(hWnd, message, wParam, lParam);
+	}
+	else
+	{
+		// otherwise, we just pass control to the default message proc
+		return DefWindowProc(hWnd, message, wParam, lParam);
+	}
+}
+
+// Our main WndProc
+
+LRESULT Win32Platform::MsgProc(HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam)
+{
+	switch (message)
+	{
+		case WM_PAINT:
+			{
+				// Copy the contents of the bitmap to the window. When frames are pipelined, this is
+				// the last frame the pipeline rendered
+				PROFILE_SCOPE(ProfileStage::Present);
+				const Bitmap* bitmap = _pipeline.GetShownFrame();
+				if (bitmap == nullptr)
+				{
+					bitmap = &_framework->GetBitmap();
+				}
+				PAINTSTRUCT ps;
+				HDC hdc = BeginPaint(hWnd, &ps);
+				BitBlt(hdc, 0, 0, bitmap->GetWidth(), bitmap->GetHeight(), bitmap->GetDC(), 0, 0, SRCCOPY);
+				EndPaint(hWnd, &ps);
+			}
+			break;
+
+		case WM_SIZE:
+			{
+				// The pipeline is stopped while the bitmaps are replaced, and restarted by the main loop
+				_pipeline.Stop();
+				_startPipeline = _pipelined;
+				// Delete any existing bitmap and create a new one of the required size.
+				Bitmap& bitmap = _framework->GetBitmap();
+				bitmap.Create(hWnd, LOWORD(lParam), HIWORD(lParam));
+				// Now render to the resized bitmap
+				_framework->Update(bitmap);
+				_framework->Render(bitmap);
+				InvalidateRect(hWnd, NULL, FALSE);
+			}
+			break;
+
+		case WM_FRAME_RENDERED:
+			ShowPipelinedFrame();
+			break;
+
+		case WM_DESTROY:
+			PostQuitMessage(0);
+			break;
+
+		default:
+			return DefWindowProc(hWnd, message, wParam, lParam);
+	}
+	return 0;
+}
+
+#endif
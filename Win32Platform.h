@@ -0,0 +1,68 @@
+#pragma once
+#include "Platform.h"
+
+#ifndef RASTERISER_HEADLESS
+#include "Framework.h"
+#include "FrameLoop.h"
+#include "FramePipeline.h"
+#include "Resource.h"
+#include <chrono>
+#include <string>
+
+// Platform layer that displays the framework in a Win32 window
+//
+// Command line options:
+//   --loop MODE     How often frames are updated and rendered, either uncapped, fixed or
+//                   timestep (default fixed, see FrameLoop.h)
+//   --rate N        Frames a second for the fixed mode, or updates a second for the timestep
+//                   mode (default 30)
+//   --pipeline on|off
+//                   Prepares each frame on one thread while the one before is rendered on
+//                   another and the one before that is shown in the window (default off, see
+//                   FramePipeline.h)
+//
+// The measured frame rate and frame times are shown in the title bar
+class Win32Platform : public Platform
+{
+public:
+	Win32Platform(HINSTANCE hInstance, int nCmdShow);
+	~Win32Platform();
+
+	bool Initialise(Framework& framework);
+	int MainLoop(Framework& framework);
+
+	LRESULT MsgProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam);
+
+private:
+	HINSTANCE		_hInstance;
+	HWND			_hWnd;
+	int				_nCmdShow;
+	Framework*		_framework;
+
+	bool			_validArguments;
+
+	// Decides when frames are updated and rendered
+	FrameLoop		_frameLoop;
+	// Used instead of updating and rendering on this thread if frames are pipelined
+	FramePipeline	_pipeline;
+	bool			_pipelined{ false };
+	// Set when the main loop needs to start the pipeline, or start it again after a resize
+	bool			_startPipeline{ false };
+	std::chrono::steady_clock::time_point _lastShownFrame;
+	// Frame times measured since the title bar was last changed
+	std::wstring	_windowTitle;
+	int				_measuredFrames{ 0 };
+	double			_measuredInterval{ 0 };
+	double			_measuredFrameTime{ 0 };
+
+	bool ParseArguments();
+	bool InitialiseMainWindow(unsigned int width, unsigned int height);
+	// Waits until the next frame is due or a message arrives
+	void WaitForFrame(HANDLE timer) const;
+	// Starts the pipeline, rendering into bitmaps the size of the window
+	bool StartPipeline();
+	// Shows a frame rendered by the pipeline
+	void ShowPipelinedFrame();
+	void ShowFrameTimes(double interval, double frameTime);
+};
+#endif
@@ -0,0 +1,117 @@
+#include "WorkerPool.h"
+
+WorkerPool::WorkerPool()
+{
+}
+
+WorkerPool::~WorkerPool()
+{
+	Stop();
+}
+
+void WorkerPool::Start(unsigned int threadCount)
+{
+	Stop();
+	if (threadCount == 0)
+	{
+		threadCount = std::thread::hardware_concurrency();
+	}
+	_quit = false;
+	// The calling thread is the first thread in the pool, so one less thread is created
+	for (unsigned int i = 1; i < threadCount; i++)
+	{
+		_threads.push_back(std::thread(&WorkerPool::WorkerMain, this));
+	}
+}
+
+void WorkerPool::Stop()
+{
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_quit = true;
+	}
+	_wake.notify_all();
+	for (std::thread& thread : _threads)
+	{
+		thread.join();
+	}
+	_threads.clear();
+}
+
+unsigned int WorkerPool::GetThreadCount() const
+{
+	return static_cast<unsigned int>(_threads.size()) + 1;
+}
+
+void WorkerPool::ParallelFor(size_t count, const std::function<void(size_t)>& task)
+{
+	if (count == 0)
+	{
+		return;
+	}
+	// Not worth waking the workers for a single piece of work
+	if (_threads.empty() || count == 1)
+	{
+		for (size_t i = 0; i < count; i++)
+		{
+			task(i);
+		}
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_task = &task;
+		_count = count;
+		_next = 0;
+		_busy = static_cast<unsigned int>(_threads.size());
+		_generation++;
+	}
+	_wake.notify_all();
+
+	RunTask();
+
+	// Waits for the workers to finish what they have started
+	std::unique_lock<std::mutex> lock(_mutex);
+	_finished.wait(lock, [this] { return _busy == 0; });
+	_task = nullptr;
+}
+
+// Takes indices from the shared counter until there are none left
+void WorkerPool::RunTask()
+{
+	size_t index;
+	while ((index = _next.fetch_add(1)) < _count)
+	{
+		(*_task)(index);
+	}
+}
+
+void WorkerPool::WorkerMain()
+{
+	unsigned int generation = 0;
+	while (true)
+	{
+		{
+			std::unique_lock<std::mutex> lock(_mutex);
+			_wake.wait(lock, [this, generation] { return _quit || _generation != generation; });
+			if (_quit)
+			{
+				return;
+			}
+			generation = _generation;
+		}
+
+		RunTask();
+
+		bool last;
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			last = --_busy == 0;
+		}
+		if (last)
+		{
+			_finished.notify_one();
+		}
+	}
+}
@@ -0,0 +1,45 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Pool of threads that work through a range of indices together. The thread that calls
+// ParallelFor takes part in the work as well, so a pool of one thread runs everything inline
+class WorkerPool
+{
+public:
+	WorkerPool();
+	~WorkerPool();
+
+	// Starts the pool with the specified number of threads (including the calling thread).
+	// 0 uses one thread per core
+	void			Start(unsigned int threadCount);
+	// Stops and joins all of the worker threads
+	void			Stop();
+	unsigned int	GetThreadCount() const;
+	// Calls task once for every index in [0, count) and returns when all of the calls have finished.
+	// Indices are handed out through an atomic counter, so the calls may happen in any order and on any thread
+	void			ParallelFor(size_t count, const std::function<void(size_t)>& task);
+
+private:
+	std::vector<std::thread>			_threads;
+	std::mutex							_mutex;
+	std::condition_variable				_wake;
+	std::condition_variable				_finished;
+	// Work currently being done
+	const std::function<void(size_t)>*	_task{ nullptr };
+	size_t								_count{ 0 };
+	std::atomic<size_t>					_next{ 0 };
+	// Number of worker threads still working on the current task
+	unsigned int						_busy{ 0 };
+	// Incremented every time a new task is started so that workers know there is something to do
+	unsigned int						_generation{ 0 };
+	bool								_quit{ false };
+
+	void WorkerMain();
+	void RunTask();
+};